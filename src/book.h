@@ -39,7 +39,16 @@ enum BOOK_REQUEST_T
     SOLICITAR,
     RENOVAR,
     DEVOLVER,
-    BUSCAR
+    BUSCAR,
+    RENOVAR_PROPIO,  /**< Renovar el ejemplar que tiene quien lo pide*/
+    DEVOLVER_PROPIO, /**< Devolver el ejemplar que tiene quien lo pide*/
+    MIS_PRESTAMOS,   /**< Listar los ejemplares que tiene quien lo pide*/
+    RESERVAR,        /**< Prestar un ejemplar o esperar a que se devuelva uno*/
+    BUSCAR_TODOS,    /**< Todos los ejemplares de un ISBN o todos los títulos que
+                          contienen el nombre, por páginas*/
+    BUSCAR_PREFIJO,  /**< Títulos que empiezan por el nombre, por páginas*/
+    BUSCAR_PALABRA,  /**< Títulos que contienen la palabra, por páginas*/
+    BUSCAR_PARECIDOS /**< Títulos de nombre más parecido (trigramas)*/
 };
 
 /**
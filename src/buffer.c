@@ -6,6 +6,7 @@
 
 sem_t available_resources = {0};
 sem_t available_spaces = {0};
+sem_t productores = {0}; /**< Exclusión entre quienes encolan (bucle de eventos y anillos)*/
 
 int init(buffer_t *buffer_peticiones)
 {
@@ -13,10 +14,12 @@ int init(buffer_t *buffer_peticiones)
         return FAILURE_GENERIC;
 
     buffer_peticiones->current_item = 0;
+    buffer_peticiones->last_item = 0;
 
     // Initialize semaphores with resources
     if (sem_init(&available_resources, 0, 0) ||
-        sem_init(&available_spaces, 0, BUFFER_SIZE))
+        sem_init(&available_spaces, 0, BUFFER_SIZE) ||
+        sem_init(&productores, 0, 1))
     {
         perror("Hilo auxiliar");
         return FAILURE_GENERIC;
@@ -37,11 +40,29 @@ int queue(buffer_t *buffer_peticiones, paquet_t paquete)
         return FAILURE_GENERIC;
     }
 
-    // Agregar a la cola
-    buffer_peticiones->paquetArray[buffer_peticiones->current_item] = paquete;
+    // Los semáforos sólo cuentan espacios: dos hilos que encolan a la vez
+    // escribirían la misma posición
+    if (sem_wait(&productores))
+    {
+        perror("Hilo auxiliar");
+        sem_post(&available_spaces);
+        return FAILURE_GENERIC;
+    }
+
+    // Agregar a la cola con su momento de llegada
+    peticion_buffer_t *peticion =
+        &buffer_peticiones->peticionArray[buffer_peticiones->last_item];
+    peticion->paquete = paquete;
+    peticion->atendida = false;
+    clock_gettime(CLOCK_MONOTONIC, &peticion->llegada);
 
-    // Otorgar un recurso
-    if (sem_post(&available_resources))
+    // Mover a la siguiente posición libre
+    buffer_peticiones->last_item = (buffer_peticiones->last_item + 1) % BUFFER_SIZE;
+
+    // Otorgar un recurso (antes de soltar el turno, así se cuentan en orden)
+    int error = sem_post(&available_resources);
+    sem_post(&productores);
+    if (error)
     {
         perror("Hilo auxiliar");
         return FAILURE_GENERIC;
@@ -55,7 +76,8 @@ int destroy(buffer_t *buffer_peticiones)
     if (buffer_peticiones == NULL)
         return FAILURE_GENERIC;
 
-    if (sem_destroy(&available_spaces) || sem_destroy(&available_resources))
+    if (sem_destroy(&available_spaces) || sem_destroy(&available_resources) ||
+        sem_destroy(&productores))
     {
         perror("Hilo auxiliar");
         return FAILURE_GENERIC;
@@ -63,14 +85,40 @@ int destroy(buffer_t *buffer_peticiones)
     return SUCCESS_GENERIC;
 }
 
-paquet_t *getNext(buffer_t *buffer_peticiones)
+peticion_buffer_t *getNext(buffer_t *buffer_peticiones)
 {
     if (buffer_peticiones == NULL)
         return NULL;
 
     // Esperar a que haya un recurso disponible en cola
     sem_wait(&available_resources);
-    return &buffer_peticiones->paquetArray[buffer_peticiones->current_item];
+    return &buffer_peticiones->peticionArray[buffer_peticiones->current_item];
+}
+
+bool isEmpty(buffer_t *buffer_peticiones)
+{
+    int disponibles = 0;
+    if (buffer_peticiones == NULL || sem_getvalue(&available_resources, &disponibles))
+        return true;
+
+    return disponibles <= 0;
+}
+
+int countQueued(buffer_t *buffer_peticiones)
+{
+    int disponibles = 0;
+    if (buffer_peticiones == NULL || sem_getvalue(&available_resources, &disponibles))
+        return 0;
+
+    // Las peticiones contadas ya están escritas (se encolan antes del sem_post)
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return disponibles;
+}
+
+peticion_buffer_t *peek(buffer_t *buffer_peticiones, int posicion)
+{
+    int indice = (buffer_peticiones->current_item + posicion) % BUFFER_SIZE;
+    return &buffer_peticiones->peticionArray[indice];
 }
 
 int dequeue(buffer_t *buffer_peticiones)
@@ -14,10 +14,22 @@
 #define __BUFFER_H__
 
 #include <stdbool.h>
+#include <time.h>
 #include "paquet.h"
 
 #define BUFFER_SIZE 10 /**< Tamaño estático del buffer*/
 
+/**
+ * @struct peticion_buffer_t
+ * @brief Paquete encolado junto con el momento en que llegó al servidor
+ */
+typedef struct
+{
+    paquet_t paquete;        /**< Paquete recibido por el pipe*/
+    struct timespec llegada; /**< Momento de llegada (CLOCK_MONOTONIC)*/
+    bool atendida;           /**< Ya se respondió junto con una petición idéntica*/
+} peticion_buffer_t;
+
 /**
  * @struct buffer_t
  * @brief Arreglo dinámico de peticiones
@@ -25,8 +37,9 @@
  */
 typedef struct
 {
-    int current_item;                  /**< Paquete actual del arreglo*/
-    paquet_t paquetArray[BUFFER_SIZE]; /**< Arreglo de paquetes en cola*/
+    int current_item;                             /**< Paquete actual del arreglo*/
+    int last_item;                                /**< Próxima posición libre*/
+    peticion_buffer_t peticionArray[BUFFER_SIZE]; /**< Arreglo de paquetes en cola*/
 } buffer_t;
 
 /**
@@ -46,7 +59,8 @@ int init(buffer_t *buffer_peticiones);
 int destroy(buffer_t *buffer_peticiones);
 
 /**
- * @brief 
+ * @brief Encolar un paquete, se marca con el momento de llegada
+ * @note Pueden encolar varios hilos a la vez, uno solo consume
  * 
  * @param buffer_peticiones Cola con las peticiones
  * @param paquete Paquete a insertar
@@ -59,9 +73,36 @@ int queue(buffer_t *buffer_peticiones, paquet_t paquete);
  * @note No olvidar retirarlo con \ref dequeue
  * 
  * @param buffer_peticiones Cola con las peticiones
- * @return El paquete en la cola o NULL si no hay (Apuntador)
+ * @return La petición en la cola o NULL si no hay (Apuntador)
+ */
+peticion_buffer_t *getNext(buffer_t *buffer_peticiones);
+
+/**
+ * @brief Saber si la cola está vacía (sin bloquear)
+ * 
+ * @param buffer_peticiones Cola con las peticiones
+ * @return true si no hay peticiones en cola
+ */
+bool isEmpty(buffer_t *buffer_peticiones);
+
+/**
+ * @brief Cantidad de peticiones en cola detrás de la que se está atendiendo
+ * (la que retornó \ref getNext)
+ *
+ * @param buffer_peticiones Cola con las peticiones
+ * @return int Peticiones que esperan
+ */
+int countQueued(buffer_t *buffer_peticiones);
+
+/**
+ * @brief Ver una petición que espera sin sacarla de la cola
+ * @note Sólo la puede usar quien consume la cola
+ *
+ * @param buffer_peticiones Cola con las peticiones
+ * @param posicion Posición detrás de la actual (de 1 a \ref countQueued)
+ * @return La petición (Apuntador)
  */
-paquet_t *getNext(buffer_t *buffer_peticiones);
+peticion_buffer_t *peek(buffer_t *buffer_peticiones, int posicion);
 
 /**
  * @brief Eliminar el último paquete de la cola
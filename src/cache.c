@@ -0,0 +1,90 @@
+/**
+ * @file cache.c
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Caché de respuestas BUSCAR: la respuesta de cada título ya escrita
+ * en cada formato, válida mientras no cambie ninguno de sus ejemplares
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "formato.h"
+
+void iniciarCache(cache_busqueda_t *cache)
+{
+    memset(cache, 0, sizeof(*cache));
+}
+
+void liberarCache(cache_busqueda_t *cache)
+{
+    for (int i = 0; i < MAX_CANT_LIBROS; i++)
+    {
+        free(cache->titulos[i]);
+        cache->titulos[i] = NULL;
+    }
+}
+
+respuesta_cache_t *respuestaVigente(cache_busqueda_t *cache,
+                                    const indice_titulos_t *indice,
+                                    int titulo)
+{
+    // Un préstamo, renovación o devolución de cualquier ejemplar del título
+    // cambió su versión: la respuesta guardada ya no sirve
+    respuesta_cache_t *entrada = cache->titulos[titulo];
+    if (entrada == NULL || entrada->version != indice->version[titulo])
+        return NULL;
+
+    return entrada;
+}
+
+respuesta_cache_t *consultarCache(cache_busqueda_t *cache,
+                                  const indice_titulos_t *indice,
+                                  int titulo)
+{
+    respuesta_cache_t *entrada = respuestaVigente(cache, indice, titulo);
+    if (entrada == NULL)
+    {
+        cache->fallos++;
+        return NULL;
+    }
+
+    cache->aciertos++;
+    return entrada;
+}
+
+respuesta_cache_t *guardarCache(cache_busqueda_t *cache,
+                                const indice_titulos_t *indice,
+                                int titulo,
+                                const paquet_t *respuesta)
+{
+    // Sólo los títulos que alguien busca ocupan memoria
+    if (cache->titulos[titulo] == NULL)
+        cache->titulos[titulo] = (respuesta_cache_t *)malloc(sizeof(respuesta_cache_t));
+
+    respuesta_cache_t *entrada = cache->titulos[titulo];
+    if (entrada == NULL)
+        return NULL;
+
+    entrada->version = indice->version[titulo];
+    entrada->respuesta = *respuesta;
+    memset(entrada->tam, 0, sizeof(entrada->tam));
+
+    return entrada;
+}
+
+unsigned char *mensajeCache(respuesta_cache_t *entrada, int formato, int *tam)
+{
+    if (entrada->tam[formato] == 0)
+        entrada->tam[formato] = codificarPaquete(&entrada->respuesta, formato,
+                                                 entrada->mensaje[formato]);
+
+    *tam = entrada->tam[formato];
+    return entrada->mensaje[formato];
+}
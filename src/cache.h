@@ -0,0 +1,122 @@
+/**
+ * @file cache.h
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Caché de respuestas BUSCAR: la respuesta de cada título ya escrita
+ * en cada formato, válida mientras no cambie ninguno de sus ejemplares
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stdint.h>
+#include "paquet.h"
+#include "titulos.h"
+
+/* ----------------------------- Definiciones ----------------------------- */
+
+#define FORMATOS_CACHE 2                   /**< FORMATO_CLASICO y FORMATO_COMPACTO*/
+#define TAM_MENSAJE_CACHE sizeof(paquet_t) /**< Un BOOK compacto es menor que el clásico*/
+
+/* ------------------------------ Estructuras ------------------------------ */
+
+/**
+ * @struct respuesta_cache_t
+ * @brief Respuesta a BUSCAR de un título y sus mensajes ya escritos
+ */
+typedef struct
+{
+    uint32_t version;                                          /**< Versión del título con la que se armó (0: vacía)*/
+    paquet_t respuesta;                                        /**< Respuesta BOOK*/
+    int tam[FORMATOS_CACHE];                                   /**< Bytes del mensaje en cada formato (0: sin escribir)*/
+    unsigned char mensaje[FORMATOS_CACHE][TAM_MENSAJE_CACHE]; /**< Mensaje en cada formato*/
+} respuesta_cache_t;
+
+/**
+ * @struct cache_busqueda_t
+ * @brief Una respuesta por título (posición de su primer ejemplar en la BD),
+ * reservada la primera vez que alguien lo busca
+ * @note Se protege con el mismo semáforo que la base de datos
+ */
+typedef struct
+{
+    respuesta_cache_t *titulos[MAX_CANT_LIBROS]; /**< Respuesta de cada título (NULL: nunca se buscó)*/
+    unsigned long aciertos;                      /**< Búsquedas respondidas desde la caché*/
+    unsigned long fallos;                        /**< Búsquedas que armaron su respuesta*/
+} cache_busqueda_t;
+
+/* ------------------------ Prototipos de funciones ------------------------ */
+
+/**
+ * @brief Iniciar la caché vacía
+ *
+ * @param cache Caché de búsquedas
+ */
+void iniciarCache(cache_busqueda_t *cache);
+
+/**
+ * @brief Liberar las respuestas guardadas
+ *
+ * @param cache Caché de búsquedas
+ */
+void liberarCache(cache_busqueda_t *cache);
+
+/**
+ * @brief Respuesta guardada de un título si sigue vigente (cuenta el acierto
+ * o el fallo)
+ *
+ * @param cache Caché de búsquedas
+ * @param indice Índice de títulos (versión de cada título)
+ * @param titulo Posición del primer ejemplar del título
+ * @return respuesta_cache_t* Respuesta vigente o NULL
+ */
+respuesta_cache_t *consultarCache(cache_busqueda_t *cache,
+                                  const indice_titulos_t *indice,
+                                  int titulo);
+
+/**
+ * @brief Respuesta guardada de un título si sigue vigente, sin contarla como
+ * acierto (para repartirla entre peticiones idénticas)
+ *
+ * @param cache Caché de búsquedas
+ * @param indice Índice de títulos
+ * @param titulo Posición del primer ejemplar del título
+ * @return respuesta_cache_t* Respuesta vigente o NULL
+ */
+respuesta_cache_t *respuestaVigente(cache_busqueda_t *cache,
+                                    const indice_titulos_t *indice,
+                                    int titulo);
+
+/**
+ * @brief Guardar la respuesta de un título con su versión actual (los
+ * mensajes se escriben cuando se piden)
+ *
+ * @param cache Caché de búsquedas
+ * @param indice Índice de títulos
+ * @param titulo Posición del primer ejemplar del título
+ * @param respuesta Respuesta BOOK
+ * @return respuesta_cache_t* Respuesta guardada o NULL si no hay memoria
+ */
+respuesta_cache_t *guardarCache(cache_busqueda_t *cache,
+                                const indice_titulos_t *indice,
+                                int titulo,
+                                const paquet_t *respuesta);
+
+/**
+ * @brief Mensaje de una respuesta en un formato, se escribe la primera vez
+ * @note El cliente y el id del mensaje son los de la última petición que lo
+ * usó, se cambian con \ref sellarMensaje
+ *
+ * @param entrada Respuesta guardada
+ * @param formato FORMATO_CLASICO o FORMATO_COMPACTO
+ * @param tam RETORNA: bytes del mensaje
+ * @return unsigned char* Mensaje
+ */
+unsigned char *mensajeCache(respuesta_cache_t *entrada, int formato, int *tam);
+
+#endif // __CACHE_H__
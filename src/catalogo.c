@@ -0,0 +1,181 @@
+/**
+ * @file catalogo.c
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Catálogo de sólo lectura en memoria compartida: el servidor publica
+ * los títulos y el estado de cada ejemplar, los clientes del mismo equipo lo
+ * consultan sin enviar peticiones
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "catalogo.h"
+#include "shm.h"
+
+/* -------------------------------- Servidor -------------------------------- */
+
+catalogo_shm_t *publicarCatalogo(const book_t ejemplar[],
+                                 int n_libros,
+                                 const indice_titulos_t *indice)
+{
+    //! 1. Crear el segmento, uno que dejó un servidor anterior se reemplaza
+    //! (quien aún lo tenga abierto sigue viendo el viejo)
+    shm_unlink(NOMBRE_CATALOGO);
+    int fd = shm_open(NOMBRE_CATALOGO, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        perror(NOMBRE_CATALOGO);
+        return NULL;
+    }
+
+    if (ftruncate(fd, sizeof(catalogo_shm_t)) < 0)
+    {
+        perror(NOMBRE_CATALOGO);
+        close(fd);
+        shm_unlink(NOMBRE_CATALOGO);
+        return NULL;
+    }
+
+    catalogo_shm_t *catalogo = mmap(NULL, sizeof(catalogo_shm_t), PROT_READ | PROT_WRITE,
+                                    MAP_SHARED, fd, 0);
+    close(fd);
+    if (catalogo == MAP_FAILED)
+    {
+        perror(NOMBRE_CATALOGO);
+        shm_unlink(NOMBRE_CATALOGO);
+        return NULL;
+    }
+
+    //! 2. Títulos y ejemplares (el segmento nuevo está en ceros)
+    memcpy(catalogo->ejemplares, ejemplar, sizeof(book_t) * n_libros);
+
+    for (int i = 0; i < n_libros; i++)
+    {
+        if (indice->tituloDe[i] != i)
+        {
+            catalogo->titulos[catalogo->n_titulos - 1].cantidad++;
+            continue;
+        }
+
+        titulo_catalogo_t *titulo = &catalogo->titulos[catalogo->n_titulos++];
+        titulo->ISBN = ejemplar[i].ISBN;
+        titulo->primero = (short)i;
+        titulo->cantidad = 1;
+    }
+
+    //! 3. Publicarlo: la magia se escribe cuando todo lo demás está listo
+    catalogo->servidor = getpid();
+    __atomic_store_n(&catalogo->magia, MAGIA_CATALOGO, __ATOMIC_RELEASE);
+
+    return catalogo;
+}
+
+void escribirEjemplar(catalogo_shm_t *catalogo,
+                      int titulo,
+                      int posicion,
+                      const book_t *copia)
+{
+    // Secuencia impar: los lectores del título esperan o repiten
+    uint32_t *secuencia = &catalogo->secuencia[titulo];
+    uint32_t actual = *secuencia;
+
+    __atomic_store_n(secuencia, actual + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    catalogo->ejemplares[posicion] = *copia;
+
+    __atomic_store_n(secuencia, actual + 2, __ATOMIC_RELEASE);
+}
+
+/* -------------------------------- Clientes -------------------------------- */
+
+catalogo_shm_t *abrirCatalogo(pid_t servidor)
+{
+    // Sin el PID del servidor (TCP) no hay cómo saber si el catálogo es suyo
+    if (servidor <= 0)
+        return NULL;
+
+    int fd = shm_open(NOMBRE_CATALOGO, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+
+    // Un segmento a medio crear todavía no tiene su tamaño
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size < (off_t)sizeof(catalogo_shm_t))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    catalogo_shm_t *catalogo = mmap(NULL, sizeof(catalogo_shm_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (catalogo == MAP_FAILED)
+        return NULL;
+
+    // Debe ser del servidor conectado: uno que quedó de un servidor anterior
+    // (o de otro servidor en el equipo) tiene datos que no son los suyos
+    if (__atomic_load_n(&catalogo->magia, __ATOMIC_ACQUIRE) != MAGIA_CATALOGO ||
+        catalogo->servidor != servidor)
+    {
+        munmap(catalogo, sizeof(catalogo_shm_t));
+        return NULL;
+    }
+
+    return catalogo;
+}
+
+void cerrarCatalogo(catalogo_shm_t *catalogo, bool publicador)
+{
+    if (publicador)
+    {
+        __atomic_store_n(&catalogo->magia, 0, __ATOMIC_RELEASE);
+        shm_unlink(NOMBRE_CATALOGO);
+    }
+
+    munmap(catalogo, sizeof(catalogo_shm_t));
+}
+
+int leerTitulo(const catalogo_shm_t *catalogo, int k, book_t copias[])
+{
+    const titulo_catalogo_t *titulo = &catalogo->titulos[k];
+    const uint32_t *secuencia = &catalogo->secuencia[titulo->primero];
+
+    // El servidor escribe un ejemplar a la vez, la espera es muy corta
+    for (int vuelta = 1; vuelta <= REINTENTOS_CATALOGO; vuelta++)
+    {
+        // Un servidor que ya no está no va a terminar su escritura
+        if (__atomic_load_n(&catalogo->magia, __ATOMIC_ACQUIRE) != MAGIA_CATALOGO)
+            return -1;
+        if (vuelta % REVISION_CATALOGO == 0 && kill(catalogo->servidor, 0) < 0 &&
+            errno == ESRCH)
+            return -1;
+
+        uint32_t antes = __atomic_load_n(secuencia, __ATOMIC_ACQUIRE);
+        if (antes & 1)
+        {
+            pausaCPU();
+            continue;
+        }
+
+        memcpy(copias, &catalogo->ejemplares[titulo->primero],
+               sizeof(book_t) * titulo->cantidad);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(secuencia, __ATOMIC_RELAXED) == antes)
+            return titulo->cantidad;
+    }
+
+    return -1;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file catalogo.h
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Catálogo de sólo lectura en memoria compartida: el servidor publica
+ * los títulos y el estado de cada ejemplar, los clientes del mismo equipo lo
+ * consultan sin enviar peticiones
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#ifndef __CATALOGO_H__
+#define __CATALOGO_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "book.h"
+#include "titulos.h"
+
+/* ----------------------------- Definiciones ----------------------------- */
+
+#define NOMBRE_CATALOGO "/bibliotecaCatalogo" /**< Segmento (shm_open), hay un solo servidor*/
+#define MAGIA_CATALOGO 0x54414342u            /**< Catálogo completo ("BCAT")*/
+#define REINTENTOS_CATALOGO 100000            /**< Vueltas esperando un título a medio escribir antes de pedirlo al servidor*/
+#define REVISION_CATALOGO 1024                /**< Cada cuántas vueltas se revisa si el servidor sigue vivo*/
+
+/* ------------------------------ Estructuras ------------------------------ */
+
+/**
+ * @struct titulo_catalogo_t
+ * @brief Título del catálogo, no cambia después de publicarlo
+ */
+typedef struct
+{
+    int ISBN;       /**< ISBN del título*/
+    short primero;  /**< Posición del primer ejemplar (también su secuencia)*/
+    short cantidad; /**< Ejemplares del título (consecutivos)*/
+} titulo_catalogo_t;
+
+/**
+ * @struct catalogo_shm_t
+ * @brief Segmento que crea el servidor: los títulos y una copia de la base de
+ * datos. Sólo el hilo auxiliar escribe, cada título tiene su propio seqlock:
+ * la secuencia es impar mientras se escribe uno de sus ejemplares y el lector
+ * repite la lectura si la encuentra impar o cambió mientras leía
+ */
+typedef struct
+{
+    uint32_t magia;  /**< MAGIA_CATALOGO cuando el servidor terminó de llenarlo*/
+    pid_t servidor;  /**< Servidor que lo publicó (el cliente lo compara con el suyo)*/
+    int n_titulos;   /**< Títulos publicados*/
+
+    titulo_catalogo_t titulos[MAX_CANT_LIBROS]; /**< Títulos en el orden de la BD*/
+    uint32_t secuencia[MAX_CANT_LIBROS];        /**< Seqlock de cada título (por su primer ejemplar)*/
+    book_t ejemplares[MAX_CANT_LIBROS];         /**< Estado de cada ejemplar (por posición en la BD)*/
+} catalogo_shm_t;
+
+/* ------------------------ Prototipos de funciones ------------------------ */
+
+/**
+ * @brief Crear el segmento y llenarlo con la base de datos (servidor)
+ *
+ * @param ejemplar Base de datos
+ * @param n_libros Ejemplares en la base de datos
+ * @param indice Índice de títulos (título de cada ejemplar)
+ * @return catalogo_shm_t* Catálogo publicado o NULL si no se pudo crear
+ */
+catalogo_shm_t *publicarCatalogo(const book_t ejemplar[],
+                                 int n_libros,
+                                 const indice_titulos_t *indice);
+
+/**
+ * @brief Copiar al catálogo un ejemplar que cambió (servidor)
+ * @note Sólo un hilo puede escribir
+ *
+ * @param catalogo Catálogo publicado
+ * @param titulo Posición del primer ejemplar del título
+ * @param posicion Posición del ejemplar en la BD
+ * @param copia Ejemplar actualizado
+ */
+void escribirEjemplar(catalogo_shm_t *catalogo,
+                      int titulo,
+                      int posicion,
+                      const book_t *copia);
+
+/**
+ * @brief Abrir en sólo lectura el catálogo del servidor con el que se habla
+ * (cliente en el mismo equipo)
+ *
+ * @param servidor PID del servidor conectado (0 si no se conoce)
+ * @return catalogo_shm_t* Catálogo o NULL si no existe, está incompleto o lo
+ * publicó otro servidor
+ */
+catalogo_shm_t *abrirCatalogo(pid_t servidor);
+
+/**
+ * @brief Dejar de usar el catálogo (el servidor borra la magia antes, así
+ * los clientes que lo tienen abierto dejan de leerlo)
+ *
+ * @param catalogo Catálogo abierto o publicado
+ * @param publicador true si lo publicó este proceso: además se elimina
+ */
+void cerrarCatalogo(catalogo_shm_t *catalogo, bool publicador);
+
+/**
+ * @brief Leer los ejemplares de un título, todos del mismo instante
+ * @note Si el servidor se cerró o murió a mitad de una escritura la secuencia
+ * queda impar para siempre: se deja de esperar después de
+ * \ref REINTENTOS_CATALOGO vueltas, o antes si la magia se borró o el
+ * servidor ya no existe
+ *
+ * @param catalogo Catálogo
+ * @param k Posición del título en catalogo->titulos
+ * @param copias RETORNA: ejemplares del título (hasta MAX_CANT_LIBROS)
+ * @return int Cantidad de ejemplares, -1 si no se pudo leer (hay que
+ * pedirlo al servidor)
+ */
+int leerTitulo(const catalogo_shm_t *catalogo, int k, book_t copias[]);
+
+#endif // __CATALOGO_H__
@@ -11,6 +11,8 @@
  */
 
 /* -------------------------------  Libraries ------------------------------- */
+#define _GNU_SOURCE // Para struct ucred (SO_PEERCRED)
+
 // ISO C libraries
 #include <stdio.h>
 #include <stdlib.h>
@@ -23,30 +25,53 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
 
 // Header propias
 #include "common.h"
 #include "client.h"
 #include "paquet.h"
 #include "book.h"
+#include "shm.h"
+#include "formato.h"
+
+/* -------------------- Variables globales (Métricas) --------------------- */
+unsigned long respuestasRecibidas = 0; /**< Respuestas recibidas del servidor*/
+unsigned long paquetesEnviados = 0;    /**< Paquetes enviados al servidor*/
+unsigned long bytesEnviados = 0;       /**< Bytes que salieron hacia el servidor*/
+unsigned long bytesRecibidos = 0;      /**< Bytes que llegaron del servidor*/
+unsigned long operacionesEnLote = 0;   /**< Operaciones enviadas dentro de un LOTE*/
+unsigned long lotesEnviados = 0;       /**< Mensajes LOTE enviados*/
+double segundosEspera = 0;             /**< Tiempo total entre cada envío y su respuesta*/
+struct timespec ultimoEnvio;           /**< Momento del último paquete enviado*/
+uint32_t ultimoId = 0;                 /**< Último identificador de petición usado*/
+unsigned long consultasLocales = 0;    /**< Búsquedas resueltas en el catálogo local*/
 
 /* --------------------------------- Main --------------------------------- */
 int main(int argc, char *argv[])
 {
     // Manejar los argumentos
     char requestFilename[TAM_STRING], // Nombre archivo
-        pipeCLNT_SRVR[TAM_STRING],    // Nombre pipe (Cliente -> Servidor)
-        pipeSRVR_CLNT[TAM_STRING];    // Nombre pipe (Servidor -> Cliente)
+        pipeCLNT_SRVR[TAM_STRING];    // Nombre pipe (Cliente -> Servidor)
 
     //? La declaración de estas variables se hace antes de la validación porque
     //? la función 'manejarArgumentos' necesita una referencia a estas variables
     //? como parámetro
 
     bool archivoUsado; // Flag para saber si un archivo está siendo usado
-    archivoUsado = manejarArgumentos(argc, argv, pipeCLNT_SRVR, requestFilename);
-
-    // Otras variables
-    int fd_pipes[2]; // FD's de los pipes
+    canal_t canal;     // Pipes o segmento con el servidor
+    archivoUsado = manejarArgumentos(argc, argv, pipeCLNT_SRVR, requestFilename,
+                                     &canal.transporte, &canal.formato,
+                                     &canal.lector);
 
     char nombreLibro[TAM_STRING]; // Buffer para Nombre del libro
     memset(nombreLibro, 0, sizeof(nombreLibro));
@@ -58,7 +83,17 @@ int main(int argc, char *argv[])
     FILE *requestsFile = NULL;
 
     // Iniciar la comunicación con el servidor
-    iniciarComunicacion(pipeCLNT_SRVR, pipeSRVR_CLNT, fd_pipes);
+    iniciarComunicacion(pipeCLNT_SRVR, &canal);
+
+    // Los préstamos quedan a nombre del lector (sin él, sólo de esta conexión)
+    if (canal.lector != SIN_LECTOR)
+        identificarLector(&canal);
+
+    // Las búsquedas se leen del catálogo si el servidor está en este equipo:
+    // sólo con un transporte local y si el catálogo es del servidor conectado
+    canal.catalogo = NULL;
+    if (canal.transporte != TRANSPORTE_TCP)
+        canal.catalogo = abrirCatalogo(canal.servidor);
 
     // Manejar el archivo
     if (archivoUsado)
@@ -73,112 +108,93 @@ int main(int argc, char *argv[])
             return ERROR_APERTURA_ARCHIVO;
         }
 
-        //1. Leer el archivo
-        struct peticion_t peticiones[MAX_CANT_LIBROS];
-        book_t libro;
-        int peticionesLeidas = 0;
+        //1. Leer el archivo línea por línea, sin límite de peticiones
+        struct peticion_t peticion;
 
-        for (int i = 0; i < MAX_CANT_LIBROS; i++)
-        {
-            fscanf(requestsFile, "%c, %[^,],%d\n",
-                   &peticiones[i].request,
-                   peticiones[i].bookName,
-                   &peticiones[i].ISBN);
+        // Peticiones enviadas que esperan su respuesta, en cualquier orden
+        ventana_t ventana;
+        memset(&ventana, 0, sizeof(ventana));
 
-            peticionesLeidas++;
-            if (feof(requestsFile))
-                break;
-        }
+        // Con el formato compacto las peticiones viajan en lotes
+        bool usarLotes = (canal.formato == FORMATO_COMPACTO);
+        lote_t *lote = NULL;
+        int tamLote = TAM_LOTE_VACIO; // Bytes del LOTE que se está armando
 
-        // Mandar al servidor todas las peticiones
-        for (int i = 0; i < peticionesLeidas; i++)
+        while (fscanf(requestsFile, "%c, %[^,],%d\n",
+                      &peticion.request,
+                      peticion.bookName,
+                      &peticion.ISBN) == 3)
         {
-            switch (peticiones[i].request)
+            // 2. Renovar y devolver aplican al ejemplar que tiene este
+            // cliente, el servidor lo conoce sin pedir el libro antes
+            operacion_t operacion;
+            memset(&operacion, 0, sizeof(operacion));
+            operacion.ISBN = peticion.ISBN;
+            strcpy(operacion.name, peticion.bookName);
+
+            if (peticion.request == 'P')
+                operacion.petition = SOLICITAR;
+            else if (peticion.request == 'R')
+                operacion.petition = RENOVAR_PROPIO;
+            else if (peticion.request == 'D')
+                operacion.petition = DEVOLVER_PROPIO;
+            else if (peticion.request == 'B')
+                operacion.petition = BUSCAR;
+            else
+                continue;
+
+            // BUSCAR viaja sola (el servidor la responde desde su caché),
+            // detrás del lote que se estaba armando para no adelantarse
+            if (operacion.petition == BUSCAR)
             {
-            case 'P': // Prestar
-                printf("\nIniciando préstamo del libro\n");
-                if (
-                    prestarLibro(
-                        fd_pipes,
-                        peticiones[i].bookName,
-                        peticiones[i].ISBN) != SUCCESS_GENERIC)
-                    printf("Operación fallida\n");
-                else
-                    printf("Operación exitosa\n");
-                break;
-
-            case 'R': // Renovar
-                printf("\nIniciando renovación del libro\n");
-                // Hay que intentar renovar por cada libro
-                libro = buscarLibro(fd_pipes,
-                                    peticiones[i].bookName,
-                                    peticiones[i].ISBN);
+                if (lote != NULL)
+                    enviarLote(&canal, &ventana, lote);
+                lote = NULL;
 
-                if (libro.petition == BUSCAR) // Si el libro no existe
-                {
-                    fprintf(stderr, "El libro no existe!\n");
-                    continue; // Saltarse la peticion
-                }
-
-                bool renovado = false;
-                for (int j = 1; j <= libro.n_copies; j++)
-                {
-                    printf("Intentando renovar ejemplar #%d", j);
-                    // Por cada ejemplar hacer el intento de renovar
-                    if (renovarLibro(fd_pipes, libro.name, libro.ISBN, j) ==
-                        SUCCESS_GENERIC)
-                    {
-                        renovado = true; // Al menos un libro fue exitoso
-                        break;
-                    }
-                }
+                paquet_t paquete = paqueteOperacion(&operacion);
+                enviarPendiente(&canal, &ventana, &paquete, &operacion, NULL);
+                continue;
+            }
 
-                if (renovado)
-                    printf("La renovación del libro fue exitosa...\n");
+            // 3. El lote sale cuando ya no cabe otra operación, su memoria
+            // pasa a la ventana hasta que llegan los resultados
+            if (lote != NULL &&
+                (lote->cantidad == MAX_LOTE ||
+                 tamLote + tamOperacion(&operacion) > TAM_MAX_MENSAJE))
+            {
+                enviarLote(&canal, &ventana, lote);
+                lote = NULL;
+            }
 
+            if (usarLotes && lote == NULL)
+            {
+                lote = (lote_t *)malloc(sizeof(lote_t));
+                if (lote == NULL)
+                    perror("Lote"); // Esta operación viaja sola
                 else
-                    fprintf(stderr, "La renovación del libro falló\n");
-
-                break;
-
-            case 'D': // Devolver un libro
-                printf("\nIniciando devolución del libro\n");
-                // Hay que intentar renovar por cada libro
-                libro = buscarLibro(fd_pipes,
-                                    peticiones[i].bookName,
-                                    peticiones[i].ISBN);
-
-                if (libro.petition == BUSCAR) // Si el libro no existe
-                {
-                    fprintf(stderr, "El libro no existe!\n");
-                    continue; // Saltarse la peticion
-                }
-
-                bool devuelto = false;
-                for (int j = 1; j <= libro.n_copies; j++)
                 {
-                    printf("Intentando devolver ejemplar #%d", j);
-                    // Por cada ejemplar hacer el intento de renovar
-                    if (devolverLibro(fd_pipes, libro.name, libro.ISBN, j) ==
-                        SUCCESS_GENERIC)
-                    {
-                        devuelto = true; // Al menos un libro fue exitoso
-                        break;
-                    }
+                    lote->cantidad = 0;
+                    tamLote = TAM_LOTE_VACIO;
                 }
+            }
 
-                if (devuelto)
-                    printf("La devolución del libro fue exitosa...\n");
+            // 4. Sin lotes: un paquete por operación, sin esperar la respuesta
+            if (lote == NULL)
+            {
+                paquet_t paquete = paqueteOperacion(&operacion);
+                enviarPendiente(&canal, &ventana, &paquete, &operacion, NULL);
+                continue;
+            }
 
-                else
-                    fprintf(stderr, "La devolución del libro falló\n");
+            lote->operaciones[lote->cantidad++] = operacion;
+            tamLote += tamOperacion(&operacion);
+        }
 
-                break;
+        // 5. Las operaciones que quedaron y las respuestas que faltan
+        if (lote != NULL)
+            enviarLote(&canal, &ventana, lote);
 
-            default:
-                break;
-            }
-        }
+        vaciarVentana(&canal, &ventana);
     }
 
     else
@@ -196,6 +212,10 @@ int main(int argc, char *argv[])
             printf("1. Pedir un libro prestado\n");
             printf("2. Renovar un libro\n");
             printf("3. Devolver un libro\n");
+            printf("4. Ver mis préstamos\n");
+            printf("5. Reservar un libro\n");
+            printf("6. Pedir varios libros (todos o ninguno)\n");
+            printf("7. Buscar libros\n");
             printf("0. Salir\n");
             printf("Seleccione una opción: ");
 
@@ -218,7 +238,7 @@ int main(int argc, char *argv[])
                 printf("Digite el ISBN del libro: ");
                 fgets(ISBNstr, sizeof(ISBNstr), stdin);
 
-                if (prestarLibro(fd_pipes, nombreLibro, atoi(ISBNstr)) != SUCCESS_GENERIC)
+                if (prestarLibro(&canal, nombreLibro, atoi(ISBNstr)) != SUCCESS_GENERIC)
                     printf("Operación fallida\n");
                 else
                     printf("Operación exitosa\n");
@@ -234,11 +254,11 @@ int main(int argc, char *argv[])
                 printf("Digite el ISBN del libro: ");
                 fgets(ISBNstr, sizeof(ISBNstr), stdin);
 
-                printf("Digite el número de ejemplar: ");
+                printf("Digite el número de ejemplar (0 = el que tengo): ");
                 scanf("%d", &n_ejemplar);
                 (void)getchar();
 
-                if (renovarLibro(fd_pipes, nombreLibro, atoi(ISBNstr), n_ejemplar) !=
+                if (renovarLibro(&canal, nombreLibro, atoi(ISBNstr), n_ejemplar) !=
                     SUCCESS_GENERIC)
                     printf("Operación fallida\n");
                 else
@@ -255,11 +275,11 @@ int main(int argc, char *argv[])
                 printf("Digite el ISBN del libro: ");
                 fgets(ISBNstr, sizeof(ISBNstr), stdin);
 
-                printf("Digite el número de ejemplar: ");
+                printf("Digite el número de ejemplar (0 = el que tengo): ");
                 scanf("%d", &n_ejemplar);
                 (void)getchar();
 
-                if (devolverLibro(fd_pipes, nombreLibro, atoi(ISBNstr), n_ejemplar) !=
+                if (devolverLibro(&canal, nombreLibro, atoi(ISBNstr), n_ejemplar) !=
                     SUCCESS_GENERIC)
                     printf("Operación fallida\n");
                 else
@@ -267,6 +287,110 @@ int main(int argc, char *argv[])
 
                 break;
 
+            case 4:
+                // Ver los ejemplares que tiene este cliente
+                if (misPrestamos(&canal) != SUCCESS_GENERIC)
+                    printf("Operación fallida\n");
+
+                break;
+
+            case 5:
+                // Reservar un libro (espera hasta que haya un ejemplar)
+                printf("Digite el nombre del libro: ");
+                fgets(nombreLibro, sizeof(nombreLibro), stdin);
+                nombreLibro[strcspn(nombreLibro, "\r\n")] = 0;
+
+                printf("Digite el ISBN del libro: ");
+                fgets(ISBNstr, sizeof(ISBNstr), stdin);
+
+                if (reservarLibro(&canal, nombreLibro, atoi(ISBNstr)) != SUCCESS_GENERIC)
+                    printf("Operación fallida\n");
+                else
+                    printf("Operación exitosa\n");
+
+                break;
+
+            case 6:
+            {
+                // Pedir prestados varios libros a la vez
+                lote_t transaccion;
+                transaccion.cantidad = 0;
+
+                while (transaccion.cantidad < MAX_LOTE)
+                {
+                    printf("Digite el nombre del libro (vacío para terminar): ");
+                    fgets(nombreLibro, sizeof(nombreLibro), stdin);
+                    nombreLibro[strcspn(nombreLibro, "\r\n")] = 0;
+
+                    if (nombreLibro[0] == '\0')
+                        break;
+
+                    printf("Digite el ISBN del libro: ");
+                    fgets(ISBNstr, sizeof(ISBNstr), stdin);
+
+                    operacion_t *operacion =
+                        &transaccion.operaciones[transaccion.cantidad++];
+                    memset(operacion, 0, sizeof(*operacion));
+                    operacion->petition = SOLICITAR;
+                    operacion->ISBN = atoi(ISBNstr);
+                    strcpy(operacion->name, nombreLibro);
+                }
+
+                if (prestarVarios(&canal, &transaccion) != SUCCESS_GENERIC)
+                    printf("Operación fallida\n");
+                else
+                    printf("Operación exitosa\n");
+
+                break;
+            }
+
+            case 7:
+            {
+                // Buscar por ISBN (sus ejemplares), parte del nombre, prefijo
+                // o palabra
+                printf("Buscar: 1 = nombre que contiene, 2 = nombre que empieza por, "
+                       "3 = palabra, 4 = nombre parecido: ");
+                fgets(ISBNstr, sizeof(ISBNstr), stdin);
+
+                enum BOOK_REQUEST_T tipo = BUSCAR_TODOS;
+                if (atoi(ISBNstr) == 2)
+                    tipo = BUSCAR_PREFIJO;
+                else if (atoi(ISBNstr) == 3)
+                    tipo = BUSCAR_PALABRA;
+                else if (atoi(ISBNstr) == 4)
+                    tipo = BUSCAR_PARECIDOS;
+
+                printf("Digite el texto a buscar (vacío para todos): ");
+                fgets(nombreLibro, sizeof(nombreLibro), stdin);
+                nombreLibro[strcspn(nombreLibro, "\r\n")] = 0;
+
+                strcpy(ISBNstr, "0");
+                if (tipo == BUSCAR_TODOS)
+                {
+                    printf("Digite el ISBN del libro (0 = buscar por nombre): ");
+                    fgets(ISBNstr, sizeof(ISBNstr), stdin);
+                }
+
+                // Una página a la vez, mientras el usuario quiera ver más
+                int cursor = 0;
+                char respuesta[TAM_STRING];
+                do
+                {
+                    cursor = buscarPagina(&canal, tipo, nombreLibro, atoi(ISBNstr),
+                                          cursor);
+                    if (cursor <= 0)
+                        break;
+
+                    printf("¿Ver más resultados? (s/n): ");
+                    fgets(respuesta, sizeof(respuesta), stdin);
+                } while (respuesta[0] == 's' || respuesta[0] == 'S');
+
+                if (cursor < 0)
+                    printf("Operación fallida\n");
+
+                break;
+            }
+
             default:
                 printf("Opción incorrecta...\n");
                 break;
@@ -284,7 +408,11 @@ int main(int argc, char *argv[])
         }
 
     // Cerrar la comunicacion
-    detenerComunicacion(fd_pipes, pipeSRVR_CLNT);
+    detenerComunicacion(&canal);
+    mostrarMetricas(&canal);
+
+    if (canal.catalogo != NULL)
+        cerrarCatalogo(canal.catalogo, false);
 
     // Notificar
     fprintf(stdout, "\nCliente finaliza correctamente\n");
@@ -297,110 +425,250 @@ int main(int argc, char *argv[])
 
 void mostrarUso(void)
 {
-    fprintf(stderr, "Uso: ./client [-i Archivo] -p NombreDelPipe\n");
-    fprintf(stderr, "[-i archivo] es opcional!\n");
+    fprintf(stderr, "Uso: ./client [-i Archivo] -p NombreDelPipe [-t fifo|shm|unix|tcp]"
+                    " [-f compacto|clasico] [-c NumeroLector]\n");
+    fprintf(stderr, "[-i archivo], [-t transporte], [-f formato] y [-c lector] son opcionales!\n");
+    fprintf(stderr, "Con '-c' los préstamos se guardan a nombre del lector (1 a %d)\n",
+            MAX_LECTOR);
+    fprintf(stderr, "Con '-t unix' el flag -p es la ruta del socket del servidor\n");
+    fprintf(stderr, "Con '-t tcp' el flag -p es host:puerto del servidor\n");
     exit(ERROR_ARG_NOVAL);
 }
 
-bool manejarArgumentos(int argc, char *argv[], char *pipeNom, char *fileNom)
+bool manejarArgumentos(int argc,
+                       char *argv[],
+                       char *pipeNom,
+                       char *fileNom,
+                       int *transporte,
+                       int *formato,
+                       int *lector)
 {
-    // Flags para saber si ya se usaron los argumentos -i -p y si el archivo
+    // Flags para saber si ya se usaron los argumentos -i -p -t y si el archivo
     // fue abierto con -i
 
     bool argArchivo = false;
     bool argNombrePipe = false;
+    bool argTransporte = false;
+    bool argFormato = false;
+    bool argLector = false;
     bool archivoUsado = false;
 
-    // Saber cómo reaccionar antes determinado número de argumentos
-    switch (argc)
+    // Valor por defecto del transporte y del formato
+    *transporte = TRANSPORTE_FIFO;
+    *formato = FORMATO_COMPACTO;
+    *lector = SIN_LECTOR;
+
+    // Cada argumento va acompañado de su valor
+    if (argc < 3 || argc % 2 == 0)
+        mostrarUso();
+
+    // Filtrar los argumentos
+    while ((argc > 1) && (argv[1][0] == '-'))
     {
-    case 3: // Sólo se usó el argumento -p
-        if (argv[1][0] == '-' && argv[1][1] == 'p')
-            // Retornar el nombre del pipe (recortado sin el -p)
+        // Por cada flag
+        switch (argv[1][1])
+        {
+        case 'i': // Caso de archivo
+            // Verificar si ya se usó el argumento
+            if (argArchivo)
+            {
+                fprintf(stderr,
+                        "El argumento %s ya fue utilizado!\n", argv[1]);
+                mostrarUso();
+            }
+
+            // El argumento ya fue utilizado!
+            argArchivo = true;
+            // Un archivo fue utilizado
+            archivoUsado = true;
+
+            // retornar el nombre de archivo
+            strcpy(fileNom, argv[2]);
+
+            break;
+
+        case 'p':
+
+            // Verificar si ya se usó el argumento
+            if (argNombrePipe)
+            {
+                fprintf(stderr,
+                        "El argumento %s ya fue utilizado!\n", argv[1]);
+                mostrarUso();
+            }
+
+            // El argumento ya fue utilizado!
+            argNombrePipe = true;
+
+            // Retornar el nombre del pipe
             strcpy(pipeNom, argv[2]);
 
-        else // Argumentos incorrectos
-            mostrarUso();
+            break;
 
-        break;
+        case 't':
 
-    case 5: // Se utilizaron -i y -p
+            // Verificar si ya se usó el argumento
+            if (argTransporte)
+            {
+                fprintf(stderr,
+                        "El argumento %s ya fue utilizado!\n", argv[1]);
+                mostrarUso();
+            }
 
-        // Filtrar los argumentos
-        while ((argc > 1) && (argv[1][0] == '-'))
-        {
-            // Por cada flag
-            switch (argv[1][1])
+            argTransporte = true;
+
+            if (strcmp(argv[2], "fifo") == 0)
+                *transporte = TRANSPORTE_FIFO;
+            else if (strcmp(argv[2], "shm") == 0)
+                *transporte = TRANSPORTE_SHM;
+            else if (strcmp(argv[2], "unix") == 0)
+                *transporte = TRANSPORTE_UNIX;
+            else if (strcmp(argv[2], "tcp") == 0)
+                *transporte = TRANSPORTE_TCP;
+            else
             {
-            case 'i': // Caso de archivo
-                // Verificar si ya se usó el argumento
-                if (argArchivo)
-                {
-                    fprintf(stderr,
-                            "El argumento %s ya fue utilizado!\n", argv[1]);
-                    mostrarUso();
-                }
+                fprintf(stderr, "Transporte no válido: %s\n", argv[2]);
+                mostrarUso();
+            }
 
-                // El argumento ya fue utilizado!
-                argArchivo = true;
-                // Un archivo fue utilizado
-                archivoUsado = true;
+            break;
 
-                // retornar el nombre de archivo
-                strcpy(fileNom, argv[2]);
+        case 'f':
 
-                break;
+            // Verificar si ya se usó el argumento
+            if (argFormato)
+            {
+                fprintf(stderr,
+                        "El argumento %s ya fue utilizado!\n", argv[1]);
+                mostrarUso();
+            }
 
-            case 'p':
+            argFormato = true;
 
-                // Verificar si ya se usó el argumento
-                if (argNombrePipe)
-                {
-                    fprintf(stderr,
-                            "El argumento %s ya fue utilizado!\n", argv[1]);
-                    mostrarUso();
-                }
+            // El compacto se propone, el servidor decide
+            if (strcmp(argv[2], "compacto") == 0)
+                *formato = FORMATO_COMPACTO;
+            else if (strcmp(argv[2], "clasico") == 0)
+                *formato = FORMATO_CLASICO;
+            else
+            {
+                fprintf(stderr, "Formato no válido: %s\n", argv[2]);
+                mostrarUso();
+            }
 
-                // El argumento ya fue utilizado!
-                argNombrePipe = true;
+            break;
 
-                // Retornar el nombre del pipe
-                strcpy(pipeNom, argv[2]);
+        case 'c':
 
-                break;
+            // Verificar si ya se usó el argumento
+            if (argLector)
+            {
+                fprintf(stderr,
+                        "El argumento %s ya fue utilizado!\n", argv[1]);
+                mostrarUso();
+            }
 
-            default:
-                fprintf(stderr, "Argumento no válido: %s\n", argv[1]);
+            argLector = true;
+
+            char *fin;
+            long numero = strtol(argv[2], &fin, 10);
+            if (*fin != '\0' || numero <= SIN_LECTOR || numero > MAX_LECTOR)
+            {
+                fprintf(stderr, "Número de lector no válido: %s\n", argv[2]);
                 mostrarUso();
             }
+            *lector = (int)numero;
 
-            argv += 2; // Mover el puntero de argumentos
-            argc -= 2; // Reducir cantidad de argumentos para el while
+            break;
+
+        default:
+            fprintf(stderr, "Argumento no válido: %s\n", argv[1]);
+            mostrarUso();
         }
 
-        break;
+        argv += 2; // Mover el puntero de argumentos
+        argc -= 2; // Reducir cantidad de argumentos para el while
+    }
 
-    default:
+    // El nombre del pipe es obligatorio
+    if (argc != 1 || !argNombrePipe)
         mostrarUso();
-        break;
-    }
 
     return archivoUsado;
 }
 
 // Protocolos de comunicación
 
-void iniciarComunicacion(
-    const char *pipeCLNT_SRVR,
-    char *pipeSRVR_CLNT,
-    int *pipe)
+void iniciarComunicacion(const char *pipeCLNT_SRVR, canal_t *canal)
 {
     // Notificar
     fprintf(stdout, "\n(%d) Intentando establecer conexión\n", getpid());
 
-    // int *pipe Arreglo con los fd de los pipes
+    // canal->pipe Arreglo con los fd de los pipes
     // pipe[WRITE] tiene el pipe de escritura (Cliente -> Servidor)
     // pipe[READ] tiene el pipe de lectura (Servidor -> Cliente)
+    int *pipe = canal->pipe;
+    pipe[READ] = -1;
+    canal->shm = NULL;
+    canal->n_entrada = 0;
+    canal->servidor = 0;
+    memset(canal->nombre, 0, sizeof(canal->nombre));
+
+    // Hasta que el servidor acepte otro formato todo viaja como paquet_t, los
+    // anillos de memoria compartida siempre son de paquet_t
+    int formatoPropuesto =
+        (canal->transporte == TRANSPORTE_SHM) ? FORMATO_CLASICO : canal->formato;
+    canal->formato = FORMATO_CLASICO;
+
+    // Con socket Unix la conexión es un único connect()
+    if (canal->transporte == TRANSPORTE_UNIX)
+    {
+        pipe[WRITE] = -1;
+        if (conectarSocket(pipeCLNT_SRVR, canal) != SUCCESS_GENERIC)
+        {
+            perror("Error de comunicación con el servidor"); // Manejar error
+            exit(ERROR_PIPE_SRVR_CLNT);
+        }
+
+        // Notificación
+        fprintf(stdout, "Notificación: Comunicación establecida por socket!\n");
+
+        if (formatoPropuesto == FORMATO_COMPACTO)
+            acordarFormato(canal);
+        return;
+    }
+
+    // Con TCP el servidor asigna el identificador y confirma (o rechaza si
+    // ya no hay cupo) apenas acepta la conexión
+    if (canal->transporte == TRANSPORTE_TCP)
+    {
+        pipe[WRITE] = -1;
+        if (conectarTCP(pipeCLNT_SRVR, canal) != SUCCESS_GENERIC)
+        {
+            perror("Error de comunicación con el servidor"); // Manejar error
+            exit(ERROR_PIPE_SRVR_CLNT);
+        }
+
+        fprintf(stdout, "Notificación: Esperando respuesta del Servidor\n");
+
+        paquet_t confirmacion;
+        struct pollfd pfd = {pipe[READ], POLLIN, 0};
+        if (poll(&pfd, 1, TIMEOUT_COMUNICACION * 1000) <= 0 ||
+            leerTrama(pipe[READ], &confirmacion) <= 0 ||
+            confirmacion.type != SIGNAL ||
+            confirmacion.data.signal.code != SUCCEED_COM)
+        {
+            fprintf(stderr, "El servidor rechazó la conexión TCP\n");
+            cerrarCanal(canal);
+            exit(ERROR_COMUNICACION);
+        }
+
+        fprintf(stdout, "Notificación: Comunicación establecida por TCP!\n");
+
+        if (formatoPropuesto == FORMATO_COMPACTO)
+            acordarFormato(canal);
+        return;
+    }
 
     //!1 Cliente abre el pipe (Cliente->Servidor) para ESCRITURA
 
@@ -414,45 +682,60 @@ void iniciarComunicacion(
     // Notificar
     fprintf(stdout, "Notificación: El pipe (Cliente->Servidor) fue abierto\n");
 
-    //!2 Cliente crea un pipe (Servidor->Cliente)
-    /* Crear el nombre del pipe, para esto se toma el macro PIPE_NOM_CLNT y se
-       le concatena el pid del proceso Cliente quien lo crea */
-
     pid_t client_pid = getpid();
 
-    // 2.1 Borrar los contenidos actuales de pipeSRVR_CLNT
-    memset(pipeSRVR_CLNT, 0, sizeof(pipeSRVR_CLNT));
+    //!2 Cliente crea un pipe (Servidor->Cliente) o un segmento compartido
+    if (canal->transporte == TRANSPORTE_SHM)
+    {
+        if (crearSegmento(canal) != SUCCESS_GENERIC)
+        {
+            perror("Error de conexión con el servidor"); // Manejar Error
+            cerrarCanal(canal);
+            exit(ERROR_PIPE_CLNT_SRVR);
+        }
+
+        //Notificación
+        fprintf(stdout, "Notificación: El segmento compartido fue creado\n");
+    }
+    else
+    {
+        /* Crear el nombre del pipe, para esto se toma el macro PIPE_NOM_CLNT y se
+           le concatena el pid del proceso Cliente quien lo crea */
 
-    // 2.2 Copiar la macro a la variable
-    strcpy(pipeSRVR_CLNT, PIPE_TITLE_CLNT);
+        // 2.1 Copiar la macro a la variable
+        strcpy(canal->nombre, PIPE_TITLE_CLNT);
 
-    // 2.3 Concatenar el pid
-    char buffer[TAM_STRING];
-    sprintf(buffer, "%d", client_pid);
-    strcat(pipeSRVR_CLNT, buffer);
+        // 2.2 Concatenar el pid
+        char buffer[TAM_STRING];
+        sprintf(buffer, "%d", client_pid);
+        strcat(canal->nombre, buffer);
 
-    // Ya se tiene el nombre disponible para crear el pipe de LECTURA
+        // Ya se tiene el nombre disponible para crear el pipe de LECTURA
 
-    // Crear el pipe nominal
-    unlink(pipeSRVR_CLNT);
-    if (mkfifo(pipeSRVR_CLNT, PERMISOS_PIPE) < 0)
-    {
-        perror("Error de conexión con el servidor"); // Manejar Error
+        // Crear el pipe nominal
+        unlink(canal->nombre);
+        if (mkfifo(canal->nombre, PERMISOS_PIPE) < 0)
+        {
+            perror("Error de conexión con el servidor"); // Manejar Error
 
-        // Cerrar recursos abiertos
-        close(pipe[WRITE]);
-        exit(ERROR_PIPE_CLNT_SRVR);
-    }
+            // Cerrar recursos abiertos
+            close(pipe[WRITE]);
+            exit(ERROR_PIPE_CLNT_SRVR);
+        }
 
-    //Notificación
-    fprintf(stdout, "Notificación: El pipe (Servidor->Cliente) fue creado\n");
+        //Notificación
+        fprintf(stdout, "Notificación: El pipe (Servidor->Cliente) fue creado\n");
+    }
 
     //!5 Cliente envía a Servidor el nombre del pipe (Servidor->Cliente)
     paquet_t com;                                  // Estructura a enviar por el pipe
     com.client = client_pid;                       // PID quien envía
     com.type = SIGNAL;                             // Tipo de dato
-    com.data.signal.code = START_COM;              // Tipo de señal
-    strcpy(com.data.signal.buffer, pipeSRVR_CLNT); // Nombre del pipe
+    com.data.signal.code =                         // Tipo de señal
+        (canal->transporte == TRANSPORTE_SHM) ? START_SHM : START_COM;
+    strcpy(com.data.signal.buffer, canal->nombre); // Nombre del pipe
+    com.data.signal.version =                      // Formato propuesto
+        (formatoPropuesto == FORMATO_COMPACTO) ? VERSION_COMPACTA : 0;
 
     // Intentar enviar los datos
     int aux = 0, attemps = 0;
@@ -471,8 +754,7 @@ void iniciarComunicacion(
                 fprintf(stderr, "Demasiados intentos, abortando...\n");
 
                 // Cerrar los archivos abiertos
-                close(pipe[WRITE]);
-                unlink(pipeSRVR_CLNT);
+                cerrarCanal(canal);
 
                 // Terminar
                 exit(ERROR_ESCRITURA);
@@ -491,19 +773,21 @@ void iniciarComunicacion(
     //? Este pipe se abre en modo O_NONBLOCK porque puede
     //? recibir confirmaciones asíncronas
 
-    pipe[READ] = open(pipeSRVR_CLNT, O_RDONLY);
-    if (pipe[READ] < 0)
+    if (canal->transporte == TRANSPORTE_FIFO)
     {
-        perror("Error de conexión con el servidor"); // Manejar Error
+        pipe[READ] = open(canal->nombre, O_RDONLY);
+        if (pipe[READ] < 0)
+        {
+            perror("Error de conexión con el servidor"); // Manejar Error
 
-        // Cerrar recursos abiertos
-        close(pipe[WRITE]);
-        unlink(pipeSRVR_CLNT);
-        exit(ERROR_PIPE_CLNT_SRVR);
-    }
+            // Cerrar recursos abiertos
+            cerrarCanal(canal);
+            exit(ERROR_PIPE_CLNT_SRVR);
+        }
 
-    //Notificación
-    fprintf(stdout, "Notificación: El pipe (Servidor->Cliente) fue abierto\n");
+        //Notificación
+        fprintf(stdout, "Notificación: El pipe (Servidor->Cliente) fue abierto\n");
+    }
 
     //!8. Cliente espera una señal de Servidor
 
@@ -515,8 +799,14 @@ void iniciarComunicacion(
     // Notificación
     fprintf(stdout, "Notificación: Esperando respuesta del Servidor\n");
 
+    // Con memoria compartida el servidor puede no haber mapeado el segmento
+    // todavía, así que no se duerme en el anillo sino que se revisa cada poco
+    struct timespec intervalo = {0, INTERVALO_CONEXION_SHM_MS * 1000000L};
+
     paquet_t expect; // Estructura que se espera
-    while (read(pipe[READ], &expect, sizeof(expect)) == 0)
+    while ((canal->transporte == TRANSPORTE_SHM)
+               ? !anilloLeer(&canal->shm->respuestas, &expect)
+               : leerMensaje(canal, &expect) == 0)
     {
         // Obtener el momento actual
         gettimeofday(&now, NULL);
@@ -529,21 +819,24 @@ void iniciarComunicacion(
                     TIMEOUT_COMUNICACION);
 
             // Cerrar los recursos abiertos
-            close(pipe[READ]);
-            close(pipe[WRITE]);
-            unlink(pipeSRVR_CLNT);
+            cerrarCanal(canal);
 
             exit(ERROR_COMUNICACION);
         }
+
+        if (canal->transporte == TRANSPORTE_SHM)
+            nanosleep(&intervalo, NULL);
     }
 
+    // El servidor ya tiene el segmento mapeado, el nombre ya no hace falta
+    if (canal->transporte == TRANSPORTE_SHM)
+        shm_unlink(canal->nombre);
+
     // Si hay una comunicación fallida
     if (expect.data.signal.code == FAILED_COM)
     {
         // Cerrar los recursos abiertos
-        close(pipe[READ]);
-        close(pipe[WRITE]);
-        unlink(pipeSRVR_CLNT);
+        cerrarCanal(canal);
 
         // Terminar el programa
         perror("Comunicacion");
@@ -553,6 +846,11 @@ void iniciarComunicacion(
     // Señal de verificación
     else if (expect.data.signal.code == SUCCEED_COM) // Confirmación exitosa
     {
+        // La confirmación trae la versión que aceptó el servidor y su PID
+        if (expect.data.signal.version == VERSION_COMPACTA)
+            canal->formato = FORMATO_COMPACTO;
+        canal->servidor = (pid_t)atoi(expect.data.signal.buffer);
+
         // Notificación
         fprintf(stdout,
                 "Notificación: Comunicación establecida!\n");
@@ -563,74 +861,762 @@ void iniciarComunicacion(
     fprintf(stderr, "Respuesta inesperada: %d\n", expect.data.signal.code);
 }
 
-static void detenerComunicacion(int *pipe, char *pipeSRVR_CLNT)
+int conectarSocket(const char *rutaSocket, canal_t *canal)
 {
-    // Notificar
-    fprintf(stdout, "\n(%d) Intentando detener conexión\n", getpid());
+    struct sockaddr_un direccion;
+    memset(&direccion, 0, sizeof(direccion));
+    direccion.sun_family = AF_UNIX;
 
-    //!1. Cliente manda una petición de terminación de comunicación al Servidor
-    paquet_t packet = generarSenal(getpid(), STOP_COM, NULL);
+    if (strlen(rutaSocket) >= sizeof(direccion.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return ERROR_PIPE_CLNT_SRVR;
+    }
+    strcpy(direccion.sun_path, rutaSocket);
 
-    // Notificar
-    fprintf(stdout, "Intentando cerrar comunicación\n");
+    // SOCK_SEQPACKET conserva los límites: cada write es un paquete completo
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return ERROR_PIPE_CLNT_SRVR;
 
-    if (write(pipe[WRITE], &packet, sizeof(packet)) < 0)
-        perror("Escritura");
-    // NO se termina el proceso, para que así elimine el pipe
-    // Sólo se intenta escribir indeterminadamente
+    if (connect(fd, (struct sockaddr *)&direccion, sizeof(direccion)) < 0)
+    {
+        close(fd);
+        return ERROR_PIPE_CLNT_SRVR;
+    }
 
-    paquet_t tmp;
-    //!4. Cliente espera a que se cierre el pipe
-    while (read(pipe[READ], &tmp, sizeof(tmp)) != 0)
-        ;
+    // Un mismo descriptor para ambos sentidos
+    canal->pipe[READ] = canal->pipe[WRITE] = fd;
+    strcpy(canal->nombre, rutaSocket);
 
-    // Notificar
-    fprintf(stdout, "Esperando que el servidor cierre comunicación\n");
+    // El kernel dice qué proceso aceptó la conexión (para el catálogo local)
+    struct ucred credenciales;
+    socklen_t tam = sizeof(credenciales);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credenciales, &tam) == 0)
+        canal->servidor = credenciales.pid;
 
-    //!5. Cliente cierra la lectura del pipe (Servidor->Cliente)
-    close(pipe[READ]);
-    // Notificar
-    fprintf(stdout, "Se cerró el pipe (Servidor->Cliente)\n");
+    return SUCCESS_GENERIC;
+}
 
-    //!6. Cliente elimina el pipe (Servidor->Cliente)
-    unlink(pipeSRVR_CLNT);
-    // Notificar
-    fprintf(stdout, "Se eliminó el pipe (Servidor->Cliente)\n");
+int conectarTCP(const char *direccion, canal_t *canal)
+{
+    //! 1. Separar host y puerto (el último ':', así sirve "::1:5000")
+    const char *separador = strrchr(direccion, ':');
+    if (separador == NULL || separador == direccion)
+    {
+        errno = EINVAL;
+        return ERROR_PIPE_CLNT_SRVR;
+    }
 
-    //!7. Cliente cierra la escritura del pipe (Cliente->Servidor)
-    close(pipe[WRITE]);
-    // Notificar
-    fprintf(stdout, "Se cerró el pipe (Cliente->Servidor)\n");
+    char host[TAM_STRING];
+    snprintf(host, sizeof(host), "%.*s", (int)(separador - direccion), direccion);
 
-    //!8. El proceso Cliente finaliza
-    // Esto se hace desde el main
-    // Notificar
-    fprintf(stdout, "Comunicación terminada\n");
+    struct addrinfo pistas, *resultados;
+    memset(&pistas, 0, sizeof(pistas));
+    pistas.ai_family = AF_UNSPEC;
+    pistas.ai_socktype = SOCK_STREAM;
+
+    int error = getaddrinfo(host, separador + 1, &pistas, &resultados);
+    if (error != 0)
+    {
+        fprintf(stderr, "TCP: %s\n", gai_strerror(error));
+        errno = EHOSTUNREACH;
+        return ERROR_PIPE_CLNT_SRVR;
+    }
+
+    //! 2. Conectarse a la primera dirección que responda
+    int fd = -1;
+    for (struct addrinfo *r = resultados; r != NULL && fd < 0; r = r->ai_next)
+    {
+        fd = socket(r->ai_family, r->ai_socktype | SOCK_CLOEXEC, r->ai_protocol);
+        if (fd >= 0 && connect(fd, r->ai_addr, r->ai_addrlen) < 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(resultados);
+
+    if (fd < 0)
+        return ERROR_PIPE_CLNT_SRVR;
+
+    // Cada petición es una trama pequeña que no debe esperar a Nagle
+    int uno = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));
+
+    // Un mismo descriptor para ambos sentidos
+    canal->pipe[READ] = canal->pipe[WRITE] = fd;
+    strcpy(canal->nombre, direccion);
+
+    return SUCCESS_GENERIC;
 }
 
-paquet_t generarSenal(pid_t dest, int code, char *buffer)
+int escribirTrama(int fd, paquet_t *paquete, int formato)
 {
-    // Paquet creation
-    paquet_t packet;
-    packet.client = dest;
-    packet.type = SIGNAL;
+    unsigned char trama[TAM_TRAMA_TCP];
+    int tam = TAM_CABECERA_TCP +
+              codificarPaquete(paquete, formato, trama + TAM_CABECERA_TCP);
 
-    // Signal construction
-    packet.data.signal.code = code;
-    if (buffer != NULL)
-        strcpy(packet.data.signal.buffer, buffer);
-    return packet;
-}
+    uint32_t longitud = htonl(tam - TAM_CABECERA_TCP);
+    memcpy(trama, &longitud, TAM_CABECERA_TCP);
 
-// Manipular libros
+    // Un stream puede aceptar sólo parte de la trama
+    for (int escritos = 0; escritos < tam;)
+    {
+        ssize_t n = send(fd, trama + escritos, tam - escritos, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        escritos += n;
+    }
+
+    return tam;
+}
 
-int prestarLibro(int *pipes, const char *nombreLibro, int ISBN)
+int leerTrama(int fd, paquet_t *paquete)
 {
-    // Notificación
-    printf("\nSe está enviando una solicitud al servidor\n");
+    unsigned char trama[TAM_TRAMA_TCP];
 
-    // Libro a enviar al servidor
-    book_t libro;
+    // Y entregar la trama en varios pedazos: primero la longitud y después
+    // el mensaje que anuncia
+    int esperado = TAM_CABECERA_TCP;
+    for (int leidos = 0; leidos < esperado;)
+    {
+        ssize_t n = read(fd, trama + leidos, esperado - leidos);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return n;
+        leidos += n;
+
+        if (leidos == TAM_CABECERA_TCP)
+        {
+            uint32_t longitud;
+            memcpy(&longitud, trama, TAM_CABECERA_TCP);
+            longitud = ntohl(longitud);
+            if (longitud == 0 || longitud > TAM_MAX_MENSAJE)
+            {
+                errno = EPROTO;
+                return -1;
+            }
+            esperado += longitud;
+        }
+    }
+
+    // El mensaje debe ocupar exactamente la trama
+    if (decodificarPaquete(trama + TAM_CABECERA_TCP, esperado - TAM_CABECERA_TCP,
+                           paquete) != esperado - TAM_CABECERA_TCP)
+    {
+        errno = EPROTO;
+        return -1;
+    }
+
+    return esperado;
+}
+
+void acordarFormato(canal_t *canal)
+{
+    // La propuesta viaja como paquet_t: el servidor todavía no sabe qué habla
+    paquet_t propuesta = generarSenal(getpid(), START_COM, NULL);
+    propuesta.data.signal.version = VERSION_COMPACTA;
+
+    paquet_t confirmacion;
+    struct pollfd pfd = {canal->pipe[READ], POLLIN, 0};
+    unsigned long enviados = bytesEnviados, recibidos = bytesRecibidos;
+
+    if (enviarPaquete(canal, &propuesta) < 0 ||
+        poll(&pfd, 1, TIMEOUT_NEGOCIACION_MS) <= 0 ||
+        recibirPaquete(canal, &confirmacion) <= 0)
+    {
+        fprintf(stderr, "El servidor no acordó el formato, se usa el clásico\n");
+        return;
+    }
+
+    // No cuentan como petición y respuesta
+    paquetesEnviados--;
+    respuestasRecibidas--;
+    bytesEnviados = enviados;
+    bytesRecibidos = recibidos;
+
+    if (confirmacion.type == SIGNAL &&
+        confirmacion.data.signal.code == SUCCEED_COM &&
+        confirmacion.data.signal.version == VERSION_COMPACTA)
+        canal->formato = FORMATO_COMPACTO;
+}
+
+void identificarLector(canal_t *canal)
+{
+    char numero[TAM_STRING];
+    sprintf(numero, "%d", canal->lector);
+    paquet_t identificacion = generarSenal(getpid(), LECTOR, numero);
+
+    unsigned long enviados = bytesEnviados;
+    if (enviarPaquete(canal, &identificacion) < 0)
+    {
+        perror("Error al escribir");
+        fprintf(stderr, "Los préstamos no quedarán a nombre del lector %d\n",
+                canal->lector);
+    }
+
+    // No cuenta como petición
+    paquetesEnviados--;
+    bytesEnviados = enviados;
+}
+
+int leerMensaje(canal_t *canal, paquet_t *paquete)
+{
+    while (true)
+    {
+        //! 1. Un mensaje completo de una lectura anterior
+        if (canal->n_entrada > 0)
+        {
+            int usado = decodificarPaquete(canal->entrada, canal->n_entrada, paquete);
+            if (usado < 0)
+            {
+                errno = EPROTO;
+                return -1;
+            }
+
+            if (usado > 0)
+            {
+                canal->n_entrada -= usado;
+                memmove(canal->entrada, canal->entrada + usado, canal->n_entrada);
+                return usado;
+            }
+        }
+
+        //! 2. Leer lo que haya, cada write del servidor es un mensaje completo
+        ssize_t leido = read(canal->pipe[READ], canal->entrada + canal->n_entrada,
+                             TAM_ENTRADA_CLIENTE - canal->n_entrada);
+        if (leido <= 0)
+            return leido;
+
+        canal->n_entrada += leido;
+    }
+}
+
+int crearSegmento(canal_t *canal)
+{
+    nombreSegmento(getpid(), canal->nombre);
+
+    // Sólo el dueño puede abrirlo (igual que el pipe)
+    shm_unlink(canal->nombre);
+    int fd = shm_open(canal->nombre, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+        return ERROR_MEMORY;
+
+    if (ftruncate(fd, sizeof(segmento_shm_t)) < 0)
+    {
+        close(fd);
+        shm_unlink(canal->nombre);
+        return ERROR_MEMORY;
+    }
+
+    void *mapa = mmap(NULL, sizeof(segmento_shm_t), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapa == MAP_FAILED)
+    {
+        shm_unlink(canal->nombre);
+        return ERROR_MEMORY;
+    }
+
+    // ftruncate deja el segmento en ceros (anillos vacíos), la magia indica
+    // al servidor que el segmento está listo
+    canal->shm = (segmento_shm_t *)mapa;
+    __atomic_store_n(&canal->shm->magia, MAGIA_SHM, __ATOMIC_RELEASE);
+
+    return SUCCESS_GENERIC;
+}
+
+void cerrarCanal(canal_t *canal)
+{
+    if (canal->pipe[READ] >= 0)
+        close(canal->pipe[READ]);
+    if (canal->pipe[WRITE] >= 0 && canal->pipe[WRITE] != canal->pipe[READ])
+        close(canal->pipe[WRITE]);
+
+    if (canal->transporte == TRANSPORTE_SHM)
+    {
+        shm_unlink(canal->nombre); // Puede que ya no exista
+        if (canal->shm != NULL)
+            munmap(canal->shm, sizeof(segmento_shm_t));
+    }
+    // El socket es del servidor, no se elimina
+    else if (canal->transporte == TRANSPORTE_FIFO && canal->nombre[0] != '\0')
+        unlink(canal->nombre);
+
+    canal->pipe[READ] = canal->pipe[WRITE] = -1;
+    canal->shm = NULL;
+}
+
+static void detenerComunicacion(canal_t *canal)
+{
+    // Notificar
+    fprintf(stdout, "\n(%d) Intentando detener conexión\n", getpid());
+
+    //!1. Cliente manda una petición de terminación de comunicación al Servidor
+    paquet_t packet = generarSenal(getpid(), STOP_COM, NULL);
+
+    // Notificar
+    fprintf(stdout, "Intentando cerrar comunicación\n");
+
+    if (enviarPaquete(canal, &packet) < 0)
+        perror("Escritura");
+    // NO se termina el proceso, para que así elimine el pipe
+    // Sólo se intenta escribir indeterminadamente
+
+    paquet_t tmp;
+    //!4. Cliente espera a que se cierre el pipe (o el segmento)
+    while (recibirPaquete(canal, &tmp) != 0)
+        ;
+
+    // Notificar
+    fprintf(stdout, "Esperando que el servidor cierre comunicación\n");
+
+    //!5. Cliente cierra la lectura del pipe (Servidor->Cliente)
+    //!6. Cliente elimina el pipe (Servidor->Cliente)
+    //!7. Cliente cierra la escritura del pipe (Cliente->Servidor)
+    cerrarCanal(canal);
+
+    // Notificar
+    fprintf(stdout, "Se cerró el pipe (Servidor->Cliente)\n");
+    fprintf(stdout, "Se eliminó el pipe (Servidor->Cliente)\n");
+    fprintf(stdout, "Se cerró el pipe (Cliente->Servidor)\n");
+
+    //!8. El proceso Cliente finaliza
+    // Esto se hace desde el main
+    // Notificar
+    fprintf(stdout, "Comunicación terminada\n");
+}
+
+int enviarPaquete(canal_t *canal, paquet_t *paquete)
+{
+    clock_gettime(CLOCK_MONOTONIC, &ultimoEnvio);
+    paquetesEnviados++;
+
+    int escrito;
+
+    // TCP: una trama con su longitud
+    if (canal->transporte == TRANSPORTE_TCP)
+        escrito = escribirTrama(canal->pipe[WRITE], paquete, canal->formato);
+
+    // Pipe o socket: un write por mensaje
+    else if (canal->transporte != TRANSPORTE_SHM)
+    {
+        unsigned char mensaje[TAM_MAX_MENSAJE];
+        int tam = codificarPaquete(paquete, canal->formato, mensaje);
+        escrito = write(canal->pipe[WRITE], mensaje, tam);
+    }
+
+    else
+        escrito = escribirAnillo(canal, paquete);
+
+    if (escrito > 0)
+        bytesEnviados += escrito;
+
+    return escrito;
+}
+
+int escribirAnillo(canal_t *canal, paquet_t *paquete)
+{
+    // El anillo sólo se llena si el servidor va atrasado (o dejó de leer)
+    struct timespec intervalo = {0, INTERVALO_ANILLO_LLENO_US * 1000L};
+    while (!anilloEscribir(&canal->shm->peticiones, paquete))
+    {
+        if (__atomic_load_n(&canal->shm->cerrado, __ATOMIC_ACQUIRE) ||
+            extremoCerrado(canal->pipe[WRITE]))
+        {
+            errno = EPIPE;
+            return -1;
+        }
+        nanosleep(&intervalo, NULL);
+    }
+
+    // El servidor estaba dormido: tocar el timbre por el pipe
+    if (anilloReclamarDespertar(&canal->shm->peticiones))
+    {
+        paquet_t timbre = generarSenal(getpid(), TIMBRE_SHM, NULL);
+        if (write(canal->pipe[WRITE], &timbre, sizeof(timbre)) < 0)
+            return -1;
+    }
+
+    return sizeof(paquet_t);
+}
+
+int recibirPaquete(canal_t *canal, paquet_t *paquete)
+{
+    int leido = sizeof(paquet_t);
+
+    // TCP: la trama completa, 0 si el servidor cerró la conexión
+    if (canal->transporte == TRANSPORTE_TCP)
+        leido = leerTrama(canal->pipe[READ], paquete);
+
+    // Pipe: read() retorna 0 cuando el servidor cierra
+    else if (canal->transporte == TRANSPORTE_FIFO)
+        leido = leerMensaje(canal, paquete);
+
+    // Socket Unix: un mensaje por read(), debe ser exactamente un paquete
+    else if (canal->transporte == TRANSPORTE_UNIX)
+    {
+        unsigned char mensaje[TAM_MAX_MENSAJE];
+        leido = read(canal->pipe[READ], mensaje, sizeof(mensaje));
+        if (leido > 0 && decodificarPaquete(mensaje, leido, paquete) != leido)
+        {
+            errno = EPROTO;
+            leido = -1;
+        }
+    }
+
+    // Igual que el pipe: sin datos y cerrado es EOF
+    else if (!anilloEsperar(&canal->shm->respuestas, &canal->shm->cerrado,
+                            canal->pipe[WRITE]) &&
+             !anilloHayDatos(&canal->shm->respuestas))
+        leido = 0;
+
+    else
+        anilloLeer(&canal->shm->respuestas, paquete);
+
+    // El tiempo de espera lo suma quien reconoce la respuesta (por su id)
+    if (leido > 0)
+    {
+        respuestasRecibidas++;
+        bytesRecibidos += leido;
+    }
+
+    return leido;
+}
+
+void mostrarMetricas(canal_t *canal)
+{
+    const char *nombres[] = {"fifo", "shm", "unix", "tcp"};
+    const char *formatos[] = {"clásico", "compacto"};
+
+    fprintf(stdout, "Respuestas recibidas (%s): %lu, tiempo medio de respuesta: %.1fus\n",
+            nombres[canal->transporte], respuestasRecibidas,
+            respuestasRecibidas ? segundosEspera / respuestasRecibidas * 1e6 : 0);
+
+    fprintf(stdout, "Bytes por mensaje (%s): %.1f enviados, %.1f recibidos\n",
+            formatos[canal->formato],
+            paquetesEnviados ? (double)bytesEnviados / paquetesEnviados : 0,
+            respuestasRecibidas ? (double)bytesRecibidos / respuestasRecibidas : 0);
+
+    if (lotesEnviados > 0)
+        fprintf(stdout, "Operaciones en lote: %lu en %lu mensajes (%.1f por lote)\n",
+                operacionesEnLote, lotesEnviados,
+                (double)operacionesEnLote / lotesEnviados);
+
+    if (consultasLocales > 0)
+        fprintf(stdout, "Búsquedas resueltas en el catálogo local: %lu\n",
+                consultasLocales);
+}
+
+paquet_t generarSenal(pid_t dest, int code, char *buffer)
+{
+    // Paquet creation
+    paquet_t packet;
+    packet.client = dest;
+    packet.type = SIGNAL;
+    packet.id = 0;
+
+    // Signal construction
+    packet.data.signal.code = code;
+    packet.data.signal.version = 0;
+    packet.data.signal.buffer[0] = '\0';
+    if (buffer != NULL)
+        strcpy(packet.data.signal.buffer, buffer);
+    return packet;
+}
+
+uint32_t nuevoId(void)
+{
+    // El 0 indica un paquete sin identificador
+    if (++ultimoId == 0)
+        ultimoId = 1;
+
+    return ultimoId;
+}
+
+double segundosDesde(const struct timespec *inicio)
+{
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+
+    return (ahora.tv_sec - inicio->tv_sec) +
+           (ahora.tv_nsec - inicio->tv_nsec) / 1e9;
+}
+
+void mostrarSugerencia(const paquet_t *respuesta)
+{
+    if (respuesta->type == SIGNAL && respuesta->data.signal.code == PET_ERROR &&
+        respuesta->data.signal.buffer[0] != '\0')
+        fprintf(stderr, "%s\n", respuesta->data.signal.buffer);
+}
+
+bool atenderAviso(const paquet_t *paquete)
+{
+    if (paquete->type != SIGNAL || paquete->data.signal.code != AVISO_RESERVA)
+        return false;
+
+    printf("AVISO: Se le prestó un libro que había reservado, entrega: %s\n",
+           paquete->data.signal.buffer);
+    return true;
+}
+
+int esperarRespuesta(canal_t *canal, uint32_t id, paquet_t *respuesta)
+{
+    while (true)
+    {
+        int leido = recibirPaquete(canal, respuesta);
+        if (leido <= 0)
+            return leido;
+
+        if (respuesta->id == id)
+        {
+            segundosEspera += segundosDesde(&ultimoEnvio);
+            return leido;
+        }
+
+        if (atenderAviso(respuesta))
+            continue;
+
+        // Respuesta de una petición que ya no se espera
+        fprintf(stderr, "Se descarta una respuesta ajena (id %u)\n", respuesta->id);
+    }
+}
+
+/* ------------------------ Ventana de peticiones ------------------------ */
+
+paquet_t paqueteOperacion(const operacion_t *operacion)
+{
+    // Lo que no se usa no viaja
+    paquet_t paquete;
+    memset(&paquete, 0, sizeof(paquete));
+    paquete.type = BOOK;
+    paquete.client = getpid();
+
+    paquete.data.libro.petition = operacion->petition;
+    paquete.data.libro.ISBN = operacion->ISBN;
+    paquete.data.libro.copyInfo.n_copy = operacion->n_copy;
+    strcpy(paquete.data.libro.name, operacion->name);
+
+    return paquete;
+}
+
+int enviarPendiente(canal_t *canal,
+                    ventana_t *ventana,
+                    paquet_t *paquete,
+                    const operacion_t *operacion,
+                    lote_t *lote)
+{
+    //! 1. Ventana llena: esperar alguna respuesta
+    while (ventana->enVuelo == VENTANA_PETICIONES)
+    {
+        if (recibirPendiente(canal, ventana) != SUCCESS_GENERIC)
+        {
+            free(lote);
+            return ERROR_LECTURA;
+        }
+    }
+
+    //! 2. Enviar con un identificador nuevo
+    paquete->id = nuevoId();
+    if (enviarPaquete(canal, paquete) < 0)
+    {
+        perror("Error");
+        free(lote);
+        return ERROR_ESCRITURA;
+    }
+
+    //! 3. Ocupar un espacio libre hasta que llegue la respuesta
+    pendiente_t *pendiente = ventana->pendientes;
+    while (pendiente->id != 0)
+        pendiente++;
+
+    pendiente->id = paquete->id;
+    pendiente->lote = lote;
+    pendiente->envio = ultimoEnvio;
+    if (operacion != NULL)
+        pendiente->operacion = *operacion;
+
+    ventana->enVuelo++;
+    return SUCCESS_GENERIC;
+}
+
+int recibirPendiente(canal_t *canal, ventana_t *ventana)
+{
+    paquet_t respuesta;
+    if (recibirPaquete(canal, &respuesta) <= 0)
+    {
+        perror("Error");
+        return ERROR_LECTURA;
+    }
+
+    // La respuesta se reconoce por el id, no por el orden de llegada
+    pendiente_t *pendiente = NULL;
+    for (int i = 0; i < VENTANA_PETICIONES && pendiente == NULL; i++)
+        if (respuesta.id != 0 && ventana->pendientes[i].id == respuesta.id)
+            pendiente = &ventana->pendientes[i];
+
+    if (pendiente == NULL)
+    {
+        if (!atenderAviso(&respuesta))
+            fprintf(stderr, "Se descarta una respuesta ajena (id %u)\n", respuesta.id);
+        return SUCCESS_GENERIC;
+    }
+
+    segundosEspera += segundosDesde(&pendiente->envio);
+
+    if (pendiente->lote != NULL)
+        mostrarResultados(pendiente->lote, &respuesta);
+
+    else if (respuesta.type == BOOK) // BUSCAR: el libro encontrado
+    {
+        char detalle[TAM_STRING];
+        snprintf(detalle, sizeof(detalle), "ISBN %d, %d ejemplares",
+                 respuesta.data.libro.ISBN, respuesta.data.libro.n_copies);
+        mostrarOperacion(&pendiente->operacion, SUCCESS_GENERIC, detalle);
+    }
+
+    else
+    {
+        int codigo = (respuesta.type == SIGNAL) ? respuesta.data.signal.code : PET_ERROR;
+        mostrarOperacion(&pendiente->operacion, codigo, respuesta.data.signal.buffer);
+    }
+
+    // Liberar el espacio
+    free(pendiente->lote);
+    pendiente->lote = NULL;
+    pendiente->id = 0;
+    ventana->enVuelo--;
+
+    return SUCCESS_GENERIC;
+}
+
+void vaciarVentana(canal_t *canal, ventana_t *ventana)
+{
+    while (ventana->enVuelo > 0)
+        if (recibirPendiente(canal, ventana) != SUCCESS_GENERIC)
+            break;
+
+    // El servidor cerró: las que quedaron no tendrán respuesta
+    for (int i = 0; i < VENTANA_PETICIONES; i++)
+    {
+        if (ventana->pendientes[i].id == 0)
+            continue;
+
+        free(ventana->pendientes[i].lote);
+        ventana->pendientes[i].lote = NULL;
+        ventana->pendientes[i].id = 0;
+        ventana->enVuelo--;
+    }
+}
+
+void mostrarOperacion(const operacion_t *operacion, int codigo, const char *detalle)
+{
+    // Éxito esperado y nombre del tipo de petición (BOOK_REQUEST_T)
+    int exito;
+    const char *nombre;
+    switch (operacion->petition)
+    {
+    case SOLICITAR:
+        exito = SOLICITUD;
+        nombre = "Préstamo";
+        break;
+
+    case RENOVAR:
+    case RENOVAR_PROPIO:
+        exito = RENOVACION;
+        nombre = "Renovación";
+        break;
+
+    case DEVOLVER:
+    case DEVOLVER_PROPIO:
+        exito = DEVOLUCION;
+        nombre = "Devolución";
+        break;
+
+    case BUSCAR:
+        exito = SUCCESS_GENERIC;
+        nombre = "Búsqueda";
+        break;
+
+    default: // Las demás no viajan en un lote
+        exito = SUCCESS_GENERIC;
+        nombre = "Petición";
+        break;
+    }
+
+    if (codigo == PET_EXPIRADA)
+        fprintf(stderr, "%s de '%s': la solicitud expiró en el servidor\n",
+                nombre, operacion->name);
+
+    else if (codigo == PET_ABORTADA)
+        fprintf(stderr, "%s de '%s': no se hizo, otra operación de la transacción falló\n",
+                nombre, operacion->name);
+
+    else if (codigo == exito)
+        printf("%s de '%s': Operación exitosa, %s\n", nombre, operacion->name, detalle);
+
+    else
+        fprintf(stderr, "%s de '%s': Operación fallida\n", nombre, operacion->name);
+}
+
+void mostrarResultados(const lote_t *lote, const paquet_t *respuesta)
+{
+    if (respuesta->type != RESULTADOS ||
+        respuesta->data.resultados.cantidad != lote->cantidad)
+    {
+        fprintf(stderr, "El servidor no respondió el lote\n");
+        return;
+    }
+
+    for (int i = 0; i < lote->cantidad; i++)
+    {
+        char detalle[TAM_STRING];
+        sprintf(detalle, "ejemplar #%d", respuesta->data.resultados.ejemplares[i]);
+        mostrarOperacion(&lote->operaciones[i],
+                         respuesta->data.resultados.codigos[i], detalle);
+    }
+}
+
+int enviarLote(canal_t *canal, ventana_t *ventana, lote_t *lote)
+{
+    // Notificación
+    printf("\nSe está enviando un lote de %d operaciones al servidor\n",
+           lote->cantidad);
+
+    paquet_t paquete;
+    paquete.type = LOTE;
+    paquete.client = getpid();
+    paquete.data.lote = lote;
+
+    int cantidad = lote->cantidad; // Si el envío falla el lote se libera
+    int resultado = enviarPendiente(canal, ventana, &paquete, NULL, lote);
+
+    if (resultado == SUCCESS_GENERIC)
+    {
+        lotesEnviados++;
+        operacionesEnLote += cantidad;
+    }
+
+    return resultado;
+}
+
+// Manipular libros
+
+int prestarLibro(canal_t *canal, const char *nombreLibro, int ISBN)
+{
+    // Notificación
+    printf("\nSe está enviando una solicitud al servidor\n");
+
+    // Libro a enviar al servidor
+    book_t libro;
+    memset(&libro, 0, sizeof(libro)); // Lo que no se usa no viaja
     libro.ISBN = ISBN;
     strcpy(libro.name, nombreLibro);
     libro.petition = SOLICITAR;
@@ -639,10 +1625,11 @@ int prestarLibro(int *pipes, const char *nombreLibro, int ISBN)
     paquet_t paquete;
     paquete.type = BOOK;
     paquete.client = getpid();
+    paquete.id = nuevoId();
     paquete.data.libro = libro;
 
     // Enviar al sevidor
-    if (write(pipes[WRITE], &paquete, sizeof(paquete)) < 0)
+    if (enviarPaquete(canal, &paquete) < 0)
     {
         perror("Error");
         return ERROR_ESCRITURA;
@@ -650,15 +1637,22 @@ int prestarLibro(int *pipes, const char *nombreLibro, int ISBN)
 
     // ... Esperar una respuesta positiva
     paquet_t respuesta;
-    if (read(pipes[READ], &respuesta, sizeof(respuesta)) < 0)
+    if (esperarRespuesta(canal, paquete.id, &respuesta) <= 0)
     {
         perror("Error");
         return ERROR_LECTURA;
     }
 
+    if (respuesta.data.signal.code == PET_EXPIRADA)
+    {
+        fprintf(stderr, "La solicitud expiró en el servidor antes de ser atendida\n");
+        return ERROR_SOLICITUD;
+    }
+
     if (respuesta.data.signal.code != SOLICITUD)
     {
         fprintf(stderr, "La solicitud falló, el libro no existe o no tiene ejemplares disponibles\n");
+        mostrarSugerencia(&respuesta);
         return ERROR_SOLICITUD;
     }
 
@@ -668,26 +1662,163 @@ int prestarLibro(int *pipes, const char *nombreLibro, int ISBN)
     return SUCCESS_GENERIC;
 }
 
-int devolverLibro(int *pipes, const char *nombreLibro, int ISBN, int ejemplar)
+int prestarVarios(canal_t *canal, const lote_t *lote)
+{
+    if (lote->cantidad == 0)
+    {
+        fprintf(stderr, "No se pidió ningún libro\n");
+        return ERROR_SOLICITUD;
+    }
+
+    // Las operaciones viajan como un LOTE, que no existe en el formato clásico
+    if (canal->formato != FORMATO_COMPACTO)
+    {
+        fprintf(stderr, "Pedir varios libros requiere el formato compacto\n");
+        return ERROR_SOLICITUD;
+    }
+
+    // Notificación
+    printf("\nSe está enviando una transacción de %d préstamos al servidor\n",
+           lote->cantidad);
+
+    // Crear el paquete
+    paquet_t paquete;
+    paquete.type = TRANSACCION;
+    paquete.client = getpid();
+    paquete.id = nuevoId();
+    paquete.data.lote = (lote_t *)lote;
+
+    // Enviar al sevidor
+    if (enviarPaquete(canal, &paquete) < 0)
+    {
+        perror("Error");
+        return ERROR_ESCRITURA;
+    }
+
+    // ... Esperar el resultado de cada préstamo
+    paquet_t respuesta;
+    if (esperarRespuesta(canal, paquete.id, &respuesta) <= 0)
+    {
+        perror("Error");
+        return ERROR_LECTURA;
+    }
+
+    mostrarResultados(lote, &respuesta);
+
+    if (respuesta.type != RESULTADOS ||
+        respuesta.data.resultados.codigos[0] != SOLICITUD)
+    {
+        fprintf(stderr, "La transacción falló, no se prestó ningún libro\n");
+        return ERROR_SOLICITUD;
+    }
+
+    printf("La transacción fue procesada adecuadamente\n");
+    return SUCCESS_GENERIC;
+}
+
+int reservarLibro(canal_t *canal, const char *nombreLibro, int ISBN)
 {
     // Notificación
     printf("\nSe está enviando una solicitud al servidor\n");
 
     // Libro a enviar al servidor
     book_t libro;
+    memset(&libro, 0, sizeof(libro)); // Lo que no se usa no viaja
+    libro.ISBN = ISBN;
+    strcpy(libro.name, nombreLibro);
+    libro.petition = RESERVAR; //! RESERVAR
+
+    // Crear el paquete
+    paquet_t paquete;
+    paquete.type = BOOK;
+    paquete.client = getpid();
+    paquete.id = nuevoId();
+    paquete.data.libro = libro;
+
+    // Enviar al sevidor
+    if (enviarPaquete(canal, &paquete) < 0)
+    {
+        perror("Error");
+        return ERROR_ESCRITURA;
+    }
+
+    // ... Esperar una respuesta: el préstamo o el puesto en la cola
+    paquet_t respuesta;
+    if (esperarRespuesta(canal, paquete.id, &respuesta) <= 0)
+    {
+        perror("Error");
+        return ERROR_LECTURA;
+    }
+
+    if (respuesta.data.signal.code == PET_EXPIRADA)
+    {
+        fprintf(stderr, "La solicitud expiró en el servidor antes de ser atendida\n");
+        return ERROR_SOLICITUD;
+    }
+
+    if (respuesta.data.signal.code == RESERVA)
+    {
+        printf("No hay ejemplares disponibles, su puesto en la cola es: %s\n",
+               respuesta.data.signal.buffer);
+        printf("Esperando a que se devuelva un ejemplar...\n");
+
+        // El aviso trae el mismo id que la reserva
+        if (esperarRespuesta(canal, paquete.id, &respuesta) <= 0)
+        {
+            perror("Error");
+            return ERROR_LECTURA;
+        }
+
+        if (respuesta.type != SIGNAL || respuesta.data.signal.code != AVISO_RESERVA)
+        {
+            fprintf(stderr, "La reserva no se pudo completar\n");
+            return ERROR_SOLICITUD;
+        }
+
+        printf("Se devolvió un ejemplar y le fue prestado hasta: %s\n",
+               respuesta.data.signal.buffer);
+        return SUCCESS_GENERIC;
+    }
+
+    if (respuesta.data.signal.code != SOLICITUD)
+    {
+        fprintf(stderr, "La reserva falló, el libro no existe o ya estaba reservado\n");
+        mostrarSugerencia(&respuesta);
+        return ERROR_SOLICITUD;
+    }
+
+    printf("La solicitud fue procesada adecuadamente\n");
+    printf("El libro fue prestado hasta: %s\n", respuesta.data.signal.buffer);
+
+    return SUCCESS_GENERIC;
+}
+
+int devolverLibro(canal_t *canal, const char *nombreLibro, int ISBN, int ejemplar)
+{
+    // Notificación
+    printf("\nSe está enviando una solicitud al servidor\n");
+
+    // Libro a enviar al servidor
+    book_t libro;
+    memset(&libro, 0, sizeof(libro)); // Lo que no se usa no viaja
     libro.ISBN = ISBN;
     strcpy(libro.name, nombreLibro);
     libro.petition = DEVOLVER;        //! DEVOLVER
     libro.copyInfo.n_copy = ejemplar; // Numero del ejemplar
 
+    // Sin número: el ejemplar que tiene este cliente
+    if (ejemplar == 0)
+        libro.petition = DEVOLVER_PROPIO;
+
     // Crear el paquete
     paquet_t paquete;
     paquete.type = BOOK;
     paquete.client = getpid();
+    paquete.id = nuevoId();
     paquete.data.libro = libro;
 
     // Enviar al sevidor
-    if (write(pipes[WRITE], &paquete, sizeof(paquete)) < 0)
+    if (enviarPaquete(canal, &paquete) < 0)
     {
         perror("Error");
         return ERROR_ESCRITURA;
@@ -695,15 +1826,22 @@ int devolverLibro(int *pipes, const char *nombreLibro, int ISBN, int ejemplar)
 
     // ... Esperar una respuesta positiva
     paquet_t respuesta;
-    if (read(pipes[READ], &respuesta, sizeof(respuesta)) < 0)
+    if (esperarRespuesta(canal, paquete.id, &respuesta) <= 0)
     {
         perror("Error");
         return ERROR_LECTURA;
     }
 
+    if (respuesta.data.signal.code == PET_EXPIRADA)
+    {
+        fprintf(stderr, "La solicitud expiró en el servidor antes de ser atendida\n");
+        return ERROR_SOLICITUD;
+    }
+
     if (respuesta.data.signal.code != DEVOLUCION)
     {
         fprintf(stderr, "La solicitud falló, el libro no existe o no tiene ejemplares en préstamo\n");
+        mostrarSugerencia(&respuesta);
         return ERROR_SOLICITUD;
     }
 
@@ -715,7 +1853,7 @@ int devolverLibro(int *pipes, const char *nombreLibro, int ISBN, int ejemplar)
     return SUCCESS_GENERIC;
 }
 
-int renovarLibro(int *pipes,
+int renovarLibro(canal_t *canal,
                  const char *nombreLibro,
                  int ISBN,
                  int ejemplar)
@@ -725,19 +1863,25 @@ int renovarLibro(int *pipes,
 
     // Libro a enviar al servidor
     book_t libro;
+    memset(&libro, 0, sizeof(libro)); // Lo que no se usa no viaja
     libro.ISBN = ISBN;
     strcpy(libro.name, nombreLibro);
     libro.petition = RENOVAR;         //! DEVOLVER
     libro.copyInfo.n_copy = ejemplar; // Numero del ejemplar
 
+    // Sin número: el ejemplar que tiene este cliente
+    if (ejemplar == 0)
+        libro.petition = RENOVAR_PROPIO;
+
     // Crear el paquete
     paquet_t paquete;
     paquete.type = BOOK;
     paquete.client = getpid();
+    paquete.id = nuevoId();
     paquete.data.libro = libro;
 
     // Enviar al sevidor
-    if (write(pipes[WRITE], &paquete, sizeof(paquete)) < 0)
+    if (enviarPaquete(canal, &paquete) < 0)
     {
         perror("Error");
         return ERROR_ESCRITURA;
@@ -745,15 +1889,22 @@ int renovarLibro(int *pipes,
 
     // ... Esperar una respuesta positiva
     paquet_t respuesta;
-    if (read(pipes[READ], &respuesta, sizeof(respuesta)) < 0)
+    if (esperarRespuesta(canal, paquete.id, &respuesta) <= 0)
     {
         perror("Error");
         return ERROR_LECTURA;
     }
 
+    if (respuesta.data.signal.code == PET_EXPIRADA)
+    {
+        fprintf(stderr, "La solicitud expiró en el servidor antes de ser atendida\n");
+        return ERROR_SOLICITUD;
+    }
+
     if (respuesta.data.signal.code != RENOVACION)
     {
         fprintf(stderr, "La solicitud falló, el libro no existe o no tiene ejemplares en préstamo\n");
+        mostrarSugerencia(&respuesta);
         return ERROR_SOLICITUD;
     }
 
@@ -765,49 +1916,167 @@ int renovarLibro(int *pipes,
     return SUCCESS_GENERIC;
 }
 
-book_t buscarLibro(int *pipes, const char *nombre, int ISBN)
+int misPrestamos(canal_t *canal)
 {
     // Notificación
     printf("\nSe está enviando una solicitud al servidor\n");
 
-    // Libro a enviar al servidor
-    book_t libro1;
-    libro1.ISBN = ISBN;
-    strcpy(libro1.name, nombre);
-    libro1.petition = BUSCAR;
-
-    // Crear el paquete
+    // Sólo importa quién la envía
     paquet_t paquete;
+    memset(&paquete, 0, sizeof(paquete));
     paquete.type = BOOK;
     paquete.client = getpid();
-    paquete.data.libro = libro1;
+    paquete.id = nuevoId();
+    paquete.data.libro.petition = MIS_PRESTAMOS;
 
     // Enviar al sevidor
-    if (write(pipes[WRITE], &paquete, sizeof(paquete)) < 0)
+    if (enviarPaquete(canal, &paquete) < 0)
     {
         perror("Error");
+        return ERROR_ESCRITURA;
     }
 
-    // ... Esperar una respuesta positiva
+    // ... La lista llega en partes con el mismo id, hasta la última
     paquet_t respuesta;
-    if (read(pipes[READ], &respuesta, sizeof(respuesta)) < 0)
+    int recibidos = 0;
+    do
+    {
+        if (esperarRespuesta(canal, paquete.id, &respuesta) <= 0)
+        {
+            perror("Error");
+            return ERROR_LECTURA;
+        }
+
+        if (respuesta.type != PRESTAMOS)
+        {
+            fprintf(stderr, "El servidor no respondió la lista de préstamos\n");
+            return ERROR_SOLICITUD;
+        }
+
+        struct PAQUET_PRESTAMOS_T *parte = &respuesta.data.prestamos;
+        if (recibidos == 0)
+            printf("Préstamos activos: %d\n", parte->total);
+
+        for (int i = 0; i < parte->cantidad; i++, recibidos++)
+            printf("ISBN %d, ejemplar #%d, entrega: %s\n",
+                   parte->prestamos[i].ISBN,
+                   parte->prestamos[i].n_copy,
+                   parte->prestamos[i].date);
+
+    } while (!respuesta.data.prestamos.ultimo);
+
+    return SUCCESS_GENERIC;
+}
+
+int buscarPagina(canal_t *canal,
+                 enum BOOK_REQUEST_T tipo,
+                 const char *nombre,
+                 int ISBN,
+                 int cursor)
+{
+    // Los ejemplares de un ISBN están en el catálogo local, todos de una vez
+    if (tipo == BUSCAR_TODOS && ISBN != 0 && canal->catalogo != NULL)
+    {
+        int encontrados = buscarEnCatalogo(canal->catalogo, ISBN);
+        if (encontrados >= 0)
+        {
+            printf("%d resultados (catálogo local)\n", encontrados);
+            return 0;
+        }
+
+        // El servidor se cerró o dejó un título a medio escribir: de aquí en
+        // adelante se le pregunta a él
+        fprintf(stderr, "El catálogo local no responde, se consulta al servidor\n");
+        cerrarCatalogo(canal->catalogo, false);
+        canal->catalogo = NULL;
+    }
+
+    // Notificación
+    printf("\nSe está enviando una solicitud al servidor\n");
+
+    // La consulta, el cursor y el límite (el del servidor) van en el libro
+    paquet_t paquete;
+    memset(&paquete, 0, sizeof(paquete));
+    paquete.type = BOOK;
+    paquete.client = getpid();
+    paquete.id = nuevoId();
+    paquete.data.libro.petition = tipo;
+    paquete.data.libro.ISBN = ISBN;
+    paquete.data.libro.copyInfo.n_copy = cursor;
+    strcpy(paquete.data.libro.name, nombre);
+
+    // Enviar al sevidor
+    if (enviarPaquete(canal, &paquete) < 0)
     {
         perror("Error");
+        return -ERROR_ESCRITURA;
     }
 
-    if (respuesta.type == ERR)
+    // ... Los resultados llegan con el mismo id, hasta FIN_BUSQUEDA
+    paquet_t respuesta;
+    int recibidos = 0;
+    while (true)
     {
-        printf("El libro no existe!");
-        return libro1;
+        if (esperarRespuesta(canal, paquete.id, &respuesta) <= 0)
+        {
+            perror("Error");
+            return -ERROR_LECTURA;
+        }
+
+        if (respuesta.type != BOOK)
+            break;
+
+        book_t *libro = &respuesta.data.libro;
+        if (tipo == BUSCAR_PARECIDOS)
+            printf("'%s' (ISBN %d): parecido %d%%\n", libro->name, libro->ISBN,
+                   libro->copyInfo.n_copy);
+        else if (ISBN != 0)
+            printf("'%s' ejemplar #%d: %s, %s\n", libro->name, libro->copyInfo.n_copy,
+                   libro->copyInfo.state == 'D' ? "disponible" : "prestado",
+                   libro->copyInfo.date);
+        else
+            printf("'%s' (ISBN %d): %d ejemplares\n", libro->name, libro->ISBN,
+                   libro->n_copies);
+
+        recibidos++;
     }
 
-    book_t libro;
-    libro.ISBN = respuesta.data.libro.ISBN;
-    libro.copyInfo = respuesta.data.libro.copyInfo;
-    strcpy(libro.name, respuesta.data.libro.name);
-    libro.n_copies = respuesta.data.libro.n_copies;
-    libro.petition = SOLICITAR;
+    if (respuesta.type != SIGNAL || respuesta.data.signal.code != FIN_BUSQUEDA)
+    {
+        if (respuesta.type == SIGNAL && respuesta.data.signal.code == PET_EXPIRADA)
+            fprintf(stderr, "La solicitud expiró en el servidor antes de ser atendida\n");
+        else
+            fprintf(stderr, "El servidor no respondió la búsqueda\n");
+        return -ERROR_SOLICITUD;
+    }
+
+    int siguiente = atoi(respuesta.data.signal.buffer);
+    printf("%d resultados%s\n", recibidos, siguiente > 0 ? ", hay más" : "");
+
+    return siguiente;
+}
+
+int buscarEnCatalogo(const catalogo_shm_t *catalogo, int ISBN)
+{
+    consultasLocales++;
+
+    // Puede haber varios títulos con el mismo ISBN, igual que en el servidor
+    int encontrados = 0;
+    book_t copias[MAX_CANT_LIBROS];
+    for (int k = 0; k < catalogo->n_titulos; k++)
+    {
+        if (catalogo->titulos[k].ISBN != ISBN)
+            continue;
+
+        int n = leerTitulo(catalogo, k, copias);
+        if (n < 0)
+            return -1;
+
+        for (int i = 0; i < n; i++, encontrados++)
+            printf("'%s' ejemplar #%d: %s, %s\n", copias[i].name, copias[i].copyInfo.n_copy,
+                   copias[i].copyInfo.state == 'D' ? "disponible" : "prestado",
+                   copias[i].copyInfo.date);
+    }
 
-    printf("La solicitud fue procesada\n\n");
-    return libro;
+    return encontrados;
 }
\ No newline at end of file
@@ -14,11 +14,22 @@
 #define __CLIENT_H__
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 #include "paquet.h"
+#include "shm.h"
+#include "formato.h"
+#include "catalogo.h"
 
 /* ----------------------------- Definiciones ----------------------------- */
 
 #define PIPE_TITLE_CLNT "clientPipe_" /**< Nombre con el cual crear los pipes de cliente*/
+#define INTERVALO_CONEXION_SHM_MS 1   /**< Periodo (ms) para revisar la confirmación por shm*/
+#define INTERVALO_ANILLO_LLENO_US 50  /**< Espera (us) cuando el anillo de peticiones está lleno*/
+#define TIMEOUT_NEGOCIACION_MS 1000   /**< Espera por la versión del formato (socket), si no llega se usa el clásico*/
+#define TAM_ENTRADA_CLIENTE (8 * TAM_MAX_MENSAJE) /**< Bytes leídos del pipe que esperan ser decodificados*/
+#define VENTANA_PETICIONES 16         /**< Peticiones del archivo enviadas sin esperar respuesta
+                                           (no más que la cola de salida del servidor)*/
 
 /* ----------------------------- Estructuras ----------------------------- */
 
@@ -34,6 +45,51 @@ struct peticion_t
     int ISBN;                  /**< ISBN del libro */
 };
 
+/**
+ * @struct canal_t
+ * @brief Medio por el cual el cliente habla con el servidor, el pipe
+ * (Cliente->Servidor) se usa para la conexión salvo con socket Unix, donde un
+ * mismo descriptor sirve para ambos sentidos
+ */
+typedef struct
+{
+    int pipe[2];             /**< pipe[WRITE] (Cliente->Servidor) y pipe[READ] (Servidor->Cliente)*/
+    int transporte;          /**< TRANSPORTE_FIFO, TRANSPORTE_SHM, TRANSPORTE_UNIX o TRANSPORTE_TCP*/
+    segmento_shm_t *shm;     /**< Segmento con los anillos (sólo TRANSPORTE_SHM)*/
+    char nombre[TAM_STRING]; /**< Nombre del pipe o del segmento (Servidor->Cliente)*/
+    int formato;             /**< FORMATO_CLASICO o FORMATO_COMPACTO (acordado con el servidor)*/
+    catalogo_shm_t *catalogo; /**< Catálogo del servidor si está en este equipo (NULL si no)*/
+    pid_t servidor;           /**< PID del servidor (0 si no se conoce, por TCP)*/
+    int lector;               /**< Número de lector (SIN_LECTOR: los préstamos no se guardan a su nombre)*/
+
+    unsigned char entrada[TAM_ENTRADA_CLIENTE]; /**< Bytes del pipe (Servidor->Cliente)
+                                                     aún sin decodificar*/
+    int n_entrada;                              /**< Cantidad de bytes en entrada*/
+} canal_t;
+
+/**
+ * @struct pendiente_t
+ * @brief Petición enviada que todavía espera su respuesta
+ */
+typedef struct
+{
+    uint32_t id;           /**< Identificador de la petición (0 = espacio libre)*/
+    operacion_t operacion; /**< Operación enviada sola (sin lote)*/
+    lote_t *lote;          /**< Lote enviado, se libera al recibir los resultados*/
+    struct timespec envio; /**< Momento del envío*/
+} pendiente_t;
+
+/**
+ * @struct ventana_t
+ * @brief Peticiones en vuelo: las respuestas se reconocen por el id y pueden
+ * llegar en cualquier orden
+ */
+typedef struct
+{
+    pendiente_t pendientes[VENTANA_PETICIONES]; /**< Espacios de la ventana*/
+    int enVuelo;                                /**< Espacios ocupados*/
+} ventana_t;
+
 /* ------------------------ Prototipos de funciones ------------------------ */
 /*
  - NOTA:
@@ -56,6 +112,11 @@ void mostrarUso(void);
  * @param argv Vector con los argumentos
  * @param pipeNom RETORNA: nombre del pipe
  * @param fileNom RETORNA: nombre del archivo
+ * @param transporte RETORNA: TRANSPORTE_FIFO (por defecto), TRANSPORTE_SHM,
+ * TRANSPORTE_UNIX o TRANSPORTE_TCP
+ * @param formato RETORNA: formato que se propone al servidor, FORMATO_COMPACTO
+ * (por defecto) o FORMATO_CLASICO
+ * @param lector RETORNA: número de lector o SIN_LECTOR (por defecto)
  * @return true Se utilizó un archivo
  * @return false No se utilizó un archivo, por lo tanto ignorar el contenido de fileNom
  */
@@ -63,7 +124,10 @@ static bool manejarArgumentos(
     int argc,
     char *argv[],
     char *pipeNom,
-    char *fileNom);
+    char *fileNom,
+    int *transporte,
+    int *formato,
+    int *lector);
 
 /* ----------------------- Protocolos de comunicación ----------------------- */
 
@@ -71,25 +135,139 @@ static bool manejarArgumentos(
  * @brief Iniciar la comunicación con el servidor
  * Descripción del proceso en README.md
  * 
- * @param pipeCLNT_SRVR Nombre del pipe (Cliente->Servidor)
- * @param pipeSRVR_CLNT RETORNA: nombre escogido para el pipe (Servidor->Cliente)
- * @param pipe pipe[0] tiene el pipe del pipe (Cliente -> Servidor) y
- *          pipe[1] tiene el pipe del pipe (Servidor -> Cliente)
- * Use las macros WRITE y READ con pipe
- * EJ: para escribir en el pipe se utilizar pipe[WRITE]
+ * @param pipeCLNT_SRVR Nombre del pipe (Cliente->Servidor) o del socket
+ * @param canal RETORNA: canal abierto, canal->transporte indica cuál usar
+ * Use las macros WRITE y READ con canal->pipe
+ * EJ: para escribir en el pipe se utilizar canal->pipe[WRITE]
+ */
+static void iniciarComunicacion(const char *pipeCLNT_SRVR, canal_t *canal);
+
+/**
+ * @brief Conectarse al socket Unix del servidor, no hay más pasos: el servidor
+ * obtiene el PID del kernel y no envía confirmación
+ * 
+ * @param rutaSocket Ruta del socket del servidor
+ * @param canal Canal con transporte TRANSPORTE_UNIX
+ * @return SUCCESS_GENERIC si éxito, ERROR_PIPE_CLNT_SRVR de lo contrario
+ */
+static int conectarSocket(const char *rutaSocket, canal_t *canal);
+
+/**
+ * @brief Conectarse al puerto TCP del servidor (con TCP_NODELAY), la
+ * confirmación del servidor se espera en \ref iniciarComunicacion
+ * 
+ * @param direccion "host:puerto" del servidor
+ * @param canal Canal con transporte TRANSPORTE_TCP
+ * @return SUCCESS_GENERIC si éxito, ERROR_PIPE_CLNT_SRVR de lo contrario
+ */
+static int conectarTCP(const char *direccion, canal_t *canal);
+
+/**
+ * @brief Escribir un paquete como trama TCP (longitud + mensaje) completa
+ * 
+ * @param fd Socket TCP
+ * @param paquete Paquete a enviar
+ * @param formato Formato del mensaje
+ * @return int Bytes de la trama si éxito, -1 si falló (errno)
+ */
+static int escribirTrama(int fd, paquet_t *paquete, int formato);
+
+/**
+ * @brief Leer una trama TCP completa, en cualquiera de los dos formatos, y
+ * validar su longitud
+ * 
+ * @param fd Socket TCP
+ * @param paquete RETORNA: paquete recibido
+ * @return int Bytes de la trama si éxito, 0 si el servidor cerró, -1 si falló
+ */
+static int leerTrama(int fd, paquet_t *paquete);
+
+/**
+ * @brief Socket Unix o TCP ya conectado: proponer el formato compacto con
+ * START_COM, si el servidor no responde a tiempo se sigue con el clásico
+ * 
+ * @param canal Canal conectado, canal->formato queda con el formato acordado
+ */
+static void acordarFormato(canal_t *canal);
+
+/**
+ * @brief Enviar el número de lector (señal LECTOR): el servidor registra los
+ * préstamos a su nombre y los guarda con la base de datos
+ * @note No tiene respuesta, llega al servidor antes que cualquier petición
+ *
+ * @param canal Canal abierto con el servidor
+ */
+static void identificarLector(canal_t *canal);
+
+/**
+ * @brief Leer el próximo mensaje del pipe (Servidor->Cliente), un read() puede
+ * traer varios mensajes compactos y el último a medias
+ * 
+ * @param canal Canal con transporte TRANSPORTE_FIFO
+ * @param paquete RETORNA: paquete recibido
+ * @return int Bytes del mensaje, 0 si el pipe no tiene escritor, -1 si falló
+ */
+static int leerMensaje(canal_t *canal, paquet_t *paquete);
+
+/**
+ * @brief Crear el segmento de memoria compartida con los anillos
+ * 
+ * @param canal Canal con transporte TRANSPORTE_SHM
+ * @return SUCCESS_GENERIC si éxito, ERROR_MEMORY de lo contrario
+ */
+static int crearSegmento(canal_t *canal);
+
+/**
+ * @brief Cerrar todo lo que tenga abierto el canal (pipes, segmento)
+ * 
+ * @param canal Canal a cerrar
  */
-static void iniciarComunicacion(
-    const char *pipeCLNT_SRVR,
-    char *pipeSRVR_CLNT,
-    int *pipe);
+static void cerrarCanal(canal_t *canal);
 
 /**
  * @brief Detener la comunicación con el servidor
  * 
- * @param pipe Pipes de lectura/escritura
- * @param pipeSRVR_CLNT Nombre del pipe creado por el Cliente
+ * @param canal Canal abierto con \ref iniciarComunicacion
+ */
+static void detenerComunicacion(canal_t *canal);
+
+/**
+ * @brief Enviar un paquete al servidor por el transporte del canal
+ * 
+ * @param canal Canal abierto
+ * @param paquete Paquete a enviar
+ * @return int Bytes escritos (según transporte y formato) si éxito, -1 si
+ * falló (errno)
+ */
+int enviarPaquete(canal_t *canal, paquet_t *paquete);
+
+/**
+ * @brief Escribir un paquete en el anillo de peticiones, espera si está lleno
+ * 
+ * @param canal Canal con transporte TRANSPORTE_SHM
+ * @param paquete Paquete a enviar
+ * @return int sizeof(paquet_t) si éxito, -1 si el servidor cerró (errno)
+ */
+static int escribirAnillo(canal_t *canal, paquet_t *paquete);
+
+/**
+ * @brief Esperar un paquete del servidor por el transporte del canal
+ * 
+ * @param canal Canal abierto
+ * @param paquete RETORNA: paquete recibido
+ * @return int Bytes recibidos (según transporte y formato) si éxito, 0 si el
+ * servidor cerró, -1 si falló
  */
-static void detenerComunicacion(int *pipe, char *pipeSRVR_CLNT);
+int recibirPaquete(canal_t *canal, paquet_t *paquete);
+
+/**
+ * @brief Mostrar cuántas respuestas se recibieron, su tiempo medio y los bytes
+ * por mensaje, sirve para comparar transportes y formatos con un mismo archivo
+ * de peticiones
+ * 
+ * @param canal Canal usado
+ */
+void mostrarMetricas(canal_t *canal);
 
 /**
  * @brief Generar un paquete de tipo Señal
@@ -101,29 +279,202 @@ static void detenerComunicacion(int *pipe, char *pipeSRVR_CLNT);
  */
 paquet_t generarSenal(pid_t src, int code, char *buffer);
 
+/**
+ * @brief Identificador para una nueva petición (nunca 0)
+ *
+ * @return uint32_t Identificador
+ */
+uint32_t nuevoId(void);
+
+/**
+ * @brief Segundos transcurridos desde un instante (CLOCK_MONOTONIC)
+ *
+ * @param inicio Instante de referencia
+ * @return double Segundos
+ */
+double segundosDesde(const struct timespec *inicio);
+
+/**
+ * @brief Mostrar la sugerencia que acompaña un PET_ERROR (el título más
+ * parecido cuando el nombre no existe), si la hay
+ *
+ * @param respuesta Respuesta del servidor
+ */
+void mostrarSugerencia(const paquet_t *respuesta);
+
+/**
+ * @brief Mostrar un aviso que el servidor envía sin que se le pida (el
+ * ejemplar de una reserva)
+ *
+ * @param paquete Paquete recibido que no responde ninguna petición en espera
+ * @return true si era un aviso
+ */
+bool atenderAviso(const paquet_t *paquete);
+
+/**
+ * @brief Esperar la respuesta de una petición, descarta las que traen otro id
+ * (salvo los avisos, que se muestran)
+ *
+ * @param canal Canal de comunicación
+ * @param id Identificador de la petición enviada
+ * @param respuesta RETORNA: respuesta recibida
+ * @return int Igual que \ref recibirPaquete
+ */
+int esperarRespuesta(canal_t *canal, uint32_t id, paquet_t *respuesta);
+
+/* ------------------------ Ventana de peticiones ------------------------ */
+
+/**
+ * @brief Paquete BOOK con una operación del archivo
+ *
+ * @param operacion Operación a enviar
+ * @return paquet_t Paquete sin identificador
+ */
+paquet_t paqueteOperacion(const operacion_t *operacion);
+
+/**
+ * @brief Enviar una petición sin esperar su respuesta, si la ventana está
+ * llena primero se recibe alguna de las pendientes
+ *
+ * @param canal Canal de comunicación
+ * @param ventana Peticiones en vuelo
+ * @param paquete Paquete a enviar (RETORNA: con su identificador)
+ * @param operacion Operación del paquete, NULL si es un lote
+ * @param lote Lote del paquete o NULL, la ventana se encarga de liberarlo
+ * (también si el envío falla)
+ * @return int Código de error o SUCCESS_GENERIC (0) si éxito
+ */
+int enviarPendiente(canal_t *canal,
+                    ventana_t *ventana,
+                    paquet_t *paquete,
+                    const operacion_t *operacion,
+                    lote_t *lote);
+
+/**
+ * @brief Recibir una respuesta, mostrar el resultado de la petición a la que
+ * corresponde y liberar su espacio en la ventana
+ *
+ * @param canal Canal de comunicación
+ * @param ventana Peticiones en vuelo
+ * @return int Código de error o SUCCESS_GENERIC (0) si se recibió algo
+ */
+int recibirPendiente(canal_t *canal, ventana_t *ventana);
+
+/**
+ * @brief Recibir todas las respuestas pendientes, si el servidor cierra antes
+ * se descartan las que faltan
+ *
+ * @param canal Canal de comunicación
+ * @param ventana Peticiones en vuelo
+ */
+void vaciarVentana(canal_t *canal, ventana_t *ventana);
+
+/**
+ * @brief Mostrar el resultado de una operación del archivo
+ *
+ * @param operacion Operación enviada
+ * @param codigo Código de la respuesta (SOLICITUD, PET_EXPIRADA...)
+ * @param detalle Texto que acompaña al éxito (fecha o ejemplar)
+ */
+void mostrarOperacion(const operacion_t *operacion, int codigo, const char *detalle);
+
+/**
+ * @brief Mostrar el resultado de cada operación de un lote
+ *
+ * @param lote Lote enviado
+ * @param respuesta Respuesta RESULTADOS del servidor
+ */
+void mostrarResultados(const lote_t *lote, const paquet_t *respuesta);
+
 /* ----------------------- Funciones para los libros ----------------------- */
 
+/**
+ * @brief Enviar un LOTE de operaciones por la ventana, los resultados se
+ * muestran al recibirlos
+ * @note Sólo con el formato compacto
+ *
+ * @param canal Canal de comunicación
+ * @param ventana Peticiones en vuelo
+ * @param lote Operaciones a enviar (al menos una), pasa a la ventana
+ * @return int Código de error o SUCCESS_GENERIC (0) si éxito
+ */
+int enviarLote(canal_t *canal, ventana_t *ventana, lote_t *lote);
+
+/**
+ * @brief Pedir al servidor la lista de ejemplares que tiene este cliente y
+ * mostrarla (llega en varios paquetes PRESTAMOS)
+ *
+ * @param canal Canal de comunicación
+ * @return int Código de error o SUCCESS_GENERIC (0) si éxito
+ */
+int misPrestamos(canal_t *canal);
+
 /**
  * @brief Función que se encarga de pedir prestado un libro al servidor
  * 
- * @param pipes Arreglo con los pipes
+ * @param canal Canal de comunicación
+ * @param nombreLibro Nombre del libro
+ * @param ISBN ISBN del libro
+ * @return int Código de error o SUCCESS_GENERIC (0) si éxito
+ */
+int prestarLibro(canal_t *canal, const char *nombreLibro, int ISBN);
+
+/**
+ * @brief Reservar un libro: si no hay ejemplares disponibles el cliente queda
+ * en la cola del título y espera (sin consultar) el aviso de que se le prestó
+ * uno
+ *
+ * @param canal Canal de comunicación
  * @param nombreLibro Nombre del libro
  * @param ISBN ISBN del libro
  * @return int Código de error o SUCCESS_GENERIC (0) si éxito
  */
-int prestarLibro(int *pipes, const char *nombreLibro, int ISBN);
+int reservarLibro(canal_t *canal, const char *nombreLibro, int ISBN);
+
+/**
+ * @brief Pedir prestados varios libros en una TRANSACCION: se prestan todos o
+ * ninguno, con un solo viaje al servidor
+ * @note Sólo con el formato compacto
+ *
+ * @param canal Canal de comunicación
+ * @param lote Libros a pedir (operaciones SOLICITAR)
+ * @return int Código de error o SUCCESS_GENERIC (0) si se prestaron todos
+ */
+int prestarVarios(canal_t *canal, const lote_t *lote);
+
+/**
+ * @brief Pedir y mostrar una página de una búsqueda: BUSCAR_TODOS (cada
+ * ejemplar del ISBN o, con ISBN 0, cada título que contiene el nombre),
+ * BUSCAR_PREFIJO, BUSCAR_PALABRA o BUSCAR_PARECIDOS (títulos según el índice
+ * del servidor)
+ * @note Los ejemplares de un ISBN se leen del catálogo local si existe, sin
+ * enviar la petición
+ *
+ * @param canal Canal de comunicación
+ * @param tipo BUSCAR_TODOS, BUSCAR_PREFIJO, BUSCAR_PALABRA o BUSCAR_PARECIDOS
+ * @param nombre Nombre, parte del nombre, prefijo o palabra a buscar
+ * @param ISBN ISBN del libro (sólo BUSCAR_TODOS), 0 para buscar por nombre
+ * @param cursor Posición desde la que se sigue (0 = desde el principio)
+ * @return int Cursor de la página siguiente (0 si no hay más) o un código de
+ * error negativo
+ */
+int buscarPagina(canal_t *canal,
+                 enum BOOK_REQUEST_T tipo,
+                 const char *nombre,
+                 int ISBN,
+                 int cursor);
 
 /**
  * @brief Función que se encarga de pedir devolver un libro al servidor
  * 
- * @param pipes Arreglo con los pipes
+ * @param canal Canal de comunicación
  * @param nombreLibro Nombre del libro
  * @param ISBN ISBN del libro
- * @param ejemplar Número de ejemplar
+ * @param ejemplar Número de ejemplar, 0 para el que tiene este cliente
  * @return int Código de error o SUCCESS_GENERIC (0) si éxito
  */
 int devolverLibro(
-    int *pipes,
+    canal_t *canal,
     const char *nombreLibro,
     int ISBN,
     int ejemplar);
@@ -131,27 +482,25 @@ int devolverLibro(
 /**
  * @brief Función que se encarga de pedir renovar un libro al servidor
  * 
- * @param pipes Arreglo con los pipes
+ * @param canal Canal de comunicación
  * @param nombreLibro Nombre del libro
  * @param ISBN ISBN del libro
- * @param ejemplar Número de ejemplar
+ * @param ejemplar Número de ejemplar, 0 para el que tiene este cliente
  * @return int Código de error o SUCCESS_GENERIC (0) si éxito
  */
 int renovarLibro(
-    int *pipes,
+    canal_t *canal,
     const char *nombreLibro,
     int ISBN,
     int ejemplar);
 
 /**
- * @brief Pedirle al servidor la información de un libro en específico
- * 
- * @param pipes Pipes de comunicación
- * @param nombre Nombre del libro
+ * @brief Mostrar los ejemplares de un ISBN leyéndolos del catálogo local
+ *
+ * @param catalogo Catálogo del servidor
  * @param ISBN ISBN del libro
- * @return struct ejemplar Estructura que contiene al libro, en caso de error
- * la petición del libro es BUSCAR, cualquier otro tipo de petición es éxito
+ * @return int Ejemplares mostrados, -1 si algún título no se pudo leer
  */
-book_t buscarLibro(int *pipes, const char *nombre, int ISBN);
+int buscarEnCatalogo(const catalogo_shm_t *catalogo, int ISBN);
 
 #endif // __CLIENT_H__
\ No newline at end of file
@@ -30,10 +30,15 @@
 
 /* -------------------------------- Señales -------------------------------- */
 /* ------------------------- Señales de peticiones ------------------------- */
-#define PET_ERROR -3 /**< Error de petición*/
-#define SOLICITUD 3  /**< Solicitud exitosa*/
-#define RENOVACION 4 /**< Renovación exitosa*/
-#define DEVOLUCION 5 /**< Devolución exitosa*/
+#define PET_ERROR -3    /**< Error de petición*/
+#define PET_EXPIRADA -4 /**< La petición expiró antes de ser atendida*/
+#define PET_ABORTADA -5 /**< No se hizo porque otra operación de la transacción falló*/
+#define SOLICITUD 3     /**< Solicitud exitosa*/
+#define RENOVACION 4    /**< Renovación exitosa*/
+#define DEVOLUCION 5    /**< Devolución exitosa*/
+#define RESERVA 8       /**< Reserva en espera (buffer: posición en la cola)*/
+#define AVISO_RESERVA 9 /**< Se prestó el ejemplar reservado (buffer: fecha y ejemplar)*/
+#define FIN_BUSQUEDA 10 /**< Fin de una página de BUSCAR_TODOS (buffer: cursor, 0 si no hay más)*/
 
 /* ---------------- Señales de confirmación de comunicación ---------------- */
 
@@ -41,6 +46,23 @@
 #define STOP_COM -1   /**< Señal para detener confirmación*/
 #define SUCCEED_COM 2 /**< Señal de confirmación de comunicación*/
 #define FAILED_COM -2 /**< Señal de fallo en la comunicación (TERMINACION)*/
+#define START_SHM 6   /**< Empezar comunicación por memoria compartida (buffer: segmento)*/
+#define TIMBRE_SHM 7  /**< Hay peticiones en el anillo y el Servidor estaba dormido*/
+#define LECTOR 11     /**< El Cliente se identifica (buffer: número de lector)*/
+
+#define SIN_LECTOR 0        /**< Cliente sin número de lector*/
+#define MAX_LECTOR 99999999 /**< Mayor número de lector*/
+
+/* ------------------------ Transportes disponibles ------------------------ */
+
+#define TRANSPORTE_FIFO 0 /**< Pipe nominal (Servidor->Cliente) por cliente*/
+#define TRANSPORTE_SHM 1  /**< Segmento de memoria compartida con dos anillos*/
+#define TRANSPORTE_UNIX 2 /**< Socket Unix SOCK_SEQPACKET (un mensaje por paquete)*/
+#define TRANSPORTE_TCP 3  /**< Socket TCP con tramas (longitud + paquete)*/
+
+/* TCP no conserva los límites de los mensajes: cada paquete viaja precedido de
+   su longitud (uint32_t, orden de red) */
+#define TAM_CABECERA_TCP 4 /**< Bytes de la longitud (trama completa: \ref TAM_TRAMA_TCP)*/
 
 /* --------------------------- Lista de errores --------------------------- */
 /**< Errores genéricos*/
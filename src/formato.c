@@ -0,0 +1,371 @@
+/**
+ * @file formato.c
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Formato compacto de los paquetes: cabecera fija, contenido según el
+ * tipo y cadenas precedidas de su longitud
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "formato.h"
+
+/* --------------------------------- Campos --------------------------------- */
+
+static unsigned char *escribirEntero(unsigned char *p, int32_t valor)
+{
+    uint32_t red = htonl((uint32_t)valor);
+    memcpy(p, &red, sizeof(red));
+    return p + sizeof(red);
+}
+
+static unsigned char *escribirCadena(unsigned char *p, const char *cadena)
+{
+    // Cabe en un byte: las cadenas del paquete son de TAM_STRING
+    size_t longitud = strnlen(cadena, TAM_STRING - 1);
+    *p++ = (unsigned char)longitud;
+    memcpy(p, cadena, longitud);
+    return p + longitud;
+}
+
+static const unsigned char *leerEntero(const unsigned char *p, int32_t *valor)
+{
+    uint32_t red;
+    memcpy(&red, p, sizeof(red));
+    *valor = (int32_t)ntohl(red);
+    return p + sizeof(red);
+}
+
+// NULL si la cadena se sale del contenido o no cabe en TAM_STRING
+static const unsigned char *leerCadena(const unsigned char *p,
+                                       const unsigned char *fin,
+                                       char *cadena)
+{
+    if (p >= fin || *p >= TAM_STRING || p + 1 + *p > fin)
+        return NULL;
+
+    int longitud = *p++;
+    memcpy(cadena, p, longitud);
+    cadena[longitud] = '\0';
+    return p + longitud;
+}
+
+// Operaciones de un LOTE en memoria reservada, NULL si no son válidas
+static const unsigned char *leerLote(const unsigned char *p,
+                                     const unsigned char *fin,
+                                     lote_t **destino)
+{
+    lote_t *lote = (lote_t *)malloc(sizeof(lote_t));
+    if (lote == NULL)
+        return NULL;
+
+    lote->cantidad = *p++;
+    for (int i = 0; i < lote->cantidad && p != NULL; i++)
+    {
+        operacion_t *operacion = &lote->operaciones[i];
+        if (fin - p < 9)
+            p = NULL;
+        else
+        {
+            operacion->petition = (enum BOOK_REQUEST_T)*p++;
+            p = leerEntero(p, &operacion->ISBN);
+            p = leerEntero(p, &operacion->n_copy);
+            p = leerCadena(p, fin, operacion->name);
+        }
+    }
+
+    if (p == NULL)
+    {
+        free(lote);
+        return NULL;
+    }
+
+    *destino = lote;
+    return p;
+}
+
+/* ------------------------------ Codificación ------------------------------ */
+
+int saltarMensaje(const unsigned char *datos, int n)
+{
+    //! 1. Un paquet_t clásico inválido (un LOTE) ocupa lo mismo que uno válido
+    if (n >= 4 && (datos[0] != MARCA_COMPACTA || datos[3] != MARCA_COMPACTA))
+        return (n < (int)sizeof(paquet_t)) ? n : (int)sizeof(paquet_t);
+
+    //! 2. Cabecera compacta con una longitud creíble: sólo su contenido es malo
+    if (n >= TAM_CABECERA_COMPACTA && datos[1] == VERSION_COMPACTA)
+    {
+        uint16_t longitud;
+        memcpy(&longitud, datos + 12, sizeof(longitud));
+
+        int total = TAM_CABECERA_COMPACTA + ntohs(longitud);
+        if (total <= TAM_MAX_MENSAJE && total <= n)
+            return total;
+    }
+
+    //! 3. Si no, la siguiente marca (puede quedar cortada al final)
+    for (int j = 1; j < n; j++)
+        if (datos[j] == MARCA_COMPACTA && (j + 3 >= n || datos[j + 3] == MARCA_COMPACTA))
+            return j;
+
+    return n;
+}
+
+bool llevaOperaciones(const paquet_t *paquete)
+{
+    return paquete->type == LOTE || paquete->type == TRANSACCION;
+}
+
+void liberarPaquete(paquet_t *paquete)
+{
+    if (llevaOperaciones(paquete))
+    {
+        free(paquete->data.lote);
+        paquete->data.lote = NULL;
+    }
+}
+
+int tamOperacion(const operacion_t *operacion)
+{
+    return 1 + 2 * sizeof(int32_t) + 1 + strnlen(operacion->name, TAM_STRING - 1);
+}
+
+int codificarPaquete(const paquet_t *paquete, int formato, unsigned char *destino)
+{
+    // El paquete clásico sólo tendría el apuntador a las operaciones
+    if (formato == FORMATO_CLASICO && !llevaOperaciones(paquete))
+    {
+        memcpy(destino, paquete, sizeof(paquet_t));
+        return sizeof(paquet_t);
+    }
+
+    //! 1. Contenido según el tipo
+    unsigned char *p = destino + TAM_CABECERA_COMPACTA;
+    const book_t *libro = &paquete->data.libro;
+    const struct PAQUET_RESULTADOS_T *resultados = &paquete->data.resultados;
+    const struct PAQUET_PRESTAMOS_T *prestamos = &paquete->data.prestamos;
+
+    switch (paquete->type)
+    {
+    case SIGNAL:
+        p = escribirEntero(p, paquete->data.signal.code);
+        *p++ = (unsigned char)paquete->data.signal.version;
+        p = escribirCadena(p, paquete->data.signal.buffer);
+        break;
+
+    case BOOK:
+        *p++ = (unsigned char)libro->petition;
+        p = escribirEntero(p, libro->ISBN);
+        p = escribirCadena(p, libro->name);
+        p = escribirEntero(p, libro->n_copies);
+        p = escribirEntero(p, libro->copyInfo.n_copy);
+        *p++ = (unsigned char)libro->copyInfo.state;
+        p = escribirCadena(p, libro->copyInfo.date);
+        break;
+
+    case LOTE:
+    case TRANSACCION:
+        *p++ = (unsigned char)paquete->data.lote->cantidad;
+        for (int i = 0; i < paquete->data.lote->cantidad; i++)
+        {
+            const operacion_t *operacion = &paquete->data.lote->operaciones[i];
+            *p++ = (unsigned char)operacion->petition;
+            p = escribirEntero(p, operacion->ISBN);
+            p = escribirEntero(p, operacion->n_copy);
+            p = escribirCadena(p, operacion->name);
+        }
+        break;
+
+    case RESULTADOS:
+        *p++ = (unsigned char)resultados->cantidad;
+        for (int i = 0; i < resultados->cantidad; i++)
+        {
+            uint16_t ejemplar = htons((uint16_t)resultados->ejemplares[i]);
+            *p++ = (unsigned char)resultados->codigos[i];
+            memcpy(p, &ejemplar, sizeof(ejemplar));
+            p += sizeof(ejemplar);
+        }
+        break;
+
+    case PRESTAMOS:
+        *p++ = prestamos->cantidad;
+        *p++ = prestamos->ultimo;
+        p = escribirEntero(p, prestamos->total);
+        for (int i = 0; i < prestamos->cantidad; i++)
+        {
+            p = escribirEntero(p, prestamos->prestamos[i].ISBN);
+            p = escribirEntero(p, prestamos->prestamos[i].n_copy);
+            p = escribirCadena(p, prestamos->prestamos[i].date);
+        }
+        break;
+
+    default: // ERR no tiene contenido
+        break;
+    }
+
+    //! 2. Cabecera
+    uint16_t longitud = htons((uint16_t)(p - destino - TAM_CABECERA_COMPACTA));
+    destino[0] = MARCA_COMPACTA;
+    destino[1] = VERSION_COMPACTA;
+    destino[2] = (unsigned char)paquete->type;
+    destino[3] = MARCA_COMPACTA;
+    escribirEntero(destino + 4, paquete->client);
+    escribirEntero(destino + 8, (int32_t)paquete->id);
+    memcpy(destino + 12, &longitud, sizeof(longitud));
+
+    return p - destino;
+}
+
+void sellarMensaje(unsigned char *mensaje, int formato, pid_t cliente, uint32_t id)
+{
+    if (formato == FORMATO_CLASICO)
+    {
+        memcpy(mensaje + offsetof(paquet_t, client), &cliente, sizeof(cliente));
+        memcpy(mensaje + offsetof(paquet_t, id), &id, sizeof(id));
+        return;
+    }
+
+    escribirEntero(mensaje + 4, cliente);
+    escribirEntero(mensaje + 8, (int32_t)id);
+}
+
+int decodificarPaquete(const unsigned char *datos, int n, paquet_t *paquete)
+{
+    if (n < 4)
+        return 0;
+
+    //! 1. Sin la marca es un paquet_t clásico (el PID es positivo)
+    if (datos[0] != MARCA_COMPACTA || datos[3] != MARCA_COMPACTA)
+    {
+        if (n < (int)sizeof(paquet_t))
+            return 0;
+
+        // Un apuntador que llega de otro proceso no se puede usar
+        memcpy(paquete, datos, sizeof(paquet_t));
+        if (llevaOperaciones(paquete))
+            return -1;
+
+        return sizeof(paquet_t);
+    }
+
+    //! 2. Cabecera compacta
+    if (n < TAM_CABECERA_COMPACTA)
+        return 0;
+
+    uint16_t longitud;
+    memcpy(&longitud, datos + 12, sizeof(longitud));
+    longitud = ntohs(longitud);
+
+    int total = TAM_CABECERA_COMPACTA + longitud;
+    if (datos[1] != VERSION_COMPACTA || total > TAM_MAX_MENSAJE)
+        return -1;
+
+    if (n < total)
+        return 0;
+
+    //! 3. Contenido, lo que no viaja queda en ceros
+    int32_t valor;
+    memset(paquete, 0, sizeof(paquet_t));
+    leerEntero(datos + 4, &paquete->client);
+    leerEntero(datos + 8, &valor);
+    paquete->id = (uint32_t)valor;
+    paquete->type = (enum PAQUET_TYPE_T)datos[2];
+
+    const unsigned char *p = datos + TAM_CABECERA_COMPACTA;
+    const unsigned char *fin = datos + total;
+    book_t *libro = &paquete->data.libro;
+    struct PAQUET_RESULTADOS_T *resultados = &paquete->data.resultados;
+    struct PAQUET_PRESTAMOS_T *prestamos = &paquete->data.prestamos;
+
+    switch (paquete->type)
+    {
+    case SIGNAL:
+        if (fin - p < 5)
+            return -1;
+        p = leerEntero(p, &paquete->data.signal.code);
+        paquete->data.signal.version = *p++;
+        p = leerCadena(p, fin, paquete->data.signal.buffer);
+        break;
+
+    case BOOK:
+        if (fin - p < 5)
+            return -1;
+        libro->petition = (enum BOOK_REQUEST_T)*p++;
+        p = leerEntero(p, &libro->ISBN);
+        p = leerCadena(p, fin, libro->name);
+        if (p == NULL || fin - p < 9)
+            return -1;
+        p = leerEntero(p, &libro->n_copies);
+        p = leerEntero(p, &valor);
+        libro->copyInfo.n_copy = valor;
+        libro->copyInfo.state = (char)*p++;
+        p = leerCadena(p, fin, libro->copyInfo.date);
+        break;
+
+    case LOTE:
+    case TRANSACCION:
+        if (fin - p < 1 || *p == 0 || *p > MAX_LOTE)
+            return -1;
+        p = leerLote(p, fin, &paquete->data.lote);
+        break;
+
+    case RESULTADOS:
+        if (fin - p < 1 || *p > MAX_LOTE || fin - p != 1 + *p * 3)
+            return -1;
+        resultados->cantidad = *p++;
+        for (int i = 0; i < resultados->cantidad; i++)
+        {
+            uint16_t ejemplar;
+            resultados->codigos[i] = (signed char)*p++;
+            memcpy(&ejemplar, p, sizeof(ejemplar));
+            resultados->ejemplares[i] = (short)ntohs(ejemplar);
+            p += sizeof(ejemplar);
+        }
+        break;
+
+    case PRESTAMOS:
+        if (fin - p < 6 || p[0] > MAX_PRESTAMOS_PAQUETE)
+            return -1;
+        prestamos->cantidad = *p++;
+        prestamos->ultimo = *p++;
+        p = leerEntero(p, &valor);
+        prestamos->total = (short)valor;
+        for (int i = 0; i < prestamos->cantidad && p != NULL; i++)
+        {
+            if (fin - p < 9)
+                return -1;
+            p = leerEntero(p, &prestamos->prestamos[i].ISBN);
+            p = leerEntero(p, &valor);
+            prestamos->prestamos[i].n_copy = (short)valor;
+
+            // La fecha debe caber en TAM_FECHA
+            if (*p >= TAM_FECHA)
+                return -1;
+            p = leerCadena(p, fin, prestamos->prestamos[i].date);
+        }
+        break;
+
+    case ERR:
+        break;
+
+    default:
+        return -1;
+    }
+
+    // El contenido debe ocupar exactamente lo que dice la cabecera
+    if (p != fin)
+    {
+        liberarPaquete(paquete);
+        return -1;
+    }
+
+    return total;
+}
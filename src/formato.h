@@ -0,0 +1,131 @@
+/**
+ * @file formato.h
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Formato compacto de los paquetes: cabecera fija, contenido según el
+ * tipo y cadenas precedidas de su longitud
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#ifndef __FORMATO_H__
+#define __FORMATO_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include "paquet.h"
+
+/* ----------------------------- Definiciones ----------------------------- */
+
+#define FORMATO_CLASICO 0  /**< paquet_t tal cual está en memoria*/
+#define FORMATO_COMPACTO 1 /**< Cabecera + contenido de longitud variable*/
+
+#define VERSION_COMPACTA 2 /**< Versión del formato compacto que se habla
+                                (2: la cabecera lleva el id de la petición)*/
+
+/* Cabecera compacta (orden de red):
+     0       MARCA_COMPACTA
+     1       versión
+     2       tipo del paquete
+     3       MARCA_COMPACTA
+     4..7    cliente (int32)
+     8..11   identificador de la petición (uint32)
+     12..13  longitud del contenido (uint16)
+   La marca va en el primer y el cuarto byte: leídos como el pid_t de un
+   paquet_t clásico darían un número negativo en cualquier endianness, así
+   ambos formatos pueden compartir el pipe (Cliente->Servidor) */
+#define MARCA_COMPACTA 0xB5u
+#define TAM_CABECERA_COMPACTA 14
+
+/**< Mayor mensaje posible en cualquiera de los dos formatos (un LOTE), no
+     supera PIPE_BUF: la escritura en el pipe compartido sigue siendo atómica*/
+#define TAM_MAX_MENSAJE PIPE_BUF
+#define TAM_TRAMA_TCP (TAM_CABECERA_TCP + TAM_MAX_MENSAJE) /**< Longitud + mensaje*/
+
+/* Un LOTE sólo existe en el formato compacto: cantidad de operaciones (uint8)
+   y por cada una petición (uint8), ISBN, ejemplar y nombre. Su respuesta
+   (RESULTADOS) cabe en un paquet_t y viaja en el formato del Cliente. Una
+   TRANSACCION se escribe igual que un LOTE */
+#define TAM_LOTE_VACIO (TAM_CABECERA_COMPACTA + 1) /**< Mensaje LOTE sin operaciones*/
+
+/* ------------------------ Prototipos de funciones ------------------------ */
+
+/**
+ * @brief Escribir un paquete en el formato indicado (un LOTE o una
+ * TRANSACCION siempre en el compacto)
+ *
+ * @param paquete Paquete a codificar
+ * @param formato FORMATO_CLASICO o FORMATO_COMPACTO
+ * @param destino RETORNA: bytes del mensaje (al menos \ref TAM_MAX_MENSAJE)
+ * @return int Longitud del mensaje
+ */
+int codificarPaquete(const paquet_t *paquete, int formato, unsigned char *destino);
+
+/**
+ * @brief Cambiar el cliente y el identificador de un mensaje ya escrito, así
+ * una misma respuesta codificada sirve para cualquier petición
+ *
+ * @param mensaje Mensaje escrito por \ref codificarPaquete (no un LOTE)
+ * @param formato Formato en el que se escribió
+ * @param cliente Cliente destino
+ * @param id Identificador de la petición que se responde
+ */
+void sellarMensaje(unsigned char *mensaje, int formato, pid_t cliente, uint32_t id);
+
+/**
+ * @brief Leer el primer mensaje de un flujo de bytes, el formato se reconoce
+ * por la marca de la cabecera
+ * @note Un LOTE o una TRANSACCION se decodifica en memoria reservada
+ * (paquete->data.lote) que debe liberar quien lo atiende; en el formato
+ * clásico no es válido
+ *
+ * @param datos Bytes recibidos
+ * @param n Cantidad de bytes
+ * @param paquete RETORNA: paquete decodificado
+ * @return int Bytes que ocupa el mensaje, 0 si aún está incompleto o -1 si
+ * no es un mensaje válido
+ */
+int decodificarPaquete(const unsigned char *datos, int n, paquet_t *paquete);
+
+/**
+ * @brief Bytes que hay que saltar después de un mensaje que \ref
+ * decodificarPaquete no aceptó para llegar al siguiente: el mensaje completo
+ * si su longitud es creíble, si no hasta la próxima marca compacta
+ *
+ * @param datos Bytes desde el mensaje inválido
+ * @param n Cantidad de bytes
+ * @return int Bytes a saltar (al menos 1, n si no hay otra marca)
+ */
+int saltarMensaje(const unsigned char *datos, int n);
+
+/**
+ * @brief Saber si el paquete lleva operaciones en memoria reservada (LOTE o
+ * TRANSACCION), que no pueden viajar como un paquet_t clásico
+ *
+ * @param paquete Paquete
+ * @return true si paquete->data.lote es válido
+ */
+bool llevaOperaciones(const paquet_t *paquete);
+
+/**
+ * @brief Liberar la memoria que reservó \ref decodificarPaquete (sólo la
+ * tiene un LOTE o una TRANSACCION)
+ *
+ * @param paquete Paquete decodificado
+ */
+void liberarPaquete(paquet_t *paquete);
+
+/**
+ * @brief Bytes que ocupa una operación dentro de un mensaje LOTE, para saber
+ * cuántas caben en \ref TAM_MAX_MENSAJE
+ *
+ * @param operacion Operación a medir
+ * @return int Bytes de la operación codificada
+ */
+int tamOperacion(const operacion_t *operacion);
+
+#endif // __FORMATO_H__
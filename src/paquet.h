@@ -23,11 +23,42 @@
  */
 enum PAQUET_TYPE_T
 {
-    SIGNAL, /**< asociado struct \ref PAQUET_SIGNAL_T*/
-    BOOK,   /**< asociado struct \ref book*/
-    ERR     /**< NO TIENE TIPO DE DATO ASOCIADO (Sólo señalar errores)*/
+    SIGNAL,    /**< asociado struct \ref PAQUET_SIGNAL_T*/
+    BOOK,      /**< asociado struct \ref book*/
+    ERR,       /**< NO TIENE TIPO DE DATO ASOCIADO (Sólo señalar errores)*/
+    LOTE,       /**< asociado \ref lote_t (Cliente->Servidor)*/
+    RESULTADOS, /**< asociado struct \ref PAQUET_RESULTADOS_T (Servidor->Cliente)*/
+    PRESTAMOS,  /**< asociado struct \ref PAQUET_PRESTAMOS_T (Servidor->Cliente)*/
+    TRANSACCION /**< asociado \ref lote_t sólo con SOLICITAR: se prestan todos
+                     o ninguno (Cliente->Servidor)*/
 };
 
+#define MAX_LOTE 64              /**< Máxima cantidad de operaciones en un lote*/
+#define MAX_PRESTAMOS_PAQUETE 10 /**< Préstamos listados en cada paquete PRESTAMOS*/
+#define TAM_FECHA 11             /**< Fecha "dd-mm-YYYY" con su fin de cadena*/
+
+/**
+ * @struct operacion_t
+ * @brief Operación de un lote: una petición de libro sin el resto de \ref book_t
+ */
+typedef struct
+{
+    enum BOOK_REQUEST_T petition; /**< SOLICITAR, RENOVAR o DEVOLVER*/
+    int ISBN;                     /**< ISBN del libro*/
+    int n_copy;                   /**< Ejemplar (0 = el primero al que aplique)*/
+    char name[TAM_STRING];        /**< Nombre del libro*/
+} operacion_t;
+
+/**
+ * @struct lote_t
+ * @brief Operaciones independientes que viajan en un solo mensaje
+ */
+typedef struct
+{
+    int cantidad;                      /**< Operaciones en el lote*/
+    operacion_t operaciones[MAX_LOTE]; /**< Operaciones en el orden del archivo*/
+} lote_t;
+
 /**
  * @struct PAQUET_SIGNAL_T
  * @brief Estructura que compone una señal
@@ -35,9 +66,49 @@ enum PAQUET_TYPE_T
 struct PAQUET_SIGNAL_T
 {
     int code;                /**< Código de la señal*/
+    int version;             /**< START_COM/SUCCEED_COM: versión del formato compacto
+                                  que se propone/acepta (0 = sólo el clásico)*/
     char buffer[TAM_STRING]; /**< Buffer opcional*/
 };
 
+/**
+ * @struct PAQUET_RESULTADOS_T
+ * @brief Respuesta a un lote: el resultado de cada operación en el mismo orden
+ * @note Cabe en la unión, así viaja por las mismas colas que cualquier respuesta
+ */
+struct PAQUET_RESULTADOS_T
+{
+    int cantidad;                  /**< Operaciones respondidas*/
+    signed char codigos[MAX_LOTE]; /**< SOLICITUD, RENOVACION, DEVOLUCION, PET_ERROR,
+                                        PET_EXPIRADA o PET_ABORTADA*/
+    short ejemplares[MAX_LOTE];    /**< Ejemplar afectado (0 si la operación falló)*/
+};
+
+/**
+ * @struct prestamo_t
+ * @brief Préstamo activo de un cliente, sin el resto de \ref book_t
+ */
+typedef struct
+{
+    int ISBN;              /**< ISBN del libro*/
+    short n_copy;          /**< Ejemplar prestado*/
+    char date[TAM_FECHA];  /**< Fecha de entrega*/
+} prestamo_t;
+
+/**
+ * @struct PAQUET_PRESTAMOS_T
+ * @brief Parte de la respuesta a MIS_PRESTAMOS: la lista completa viaja en
+ * varios paquetes con el mismo id, el último lleva la marca 'ultimo'
+ * @note Cabe en la unión, así viaja por las mismas colas que cualquier respuesta
+ */
+struct PAQUET_PRESTAMOS_T
+{
+    unsigned char cantidad; /**< Préstamos en este paquete*/
+    unsigned char ultimo;   /**< 1 en el último paquete de la respuesta*/
+    short total;            /**< Préstamos del cliente en toda la respuesta*/
+    prestamo_t prestamos[MAX_PRESTAMOS_PAQUETE]; /**< Préstamos de este paquete*/
+};
+
 /**
  * @union PAQUET_DATATYPE_T
  * @brief Datos del mensaje transmitido por \ref paquet_t,
@@ -47,6 +118,10 @@ union PAQUET_DATATYPE_T
 {
     struct PAQUET_SIGNAL_T signal; /**< Datos de la señal*/
     book_t libro;           /**< Datos del libro*/
+    lote_t *lote;           /**< Operaciones del lote o la transacción (reservadas al decodificarlo,
+                                 sólo existe en memoria, ver \ref formato.h)*/
+    struct PAQUET_RESULTADOS_T resultados; /**< Resultados del lote*/
+    struct PAQUET_PRESTAMOS_T prestamos;   /**< Préstamos de un cliente*/
 };
 
 /* ------------------------- ! ESTRUCTURA A USAR ¡ ------------------------- */
@@ -66,6 +141,8 @@ typedef struct
 {
     pid_t client;                 /**< PID del cliente que envió o recibe el paquete*/
     enum PAQUET_TYPE_T type;      /**< Tipo del paquete*/
+    uint32_t id;                  /**< Identificador de la petición, la respuesta
+                                       lo repite (0 = sin identificador)*/
     union PAQUET_DATATYPE_T data; /**< Contenido del paquete*/
 } paquet_t;
 
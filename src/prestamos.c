@@ -0,0 +1,147 @@
+/**
+ * @file prestamos.c
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Índice de préstamos: qué cliente tiene cada ejemplar prestado
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#include <stdint.h>
+
+#include "prestamos.h"
+
+/* --------------------------------- Índice --------------------------------- */
+
+static int casillaPrestamo(pid_t cliente, int ISBN)
+{
+    // Hash multiplicativo (Fibonacci) de ambas llaves, igual que los clientes
+    uint32_t llave = ((uint32_t)cliente * 2654435761u) ^ (uint32_t)ISBN;
+    return (int)((llave * 2654435761u) & (TAM_INDICE_PRESTAMOS - 1));
+}
+
+static int casillaCliente(pid_t cliente)
+{
+    return (int)(((uint32_t)cliente * 2654435761u) & (TAM_INDICE_PRESTAMOS - 1));
+}
+
+// Quitar una posición de una cadena simple
+static void desenlazar(int *enlace, int siguiente[], int posicion)
+{
+    while (*enlace != SIN_EJEMPLAR && *enlace != posicion)
+        enlace = &siguiente[*enlace];
+
+    if (*enlace == posicion)
+        *enlace = siguiente[posicion];
+
+    siguiente[posicion] = SIN_EJEMPLAR;
+}
+
+pid_t prestatarioLector(int lector)
+{
+    return ID_BASE_LECTOR + lector;
+}
+
+int lectorPrestatario(pid_t prestatario)
+{
+    return (prestatario > ID_BASE_LECTOR) ? prestatario - ID_BASE_LECTOR : SIN_LECTOR;
+}
+
+void iniciarPrestamos(indice_prestamos_t *indice)
+{
+    for (int i = 0; i < TAM_INDICE_PRESTAMOS; i++)
+    {
+        indice->casillas[i] = SIN_EJEMPLAR;
+        indice->casillasCliente[i] = SIN_EJEMPLAR;
+    }
+
+    for (int i = 0; i < MAX_CANT_LIBROS; i++)
+    {
+        indice->siguiente[i] = SIN_EJEMPLAR;
+        indice->siguienteCliente[i] = SIN_EJEMPLAR;
+        indice->prestatario[i] = SIN_PRESTATARIO;
+    }
+}
+
+void registrarPrestamo(indice_prestamos_t *indice,
+                       const book_t ejemplar[],
+                       int posicion,
+                       pid_t cliente)
+{
+    // Un ejemplar prestado de nuevo sin devolverse (no debería pasar)
+    quitarPrestamo(indice, ejemplar, posicion);
+
+    int casilla = casillaPrestamo(cliente, ejemplar[posicion].ISBN);
+    indice->prestatario[posicion] = cliente;
+    indice->siguiente[posicion] = indice->casillas[casilla];
+    indice->casillas[casilla] = posicion;
+
+    casilla = casillaCliente(cliente);
+    indice->siguienteCliente[posicion] = indice->casillasCliente[casilla];
+    indice->casillasCliente[casilla] = posicion;
+}
+
+void quitarPrestamo(indice_prestamos_t *indice, const book_t ejemplar[], int posicion)
+{
+    pid_t cliente = indice->prestatario[posicion];
+    if (cliente == SIN_PRESTATARIO)
+        return;
+
+    // Desenlazar de sus dos casillas
+    desenlazar(&indice->casillas[casillaPrestamo(cliente, ejemplar[posicion].ISBN)],
+               indice->siguiente, posicion);
+    desenlazar(&indice->casillasCliente[casillaCliente(cliente)],
+               indice->siguienteCliente, posicion);
+
+    indice->prestatario[posicion] = SIN_PRESTATARIO;
+}
+
+int buscarPrestamo(const indice_prestamos_t *indice,
+                   const book_t ejemplar[],
+                   pid_t cliente,
+                   int ISBN)
+{
+    // La casilla sólo tiene los préstamos que caen en ella, no toda la BD
+    int i = indice->casillas[casillaPrestamo(cliente, ISBN)];
+    while (i != SIN_EJEMPLAR &&
+           (indice->prestatario[i] != cliente || ejemplar[i].ISBN != ISBN))
+        i = indice->siguiente[i];
+
+    return i;
+}
+
+bool puedeDevolver(const indice_prestamos_t *indice,
+                   int posicion,
+                   pid_t prestatario,
+                   bool porNumero)
+{
+    // Un ejemplar sin prestatario no es de quien lo pide: sólo si lo nombra
+    if (indice->prestatario[posicion] == SIN_PRESTATARIO)
+        return porNumero;
+
+    return indice->prestatario[posicion] == prestatario;
+}
+
+int primerPrestamo(const indice_prestamos_t *indice, pid_t cliente)
+{
+    // La casilla puede tener ejemplares de otros clientes
+    int i = indice->casillasCliente[casillaCliente(cliente)];
+    while (i != SIN_EJEMPLAR && indice->prestatario[i] != cliente)
+        i = indice->siguienteCliente[i];
+
+    return i;
+}
+
+int siguientePrestamo(const indice_prestamos_t *indice, int posicion)
+{
+    pid_t cliente = indice->prestatario[posicion];
+
+    int i = indice->siguienteCliente[posicion];
+    while (i != SIN_EJEMPLAR && indice->prestatario[i] != cliente)
+        i = indice->siguienteCliente[i];
+
+    return i;
+}
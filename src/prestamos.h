@@ -0,0 +1,144 @@
+/**
+ * @file prestamos.h
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Índice de préstamos: qué cliente tiene cada ejemplar prestado
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#ifndef __PRESTAMOS_H__
+#define __PRESTAMOS_H__
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include "book.h"
+
+/* ----------------------------- Definiciones ----------------------------- */
+
+#define TAM_INDICE_PRESTAMOS 256 /**< Casillas del índice (potencia de 2, más que MAX_CANT_LIBROS)*/
+#define SIN_PRESTATARIO 0        /**< Ejemplar disponible o prestado sin prestatario en la base de datos*/
+#define SIN_EJEMPLAR -1          /**< Fin de una casilla o ejemplar no encontrado*/
+#define ID_BASE_LECTOR (1 << 30) /**< Prestatarios con número de lector (mayores que los PID y los clientes TCP)*/
+
+/* ------------------------------ Estructuras ------------------------------ */
+
+/**
+ * @struct indice_prestamos_t
+ * @brief Dos tablas hash sobre los ejemplares prestados, encadenadas por las
+ * mismas posiciones de la base de datos (cada ejemplar está a lo sumo en una
+ * casilla de cada tabla, así que no hace falta memoria aparte):
+ * (cliente, ISBN) -> ejemplar y cliente -> todos sus ejemplares
+ * @note Sólo el prestatario con número de lector se guarda con la base de
+ * datos; el índice se protege con el mismo semáforo que ella
+ */
+typedef struct
+{
+    int casillas[TAM_INDICE_PRESTAMOS];        /**< Primer ejemplar de cada casilla (cliente, ISBN)*/
+    int siguiente[MAX_CANT_LIBROS];            /**< Siguiente ejemplar de la misma casilla*/
+    int casillasCliente[TAM_INDICE_PRESTAMOS]; /**< Primer ejemplar de cada casilla (cliente)*/
+    int siguienteCliente[MAX_CANT_LIBROS];     /**< Siguiente ejemplar de la misma casilla*/
+    pid_t prestatario[MAX_CANT_LIBROS];        /**< Cliente o lector que tiene cada ejemplar*/
+} indice_prestamos_t;
+
+/* ------------------------ Prototipos de funciones ------------------------ */
+
+/**
+ * @brief Iniciar el índice sin préstamos registrados
+ *
+ * @param indice Índice a iniciar
+ */
+void iniciarPrestamos(indice_prestamos_t *indice);
+
+/**
+ * @brief Prestatario de un lector: el mismo en cualquier conexión y después de
+ * reiniciar el servidor
+ *
+ * @param lector Número de lector (de 1 a MAX_LECTOR)
+ * @return pid_t Prestatario para el índice
+ */
+pid_t prestatarioLector(int lector);
+
+/**
+ * @brief Número de lector de un prestatario
+ *
+ * @param prestatario Prestatario del índice
+ * @return int Número de lector o SIN_LECTOR si es un cliente sin número (un
+ * PID o un identificador TCP, que no sirven después de reiniciar)
+ */
+int lectorPrestatario(pid_t prestatario);
+
+/**
+ * @brief Registrar que un cliente tiene un ejemplar
+ *
+ * @param indice Índice de préstamos
+ * @param ejemplar Base de datos
+ * @param posicion Posición del ejemplar prestado en la base de datos
+ * @param cliente Cliente que lo tiene
+ */
+void registrarPrestamo(indice_prestamos_t *indice,
+                       const book_t ejemplar[],
+                       int posicion,
+                       pid_t cliente);
+
+/**
+ * @brief Quitar el préstamo de un ejemplar (devuelto), no hace nada si no
+ * estaba registrado
+ *
+ * @param indice Índice de préstamos
+ * @param ejemplar Base de datos
+ * @param posicion Posición del ejemplar en la base de datos
+ */
+void quitarPrestamo(indice_prestamos_t *indice, const book_t ejemplar[], int posicion);
+
+/**
+ * @brief Ejemplar de un libro que tiene un cliente
+ *
+ * @param indice Índice de préstamos
+ * @param ejemplar Base de datos
+ * @param cliente Cliente
+ * @param ISBN ISBN del libro
+ * @return int Posición del ejemplar en la base de datos o SIN_EJEMPLAR
+ */
+int buscarPrestamo(const indice_prestamos_t *indice,
+                   const book_t ejemplar[],
+                   pid_t cliente,
+                   int ISBN);
+
+/**
+ * @brief Saber si un prestatario puede renovar o devolver un ejemplar: lo
+ * tiene él, o nadie lo tiene registrado y lo pidió por su número
+ *
+ * @param indice Índice de préstamos
+ * @param posicion Posición del ejemplar en la base de datos
+ * @param prestatario Prestatario que lo pide
+ * @param porNumero La petición nombra el ejemplar (no es "el primero")
+ * @return true si puede
+ */
+bool puedeDevolver(const indice_prestamos_t *indice,
+                   int posicion,
+                   pid_t prestatario,
+                   bool porNumero);
+
+/**
+ * @brief Primer ejemplar que tiene un cliente, sin recorrer la base de datos
+ *
+ * @param indice Índice de préstamos
+ * @param cliente Cliente
+ * @return int Posición del ejemplar en la base de datos o SIN_EJEMPLAR
+ */
+int primerPrestamo(const indice_prestamos_t *indice, pid_t cliente);
+
+/**
+ * @brief Siguiente ejemplar del mismo cliente (ver \ref primerPrestamo)
+ *
+ * @param indice Índice de préstamos
+ * @param posicion Ejemplar anterior del cliente
+ * @return int Posición del ejemplar en la base de datos o SIN_EJEMPLAR
+ */
+int siguientePrestamo(const indice_prestamos_t *indice, int posicion);
+
+#endif // __PRESTAMOS_H__
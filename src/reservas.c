@@ -0,0 +1,113 @@
+/**
+ * @file reservas.c
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Colas de reserva: clientes que esperan un ejemplar de cada título
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#include "reservas.h"
+
+/* --------------------------------- Colas --------------------------------- */
+
+void iniciarReservas(colas_reserva_t *colas)
+{
+    // Todas las reservas en la lista libre
+    for (int i = 0; i < MAX_RESERVAS; i++)
+    {
+        colas->reservas[i].titulo = SIN_RESERVA;
+        colas->reservas[i].siguiente = (i + 1 < MAX_RESERVAS) ? i + 1 : SIN_RESERVA;
+    }
+    colas->libre = 0;
+
+    for (int i = 0; i < MAX_CANT_LIBROS; i++)
+    {
+        colas->primera[i] = SIN_RESERVA;
+        colas->ultima[i] = SIN_RESERVA;
+    }
+}
+
+int encolarReserva(colas_reserva_t *colas, int titulo, pid_t cliente, uint32_t id)
+{
+    //! 1. Un cliente espera a lo sumo una vez cada título
+    int posicion = 1;
+    for (int i = colas->primera[titulo]; i != SIN_RESERVA;
+         i = colas->reservas[i].siguiente, posicion++)
+        if (colas->reservas[i].cliente == cliente)
+            return 0;
+
+    //! 2. Tomar una reserva libre
+    int nueva = colas->libre;
+    if (nueva == SIN_RESERVA)
+        return -1;
+
+    colas->libre = colas->reservas[nueva].siguiente;
+    colas->reservas[nueva].cliente = cliente;
+    colas->reservas[nueva].id = id;
+    colas->reservas[nueva].titulo = titulo;
+    colas->reservas[nueva].siguiente = SIN_RESERVA;
+
+    //! 3. Al final de la cola
+    if (colas->ultima[titulo] == SIN_RESERVA)
+        colas->primera[titulo] = nueva;
+    else
+        colas->reservas[colas->ultima[titulo]].siguiente = nueva;
+
+    colas->ultima[titulo] = nueva;
+    return posicion;
+}
+
+bool sacarReserva(colas_reserva_t *colas, int titulo, reserva_t *reserva)
+{
+    int primera = colas->primera[titulo];
+    if (primera == SIN_RESERVA)
+        return false;
+
+    *reserva = colas->reservas[primera];
+
+    colas->primera[titulo] = colas->reservas[primera].siguiente;
+    if (colas->primera[titulo] == SIN_RESERVA)
+        colas->ultima[titulo] = SIN_RESERVA;
+
+    // Devolver la reserva a la lista libre
+    colas->reservas[primera].titulo = SIN_RESERVA;
+    colas->reservas[primera].siguiente = colas->libre;
+    colas->libre = primera;
+    return true;
+}
+
+int quitarReservasCliente(colas_reserva_t *colas, pid_t cliente)
+{
+    int quitadas = 0;
+    for (int r = 0; r < MAX_RESERVAS; r++)
+    {
+        int titulo = colas->reservas[r].titulo;
+        if (titulo == SIN_RESERVA || colas->reservas[r].cliente != cliente)
+            continue;
+
+        //! 1. Desenlazarla de la cola de su título
+        int anterior = SIN_RESERVA;
+        for (int i = colas->primera[titulo]; i != r; i = colas->reservas[i].siguiente)
+            anterior = i;
+
+        if (anterior == SIN_RESERVA)
+            colas->primera[titulo] = colas->reservas[r].siguiente;
+        else
+            colas->reservas[anterior].siguiente = colas->reservas[r].siguiente;
+
+        if (colas->ultima[titulo] == r)
+            colas->ultima[titulo] = anterior;
+
+        //! 2. Devolverla a la lista libre
+        colas->reservas[r].titulo = SIN_RESERVA;
+        colas->reservas[r].siguiente = colas->libre;
+        colas->libre = r;
+        quitadas++;
+    }
+
+    return quitadas;
+}
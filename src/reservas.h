@@ -0,0 +1,95 @@
+/**
+ * @file reservas.h
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Colas de reserva: clientes que esperan un ejemplar de cada título
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#ifndef __RESERVAS_H__
+#define __RESERVAS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "book.h"
+
+/* ----------------------------- Definiciones ----------------------------- */
+
+#define MAX_RESERVAS 1024 /**< Clientes en espera entre todas las colas*/
+#define SIN_RESERVA -1    /**< Fin de una cola o de la lista libre*/
+
+/* ------------------------------ Estructuras ------------------------------ */
+
+/**
+ * @struct reserva_t
+ * @brief Cliente que espera un ejemplar
+ */
+typedef struct
+{
+    pid_t cliente; /**< Cliente que reservó*/
+    uint32_t id;   /**< Id de la petición RESERVAR, el aviso lo repite*/
+    int titulo;    /**< Cola en la que está (SIN_RESERVA si está libre)*/
+    int siguiente; /**< Siguiente reserva de la misma cola (o de la lista libre)*/
+} reserva_t;
+
+/**
+ * @struct colas_reserva_t
+ * @brief Una cola FIFO por título, identificado por la posición de su primer
+ * ejemplar en la base de datos; todas comparten un arreglo fijo de reservas
+ * @note Sólo vive en memoria, se protege con el mismo semáforo que la base de
+ * datos
+ */
+typedef struct
+{
+    reserva_t reservas[MAX_RESERVAS]; /**< Reservas (en alguna cola o libres)*/
+    int libre;                        /**< Primera reserva libre*/
+    int primera[MAX_CANT_LIBROS];     /**< Cabeza de la cola de cada título*/
+    int ultima[MAX_CANT_LIBROS];      /**< Cola de la cola de cada título*/
+} colas_reserva_t;
+
+/* ------------------------ Prototipos de funciones ------------------------ */
+
+/**
+ * @brief Iniciar todas las colas vacías
+ *
+ * @param colas Colas de reserva
+ */
+void iniciarReservas(colas_reserva_t *colas);
+
+/**
+ * @brief Poner a un cliente al final de la cola de un título
+ *
+ * @param colas Colas de reserva
+ * @param titulo Posición del primer ejemplar del título
+ * @param cliente Cliente que reserva
+ * @param id Id de la petición
+ * @return int Posición en la cola (1 = el próximo), 0 si el cliente ya estaba
+ * en ella o -1 si no quedan reservas libres
+ */
+int encolarReserva(colas_reserva_t *colas, int titulo, pid_t cliente, uint32_t id);
+
+/**
+ * @brief Sacar la reserva más antigua de un título
+ *
+ * @param colas Colas de reserva
+ * @param titulo Posición del primer ejemplar del título
+ * @param reserva RETORNA: reserva que estaba primero
+ * @return true si había alguna
+ */
+bool sacarReserva(colas_reserva_t *colas, int titulo, reserva_t *reserva);
+
+/**
+ * @brief Quitar todas las reservas de un cliente (se desconectó)
+ *
+ * @param colas Colas de reserva
+ * @param cliente Cliente que reservó
+ * @return int Cantidad de reservas quitadas
+ */
+int quitarReservasCliente(colas_reserva_t *colas, pid_t cliente);
+
+#endif // __RESERVAS_H__
@@ -13,6 +13,7 @@
 /* ------------------------------  Libraries ------------------------------ */
 #define _XOPEN_SOURCE // Para la función strptime()
 #define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE // Para syscall() (pidfd_open), accept4() y struct ucred
 
 // ISO C libraries
 #include <stdio.h>
@@ -20,6 +21,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
 
 // POSIX syscalls
 #include <unistd.h>
@@ -29,6 +31,18 @@
 #include <pthread.h>
 #include <semaphore.h>
 #include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
 
 // Header propias
 #include "server.h"
@@ -36,24 +50,63 @@
 #include "paquet.h"
 #include "book.h"
 #include "buffer.h"
+#include "uring.h"
+#include "shm.h"
+#include "formato.h"
+#include "prestamos.h"
+#include "reservas.h"
+#include "titulos.h"
 
 /* -------------------- Variables globales (Semáforos) -------------------- */
 
 sem_t semaforo_bd = {0};
 sem_t semaforo_clientes = {0};
+sem_t semaforo_salida = {0};
+sem_t semaforo_conexiones = {0};
+sem_t conexiones_nuevas = {0};
+sem_t timbreAnillos = {0};
+
+int epollServidor = -1; /**< epoll con todos los pipes del servidor*/
+int eventoSalida = -1;  /**< eventfd: un pipe (Servidor->Cliente) se llenó*/
+int eventoCierre = -1;  /**< eventfd: Ctrl+C, detener el bucle de eventos*/
 
 volatile bool isListening = true;
 
+bool salidaDiferida = false;    /**< io_uring: las respuestas se escriben en lote*/
+bool salidaPorPublicar = false; /**< Hay respuestas encoladas sin aviso al bucle*/
+
+int clientesTCP = 0;                 /**< Clientes TCP conectados (semáforo de salida)*/
+pid_t siguienteIdTCP = ID_BASE_TCP; /**< Identificador del próximo cliente TCP*/
+
+/* -------------------- Variables globales (Métricas) --------------------- */
+
+unsigned long peticionesAtendidas = 0; /**< Peticiones de libros procesadas*/
+unsigned long peticionesExpiradas = 0; /**< Peticiones descartadas por tiempo*/
+unsigned long clientesLentos = 0;      /**< Clientes desconectados por no leer*/
+unsigned long clientesCaidos = 0;      /**< Clientes que cerraron su pipe sin avisar*/
+unsigned long busquedasCombinadas = 0; /**< BUSCAR respondidos con la respuesta de otro idéntico*/
+unsigned long gruposCombinados = 0;    /**< BUSCAR cuya respuesta se repartió en la cola*/
+unsigned long despertares = 0;         /**< Veces que el hilo principal despertó*/
+unsigned long despertaresVacios = 0;   /**< Despertares sin ninguna petición*/
+double cpuReposo = 0;                  /**< CPU (s) consumida sin clientes conectados*/
+const char *backendES = "epoll";       /**< Bucle de eventos en uso*/
+
+/* ------------------ Variables globales (Catálogo local) ------------------ */
+
+catalogo_shm_t *catalogo = NULL; /**< Catálogo para los clientes de este equipo (NULL: no se publicó)*/
+
 /* --------------------------------- Main --------------------------------- */
 int main(int argc, char *argv[])
 {
     char pipeCLNT_SRVR[TAM_STRING],
         inputFilename[TAM_STRING],
         outputFilename[TAM_STRING];
+    struct opciones_servidor opciones;
 
     //! 1. Manejar los argumentos
     // 1.1 Cargar los argumentos
-    manejarArgumentos(argc, argv, pipeCLNT_SRVR, inputFilename, outputFilename);
+    manejarArgumentos(argc, argv, pipeCLNT_SRVR, inputFilename, outputFilename,
+                      &opciones);
 
     // 1.2 Verificar que el archivo de persistencia existe, si no existe, crearlo
     if (access(outputFilename, F_OK) != 0)
@@ -79,19 +132,63 @@ int main(int argc, char *argv[])
     //! 2. Base de datos
     // 2.1 Crear el arreglo de base de datos
     book_t booksDatabase[MAX_CANT_LIBROS];
-    // 2.2 Abrir la base de datos
-    int n_libros = leerDatabase(booksDatabase, inputFilename);
+    // 2.2 Abrir la base de datos (con el prestatario de cada préstamo)
+    indice_prestamos_t prestamos;
+    int n_libros = leerDatabase(booksDatabase, &prestamos, inputFilename);
+    // 2.3 Las colas de reserva sólo viven mientras el servidor está activo
+    colas_reserva_t reservas;
+    iniciarReservas(&reservas);
+    // 2.4 Índice de títulos para buscar por prefijo y por palabra
+    indice_titulos_t titulos;
+    iniciarTitulos(&titulos);
+    indexarTitulos(&titulos, booksDatabase, n_libros);
+    // 2.5 Respuestas BUSCAR ya escritas, válidas según la versión del título
+    cache_busqueda_t cache;
+    iniciarCache(&cache);
+    // 2.6 Catálogo de sólo lectura para los clientes de este equipo
+    catalogo = publicarCatalogo(booksDatabase, n_libros, &titulos);
+    if (catalogo == NULL)
+        fprintf(stderr, "No se publicó el catálogo local, las búsquedas irán al servidor\n");
 
     //! 3. Iniciar la comunicación (Escuchar a cualquier cliente)
-    int readPipe = iniciarComunicacion(pipeCLNT_SRVR);
+    // Cada cliente conectado ocupa un descriptor
+    aumentarLimiteArchivos();
 
-    // 3.2 Crear lista de los clientes (Memoria Dinámica)
-    struct client_list clients;
-    clients.n_clients = 0;
-    clients.clientArray = (client_t *)malloc(sizeof(client_t));
+    int writePipe;
+    int readPipe = iniciarComunicacion(pipeCLNT_SRVR, &writePipe);
+
+    // 3.1 Socket Unix opcional, los clientes que lo usan no pasan por el pipe
+    int socketEscucha = -1;
+    if (opciones.socketNom[0] != '\0' &&
+        (socketEscucha = abrirSocket(opciones.socketNom)) < 0)
+    {
+        perror(opciones.socketNom);
+        close(readPipe);
+        unlink(pipeCLNT_SRVR);
+        exit(ERROR_PIPE_CLNT_SRVR);
+    }
+
+    // 3.2 Socket TCP opcional para clientes remotos
+    int socketTCP = -1;
+    entrada_t **entradas = NULL;
+    if (opciones.direccionTCP[0] != '\0' &&
+        ((socketTCP = abrirTCP(opciones.direccionTCP)) < 0 ||
+         (entradas = (entrada_t **)calloc(MAX_CLIENTES, sizeof(entrada_t *))) == NULL))
+    {
+        fprintf(stderr, "No se pudo escuchar en %s\n", opciones.direccionTCP);
+        close(readPipe);
+        unlink(pipeCLNT_SRVR);
+        exit(ERROR_PIPE_CLNT_SRVR);
+    }
 
-    // 3.3 Paquete temporal donde se guarda lo recibido por el pipe
-    paquet_t package;
+    // 3.3 Crear la tabla de los clientes (Memoria Dinámica)
+    struct client_list clients;
+    if (iniciarClientes(&clients) != SUCCESS_GENERIC)
+    {
+        close(readPipe);
+        unlink(pipeCLNT_SRVR);
+        exit(ERROR_MEMORY);
+    }
 
     //! 4. Buffer interno con las peticiones
     // Crear el buffer intero
@@ -104,7 +201,7 @@ int main(int argc, char *argv[])
     {
         perror("Semaforo");
         // Liberar los recursos y salir
-        free(clients.clientArray);
+        liberarClientes(&clients);
         close(readPipe);
         unlink(pipeCLNT_SRVR);
         exit(ERROR_FATAL);
@@ -115,16 +212,60 @@ int main(int argc, char *argv[])
     {
         perror("Semaforo");
         // Liberar los recursos y salir
-        free(clients.clientArray);
+        liberarClientes(&clients);
+        close(readPipe);
+        unlink(pipeCLNT_SRVR);
+        exit(ERROR_FATAL);
+    }
+
+    //  5.3 Crear el semáforo para garantizar exclusión mutua en las colas de salida
+    if (sem_init(&semaforo_salida, 0, 1) ||
+        sem_init(&semaforo_conexiones, 0, 1) || sem_init(&conexiones_nuevas, 0, 0) ||
+        sem_init(&timbreAnillos, 0, 0))
+    {
+        perror("Semaforo");
+        // Liberar los recursos y salir
+        liberarClientes(&clients);
+        close(readPipe);
+        unlink(pipeCLNT_SRVR);
+        exit(ERROR_FATAL);
+    }
+
+    //  5.4 Crear el epoll con los eventfd internos, los pipes de los clientes se
+    //  registran al conectarse y el pipe (Cliente->Servidor) depende del bucle
+    epollServidor = epoll_create1(EPOLL_CLOEXEC);
+    eventoSalida = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    eventoCierre = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (epollServidor < 0 || eventoSalida < 0 || eventoCierre < 0 ||
+        registrarEvento(eventoSalida, EVENTO_SALIDA, EPOLLIN) ||
+        registrarEvento(eventoCierre, EVENTO_CIERRE, EPOLLIN) ||
+        (socketEscucha >= 0 && registrarEvento(socketEscucha, EVENTO_SOCKET, EPOLLIN)) ||
+        (socketTCP >= 0 && registrarEvento(socketTCP, EVENTO_TCP, EPOLLIN)))
+    {
+        perror("epoll");
+        // Liberar los recursos y salir
+        liberarClientes(&clients);
         close(readPipe);
         unlink(pipeCLNT_SRVR);
         exit(ERROR_FATAL);
     }
 
     //! 6. Llamar al hilo auxiliar
+    // Los hilos se crean con SIGINT bloqueado, así sólo el hilo principal la
+    // recibe
+    sigset_t senales;
+    sigemptyset(&senales);
+    sigaddset(&senales, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &senales, NULL);
+
     //6.1 Crear la estuctura con los parámetros
     struct arg_buffer parametros_buffer;
     parametros_buffer.booksDatabase = booksDatabase;
+    parametros_buffer.prestamos = &prestamos;
+    parametros_buffer.reservas = &reservas;
+    parametros_buffer.titulos = &titulos;
+    parametros_buffer.cache = &cache;
     parametros_buffer.buffer = &buffer_interno;
     parametros_buffer.clients = &clients;
 
@@ -132,31 +273,60 @@ int main(int argc, char *argv[])
     pthread_t hilo_aux;
     pthread_create(&hilo_aux, NULL, (void *)manejadorBuffer, (void *)&parametros_buffer);
 
-    // 6.3 Cargar el manejador de señales
-    signal(SIGINT, manejadorInterrupcion);
-
-    //! 7. Empezar a escuchar peticiones
-    // Leer contenidos del pipe continuamente hasta que no hayan lectores
-    bool messageShown = false;
-    while (isListening)
+    // 6.3 Crear el hilo que atiende las conexiones nuevas
+    struct conexiones_pendientes conexiones;
+    conexiones.n_conexiones = 0;
+
+    struct arg_conexiones parametros_conexiones;
+    parametros_conexiones.conexiones = &conexiones;
+    parametros_conexiones.clients = &clients;
+
+    pthread_t hilo_conexiones;
+    pthread_create(&hilo_conexiones, NULL,
+                   (void *)manejadorConexiones, (void *)&parametros_conexiones);
+
+    // 6.4 Crear el hilo que lee los anillos de memoria compartida
+    struct arg_anillos parametros_anillos;
+    parametros_anillos.buffer = &buffer_interno;
+    parametros_anillos.clients = &clients;
+
+    pthread_t hilo_anillos;
+    pthread_create(&hilo_anillos, NULL,
+                   (void *)manejadorAnillos, (void *)&parametros_anillos);
+
+    // 6.5 Cargar el manejador de señales (sin SA_RESTART para que epoll_wait()
+    // retorne EINTR)
+    struct sigaction interrupcion;
+    memset(&interrupcion, 0, sizeof(interrupcion));
+    interrupcion.sa_handler = manejadorInterrupcion;
+    sigemptyset(&interrupcion.sa_mask);
+    sigaction(SIGINT, &interrupcion, NULL);
+    pthread_sigmask(SIG_UNBLOCK, &senales, NULL);
+
+    // Un cliente que cierra su pipe no debe terminar al servidor (EPIPE)
+    signal(SIGPIPE, SIG_IGN);
+
+    //! 7. Empezar a escuchar peticiones (Bucle de eventos)
+    // Un único hilo atiende el pipe (Cliente->Servidor) y los pipes de todos
+    // los clientes
+    struct bucle_eventos bucle;
+    bucle.readPipe = readPipe;
+    bucle.socketEscucha = socketEscucha;
+    bucle.socketTCP = socketTCP;
+    bucle.entradas = entradas;
+    bucle.entradaPipe.n_datos = 0;
+    bucle.buffer = &buffer_interno;
+    bucle.conexiones = &conexiones;
+    bucle.clients = &clients;
+
+    // io_uring es opcional, si el kernel no lo permite se usa epoll
+    if (opciones.backend != BACKEND_URING || bucleUring(&bucle) != SUCCESS_GENERIC)
     {
-        // 7.1 Leer del pipe
-        int read_val = read(readPipe, &package, sizeof(package));
-
-        if (read_val == 0)
-        {
-            if (!messageShown)
-            {
-                fprintf(stdout, "\n\aTodos los clientes se han desconectado\n");
-                fprintf(stdout, "Esperando otras conexiones... (Presione Ctrl+C para detener)\n");
-                messageShown = true;
-            }
-            continue; // Saltar el queue
-        }
+        if (opciones.backend == BACKEND_URING)
+            fprintf(stderr, "AVISO: io_uring no disponible, se usa epoll\n");
 
-        messageShown = false;
-        // Montar la petición al arreglo de peticiones
-        queue(&buffer_interno, package);
+        if (bucleEpoll(&bucle) != SUCCESS_GENERIC)
+            isListening = false;
     }
 
     //! 8. Cierre (Liberación de recursos)
@@ -164,24 +334,80 @@ int main(int argc, char *argv[])
     fprintf(stdout,
             "\nTodos los clientes se han desconectado, cerrando el servidor...\n");
 
-    // Eliminar lista de clientes
-    free(clients.clientArray);
-
     // Deshacer el pipe de Servidor
+    close(writePipe);
     close(readPipe);
     unlink(pipeCLNT_SRVR);
 
+    if (socketEscucha >= 0)
+    {
+        close(socketEscucha);
+        unlink(opciones.socketNom);
+    }
+
+    if (socketTCP >= 0)
+    {
+        close(socketTCP);
+        for (int i = 0; i < MAX_CLIENTES; i++)
+            free(entradas[i]);
+        free(entradas);
+    }
+
     // Unir el thread
     pthread_kill(hilo_aux, SIGUSR1); // Mandar la misma interrupción al hilo
     pthread_join(hilo_aux, (void **)NULL);
 
+
+    // Despertar al hilo de conexiones para que termine
+    sem_post(&conexiones_nuevas);
+    pthread_join(hilo_conexiones, (void **)NULL);
+
+    // Despertar al hilo de anillos para que termine
+    despertarAnillos();
+    pthread_join(hilo_anillos, (void **)NULL);
+
+    // Eliminar lista de clientes y el epoll
+    liberarClientes(&clients);
+    close(eventoSalida);
+    close(eventoCierre);
+    close(epollServidor);
+
     // Liberar el semáforo
     sem_destroy(&semaforo_bd);
     sem_destroy(&semaforo_clientes);
+    sem_destroy(&semaforo_salida);
+    sem_destroy(&semaforo_conexiones);
+    sem_destroy(&conexiones_nuevas);
+    sem_destroy(&timbreAnillos);
 
     // Liberar el buffer interno
     destroy(&buffer_interno);
 
+    // Métricas de la cola
+    fprintf(stdout,
+            "Peticiones atendidas: %lu, expiradas en cola: %lu\n",
+            peticionesAtendidas, peticionesExpiradas);
+    fprintf(stdout,
+            "Clientes desconectados por no leer su pipe: %lu, por cerrarlo: %lu\n",
+            clientesLentos, clientesCaidos);
+    unsigned long busquedas = cache.aciertos + cache.fallos;
+    fprintf(stdout,
+            "Caché de BUSCAR: %lu aciertos, %lu fallos (%.1f%% de aciertos)\n",
+            cache.aciertos, cache.fallos,
+            busquedas > 0 ? 100.0 * cache.aciertos / busquedas : 0.0);
+    fprintf(stdout,
+            "BUSCAR combinados: %lu respondidos desde la cola en %lu grupos\n",
+            busquedasCombinadas, gruposCombinados);
+    liberarCache(&cache);
+    if (catalogo != NULL)
+        cerrarCatalogo(catalogo, true);
+    fprintf(stdout,
+            "Despertares del bucle de eventos (%s): %lu (%lu sin eventos)\n",
+            backendES, despertares, despertaresVacios);
+    fprintf(stdout,
+            "Tiempo de CPU: %.3fs en total, %.3fs sin clientes conectados\n",
+            segundosCPU(), cpuReposo);
+
     // Notificación
     fprintf(stdout,
             "Se ha cerrado el pipe (Cliente->Servidor)...\n");
@@ -190,19 +416,19 @@ int main(int argc, char *argv[])
 
     //! 9. Cierre (Actualización final a la BD)
     // Actualizar la BD (Persistencia de la BD)
-    if (actualizarDatabase(outputFilename, booksDatabase, n_libros))
+    if (actualizarDatabase(outputFilename, booksDatabase, &prestamos, n_libros))
     {
         fprintf(stderr,
                 "Hubo un error en el archivo de persistencia de la BD,\
 se reintentará la escritura al archivo..\n");
 
-        if (actualizarDatabase(outputFilename, booksDatabase, n_libros))
+        if (actualizarDatabase(outputFilename, booksDatabase, &prestamos, n_libros))
         {
             fprintf(stderr,
                     "El archivo de la base de datos puede estar dañado,\
 los cambios a la BD se mostrarán por pantalla:\n");
 
-            mostrarDatabasePantalla(booksDatabase, n_libros);
+            mostrarDatabasePantalla(booksDatabase, &prestamos, n_libros);
         }
     }
 
@@ -219,7 +445,8 @@ void mostrarUso(void)
 {
     fprintf(stdout,
             //"Uso: ./server -p pipeReceptor -f baseDeDatos -s archivoSalida\n");
-            "Uso: ./server -p pipeReceptor -f dataBase(Entrada)\n -s dataBase(Salida)");
+            "Uso: ./server -p pipeReceptor -f dataBase(Entrada)\n -s dataBase(Salida)\
+ [-b epoll|uring] [-u rutaSocket] [-l [host:]puerto]\n");
     exit(ERROR_ARG_NOVAL);
 }
 
@@ -227,14 +454,21 @@ void manejarArgumentos(int argc,
                        char *argv[],
                        char *pipeNom,
                        char *fileIn,
-                       char *fileOut)
+                       char *fileOut,
+                       struct opciones_servidor *opciones)
 {
-    // Todos los argumentos son obligatorios
-    if (argc != 7)
+    // Cada argumento va acompañado de su valor
+    if (argc < 7 || argc % 2 == 0)
         mostrarUso();
 
+    // Valores por defecto de los argumentos opcionales
+    opciones->backend = BACKEND_EPOLL;
+    opciones->socketNom[0] = '\0';
+    opciones->direccionTCP[0] = '\0';
+
     // Filtrar los argumentos
-    bool argPipe = false, argIn = false, argOut = false;
+    bool argPipe = false, argIn = false, argOut = false, argBackend = false,
+         argSocket = false, argTCP = false;
 
     while ((argc > 1) && (argv[1][0] == '-'))
     {
@@ -288,6 +522,58 @@ void manejarArgumentos(int argc,
 
             break;
 
+        case 'b':
+            // Verificar si ya se usó el argumento
+            if (argBackend)
+            {
+                fprintf(stdout, "El argumento %s ya fue utilizado!\n", argv[1]);
+                mostrarUso();
+            }
+
+            argBackend = true;
+
+            if (strcmp(argv[2], "epoll") == 0)
+                opciones->backend = BACKEND_EPOLL;
+            else if (strcmp(argv[2], "uring") == 0)
+                opciones->backend = BACKEND_URING;
+            else
+            {
+                fprintf(stdout, "Bucle de eventos no válido: %s\n", argv[2]);
+                mostrarUso();
+            }
+
+            break;
+
+        case 'u':
+            // Verificar si ya se usó el argumento
+            if (argSocket)
+            {
+                fprintf(stdout, "El argumento %s ya fue utilizado!\n", argv[1]);
+                mostrarUso();
+            }
+
+            argSocket = true;
+
+            // El socket también acepta clientes, el pipe sigue disponible
+            strcpy(opciones->socketNom, argv[2]);
+
+            break;
+
+        case 'l':
+            // Verificar si ya se usó el argumento
+            if (argTCP)
+            {
+                fprintf(stdout, "El argumento %s ya fue utilizado!\n", argv[1]);
+                mostrarUso();
+            }
+
+            argTCP = true;
+
+            // Clientes remotos, el pipe y el socket Unix siguen disponibles
+            strcpy(opciones->direccionTCP, argv[2]);
+
+            break;
+
         default:
             fprintf(stdout, "Argumento no válido: %s\n", argv[1]);
             mostrarUso();
@@ -296,17 +582,28 @@ void manejarArgumentos(int argc,
         argv += 2; // Mover el puntero de argumentos
         argc -= 2; // Reducir cantidad de argumentos para el while
     }
+
+    // Los tres archivos son obligatorios
+    if (argc != 1 || !argPipe || !argIn || !argOut)
+        mostrarUso();
 }
 
 void manejadorInterrupcion(int foo)
 {
     printf("\nAVISO: Se ha detenido la ejecución\n");
     isListening = false;
+
+    // Despertar al bucle de eventos (write es seguro dentro de un manejador)
+    uint64_t uno = 1;
+    if (eventoCierre >= 0)
+        (void)write(eventoCierre, &uno, sizeof(uno));
 }
 
 /* ----------------------- Manejo de la Base de Datos ----------------------- */
 
-int leerDatabase(book_t booksDatabase[], const char filename[])
+int leerDatabase(book_t booksDatabase[],
+                 indice_prestamos_t *prestamos,
+                 const char filename[])
 {
     // Abrir el archivo para sólo lectura
     FILE *databaseInput = fopen(filename, "r");
@@ -317,7 +614,11 @@ int leerDatabase(book_t booksDatabase[], const char filename[])
         exit(ERROR_APERTURA_ARCHIVO);
     }
 
+    // Las posiciones sin libro quedan vacías (ISBN 0)
+    memset(booksDatabase, 0, sizeof(book_t) * MAX_CANT_LIBROS);
+
     // Leer cada libro de la DB
+    iniciarPrestamos(prestamos);
     int n_libro = 0;
     for (int i = 0; i < MAX_CANT_LIBROS; i++)
     {
@@ -340,11 +641,21 @@ int leerDatabase(book_t booksDatabase[], const char filename[])
                 booksDatabase[n_libro].n_copies = booksDatabase[n_libro - 1].n_copies;
             }
 
-            fscanf(databaseInput, "%d,%c,%s\n",
+            fscanf(databaseInput, "%d,%c,%[^,\r\n]",
                    &booksDatabase[n_libro].copyInfo.n_copy,
                    &booksDatabase[n_libro].copyInfo.state,
                    booksDatabase[n_libro].copyInfo.date);
 
+            // Lector (opcional): quién tiene el ejemplar prestado
+            int lector = SIN_LECTOR;
+            fscanf(databaseInput, ",%d", &lector);
+            fscanf(databaseInput, "\n");
+
+            if (lector > SIN_LECTOR && lector <= MAX_LECTOR &&
+                booksDatabase[n_libro].copyInfo.state == 'P')
+                registrarPrestamo(prestamos, booksDatabase, n_libro,
+                                  prestatarioLector(lector));
+
             n_libro++;
         }
     }
@@ -356,6 +667,7 @@ int leerDatabase(book_t booksDatabase[], const char filename[])
 
 int actualizarDatabase(const char filename[],
                        book_t booksDatabase[],
+                       indice_prestamos_t *prestamos,
                        int tam_database)
 {
     // 1. Abrir el archivo y validar la syscall
@@ -389,6 +701,12 @@ int actualizarDatabase(const char filename[],
                 booksDatabase[i].copyInfo.state,
                 booksDatabase[i].copyInfo.date);
 
+        // Quién lo tiene, si tiene número de lector (un PID no sirve después
+        // de reiniciar)
+        int lector = lectorPrestatario(prestamos->prestatario[i]);
+        if (lector != SIN_LECTOR)
+            fprintf(database, ",%d", lector);
+
         // Print endl
         if (i < tam_database - 1)
             fprintf(database, "\n");
@@ -409,7 +727,9 @@ int actualizarDatabase(const char filename[],
     return SUCCESS_GENERIC;
 }
 
-void mostrarDatabasePantalla(book_t booksDatabase[], int tam_database)
+void mostrarDatabasePantalla(book_t booksDatabase[],
+                             indice_prestamos_t *prestamos,
+                             int tam_database)
 {
     fprintf(stdout, "\nBASE DE DATOS:\n");
 
@@ -433,6 +753,10 @@ void mostrarDatabasePantalla(book_t booksDatabase[], int tam_database)
                 booksDatabase[i].copyInfo.state,
                 booksDatabase[i].copyInfo.date);
 
+        int lector = lectorPrestatario(prestamos->prestatario[i]);
+        if (lector != SIN_LECTOR)
+            fprintf(stdout, ",%d", lector);
+
         // Print endl
         if (i < tam_database - 1)
             fprintf(stdout, "\n");
@@ -446,7 +770,7 @@ void mostrarDatabasePantalla(book_t booksDatabase[], int tam_database)
 
 /* ----------------------- Protocolos de comunicación ----------------------- */
 
-int iniciarComunicacion(const char *pipeCLNT_SRVR)
+int iniciarComunicacion(const char *pipeCLNT_SRVR, int *pipeEscritura)
 {
     // Crear el pipe (Cliente -> Servidor)
 
@@ -461,36 +785,94 @@ int iniciarComunicacion(const char *pipeCLNT_SRVR)
     fprintf(stdout, "Notificación: Se ha creado el pipe (Cliente->Servidor)\n");
     fprintf(stdout, "Notificación: El servidor está en estado de espera...\n");
 
-    // Abrir el pipe para lectura (Cliente->Servidor)
-    int pipe = open(pipeCLNT_SRVR, O_RDONLY);
+    // Abrir el pipe para lectura (Cliente->Servidor), sin bloquear porque aún
+    // no hay escritores
+    int pipe = open(pipeCLNT_SRVR, O_RDONLY | O_NONBLOCK);
     if (pipe < 0)
     {
         perror("Error de comunicación"); // Manejar Error
         exit(ERROR_PIPE_CLNT_SRVR);
     }
 
+    // El servidor es su propio escritor: read() no verá EOF cuando el último
+    // cliente se desconecte, simplemente se bloquea hasta la próxima petición
+    *pipeEscritura = open(pipeCLNT_SRVR, O_WRONLY);
+    if (*pipeEscritura < 0)
+    {
+        perror("Error de comunicación"); // Manejar Error
+        close(pipe);
+        exit(ERROR_PIPE_CLNT_SRVR);
+    }
+
+    // A partir de aquí las lecturas sí bloquean
+    fcntl(pipe, F_SETFL, fcntl(pipe, F_GETFL) & ~O_NONBLOCK);
+
     // Notificación
     fprintf(stdout, "Notificación: Se ha abierto el pipe (Cliente->Servidor)\n");
 
     return pipe;
 }
 
-int conectarCliente(struct client_list *clients, paquet_t package)
+int encolarConexion(struct conexiones_pendientes *conexiones, paquet_t package)
 {
     // Notificación
     fprintf(stdout, "\nUn nuevo cliente está iniciando una conexión\n");
 
-    if (package.type != SIGNAL && package.data.signal.code != START_COM)
+    //! Esta función es una región crítica (Conexiones pendientes)
+    sem_wait(&semaforo_conexiones);
+
+    if (conexiones->n_conexiones == MAX_CONEXIONES_PENDIENTES)
     {
-        fprintf(stderr, "UnexpeCLNTd instruction\n");
+        sem_post(&semaforo_conexiones);
+        fprintf(stderr, "Demasiadas conexiones pendientes, se ignora (%d)\n",
+                package.client);
         return ERROR_COMUNICACION;
     }
 
+    conexion_t *conexion = &conexiones->conexionArray[conexiones->n_conexiones++];
+    conexion->clientPID = package.client;
+    strcpy(conexion->pipeFilename, package.data.signal.buffer);
+    conexion->transporte =
+        (package.data.signal.code == START_SHM) ? TRANSPORTE_SHM : TRANSPORTE_FIFO;
+
+    // Los anillos son de paquet_t, el formato compacto sólo aplica a los pipes
+    conexion->formato = (conexion->transporte == TRANSPORTE_FIFO &&
+                         package.data.signal.version == VERSION_COMPACTA)
+                            ? FORMATO_COMPACTO
+                            : FORMATO_CLASICO;
+    clock_gettime(CLOCK_MONOTONIC, &conexion->llegada);
+
+    //! Fin de la región crítica
+    sem_post(&semaforo_conexiones);
+
+    // Despertar al hilo de conexiones
+    sem_post(&conexiones_nuevas);
+    return SUCCESS_GENERIC;
+}
+
+int conectarCliente(struct client_list *clients, conexion_t *conexion)
+{
     //!5. Servidor abre el pipe (Servidor->Cliente) para ESCRITURA
-    //Try to open the pipe
-    int pipefd = open(package.data.signal.buffer, O_WRONLY);
-    if (pipefd < 0)
+    // Con memoria compartida se mapea el segmento del cliente
+    segmento_shm_t *shm = NULL;
+    int pipefd;
+
+    if (conexion->transporte == TRANSPORTE_SHM)
+    {
+        pipefd = abrirSegmento(conexion, &shm);
+        if (pipefd == CONEXION_EN_ESPERA)
+            return CONEXION_EN_ESPERA;
+
+        if (pipefd < 0)
+            return ERROR_PIPE_SRVR_CLNT;
+    }
+
+    // Sin bloquear: si el cliente aún no lo abre para lectura falla con ENXIO
+    else if ((pipefd = open(conexion->pipeFilename, O_WRONLY | O_NONBLOCK)) < 0)
     {
+        if (errno == ENXIO)
+            return CONEXION_EN_ESPERA;
+
         perror("Error en comunicación");
         return ERROR_PIPE_SRVR_CLNT;
     }
@@ -498,18 +880,38 @@ int conectarCliente(struct client_list *clients, paquet_t package)
     // Notificación
     fprintf(stdout,
             "Notificación: El pipe (Servidor->Cliente) fue abierto!: %s\n",
-            package.data.signal.buffer);
+            conexion->pipeFilename);
 
     //!6. Servidor guarda la información de Cliente con su respectivo pipe
     //!de comunicación
 
-    // Leer los datos en el paquete y convertirlo en cliente
+    // Leer los datos de la conexión y convertirlo en cliente
     client_t nuevo = crearCliente(
-        pipefd, package.client, package.data.signal.buffer);
+        pipefd, conexion->clientPID, conexion->pipeFilename);
+    nuevo.transporte = conexion->transporte;
+    nuevo.shm = shm;
+    nuevo.formato = conexion->formato;
 
     // Guardar el nuevo cliente
     if (guardarCliente(clients, nuevo) != SUCCESS_GENERIC)
+    {
+        if (shm != NULL)
+            munmap(shm, sizeof(segmento_shm_t));
+        close(pipefd);
         return ERROR_MEMORY;
+    }
+
+    // Vigilar el pipe en el bucle de eventos (EPOLLOUT por flanco: avisa cada
+    // vez que el cliente libera espacio, EPOLLERR cuando cierra su lectura),
+    // con memoria compartida el pidfd avisa (EPOLLIN) cuando el cliente termina
+    client_t *guardado = obtenerCliente(clients, nuevo.clientPID);
+    if (guardado == NULL ||
+        registrarEvento(pipefd, guardado - clients->clientArray,
+                        (shm != NULL) ? EPOLLIN : (EPOLLOUT | EPOLLET)))
+    {
+        desconectarCliente(clients, nuevo.clientPID);
+        return ERROR_PIPE_SRVR_CLNT;
+    }
 
     // Notificación
     fprintf(stdout,
@@ -521,18 +923,21 @@ int conectarCliente(struct client_list *clients, paquet_t package)
     paquet_t toSent;
     toSent.type = SIGNAL;
     toSent.client = nuevo.clientPID;
+    toSent.id = 0;
     toSent.data.signal.code = SUCCEED_COM;
 
-    // En caso de que el pipe se cierre justo en el envío de la señal
-    if (write(nuevo.pipe, &toSent, sizeof(toSent)) < 0)
-    {
-        perror("Error");
-        fprintf(stderr, "Pipe cerrado inesperadamente");
+    // El PID del servidor: el cliente sólo usa el catálogo local que sea suyo
+    sprintf(toSent.data.signal.buffer, "%d", getpid());
 
-        // Desalojar recursos
-        removerCliente(clients, nuevo.clientPID);
-        close(pipefd);
+    // La versión aceptada le indica al cliente en qué formato seguir
+    toSent.data.signal.version =
+        (nuevo.formato == FORMATO_COMPACTO) ? VERSION_COMPACTA : 0;
 
+    // En caso de que el pipe se cierre justo en el envío de la señal el
+    // cliente se desconecta dentro de enviarRespuesta
+    if (enviarRespuesta(clients, nuevo.clientPID, &toSent) != SUCCESS_GENERIC)
+    {
+        fprintf(stderr, "Pipe cerrado inesperadamente\n");
         return ERROR_PIPE_SRVR_CLNT;
     }
 
@@ -540,12 +945,70 @@ int conectarCliente(struct client_list *clients, paquet_t package)
     fprintf(stdout,
             "Notificación: Señal enviada\n");
 
+    // Desde ahora el hilo de anillos lee sus peticiones
+    if (shm != NULL)
+        agregarAnillo(clients, guardado);
+
     fprintf(stdout,
             "La comunicación fue exitosa\n");
 
     return SUCCESS_GENERIC;
 }
 
+int abrirSegmento(conexion_t *conexion, segmento_shm_t **shm)
+{
+    // 1. El nombre sale del PID: un cliente no puede pedir el segmento de otro
+    char nombre[TAM_STRING];
+    nombreSegmento(conexion->clientPID, nombre);
+
+    int fd = shm_open(nombre, O_RDWR, 0);
+    if (fd < 0)
+    {
+        if (errno == ENOENT)
+            return CONEXION_EN_ESPERA;
+
+        perror("Memoria compartida");
+        return ERROR_PIPE_SRVR_CLNT;
+    }
+
+    // 2. El cliente aún puede estar dimensionándolo
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size < (off_t)sizeof(segmento_shm_t))
+    {
+        close(fd);
+        return CONEXION_EN_ESPERA;
+    }
+
+    segmento_shm_t *segmento = mmap(NULL, sizeof(segmento_shm_t),
+                                    PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (segmento == MAP_FAILED)
+    {
+        perror("Memoria compartida");
+        return ERROR_PIPE_SRVR_CLNT;
+    }
+
+    // 3. La marca se publica al final, cuando los anillos ya están en ceros
+    if (__atomic_load_n(&segmento->magia, __ATOMIC_ACQUIRE) != MAGIA_SHM)
+    {
+        munmap(segmento, sizeof(segmento_shm_t));
+        return CONEXION_EN_ESPERA;
+    }
+
+    // 4. pidfd: se vuelve legible cuando el cliente termina (hace de pipe)
+    int pidfd = (int)syscall(SYS_pidfd_open, conexion->clientPID, 0);
+    if (pidfd < 0)
+    {
+        perror("pidfd_open");
+        munmap(segmento, sizeof(segmento_shm_t));
+        return ERROR_PIPE_SRVR_CLNT;
+    }
+
+    *shm = segmento;
+    return pidfd;
+}
+
 int retirarCliente(struct client_list *clients, paquet_t package)
 {
     // Notificación
@@ -559,17 +1022,10 @@ int retirarCliente(struct client_list *clients, paquet_t package)
     }
 
     pid_t client = package.client;
-    int pipeSRVR_CLNT = buscarCliente(clients, client);
 
     //! 2. Servidor cierra la escritura del pipe (Servidor->Cliente)
-    if (close(pipeSRVR_CLNT) < 0)
-    {
-        perror("Error");
-        return ERROR_PIPE_SRVR_CLNT;
-    }
-
     //!3. Servidor actualiza la lista de clientes
-    int temp = removerCliente(clients, client);
+    int temp = desconectarCliente(clients, client);
     if (temp != SUCCESS_GENERIC)
     {
         fprintf(stderr, "No se pudo borrar el cliente");
@@ -579,21 +1035,28 @@ int retirarCliente(struct client_list *clients, paquet_t package)
     // Notificación
     fprintf(stdout,
             "Comunicación cerrada exitosamente\n");
+
+    if (clients->n_clients == 0)
+    {
+        fprintf(stdout, "\n\aTodos los clientes se han desconectado\n");
+        fprintf(stdout, "Esperando otras conexiones... (Presione Ctrl+C para detener)\n");
+    }
     return SUCCESS_GENERIC;
 }
 
 int interpretarSenal(struct client_list *clients, paquet_t package)
 {
+    //* START_COM no llega aquí, lo atiende el hilo de conexiones*/
     switch (package.data.signal.code)
     {
-    case START_COM:
-        return conectarCliente(clients, package);
-        break;
-
     case STOP_COM:
         return retirarCliente(clients, package);
         break;
 
+    case LECTOR:
+        return identificarLector(clients, package);
+        break;
+
     default:
         return FAILED_COM;
     }
@@ -601,21 +1064,73 @@ int interpretarSenal(struct client_list *clients, paquet_t package)
     return FAILURE_GENERIC;
 }
 
+int identificarLector(struct client_list *clients, paquet_t package)
+{
+    char *fin;
+    long lector = strtol(package.data.signal.buffer, &fin, 10);
+    if (*fin != '\0' || lector <= SIN_LECTOR || lector > MAX_LECTOR)
+    {
+        fprintf(stderr, "Número de lector no válido: %s\n", package.data.signal.buffer);
+        return ERROR_SOLICITUD;
+    }
+
+    //! Región crítica (Colas de salida): protege el slab de los clientes
+    sem_wait(&semaforo_salida);
+
+    client_t *cliente = obtenerCliente(clients, package.client);
+    if (cliente == NULL)
+    {
+        sem_post(&semaforo_salida);
+        return ERROR_PID_NOT_EXIST;
+    }
+
+    cliente->lector = (int)lector;
+
+    //! Fin de la región crítica
+    sem_post(&semaforo_salida);
+    fprintf(stdout, "\nEl cliente (%d) es el lector %ld\n", package.client, lector);
+    return SUCCESS_GENERIC;
+}
+
 paquet_t generarRespuesta(pid_t dest, int code, char *buffer)
 {
     // Paquet creation
     paquet_t reponse;
     reponse.client = dest;
     reponse.type = SIGNAL;
+    reponse.id = 0;
 
     // Signal construction
     reponse.data.signal.code = code;
+    reponse.data.signal.version = 0;
+    reponse.data.signal.buffer[0] = '\0';
     if (buffer != NULL)
         strcpy(reponse.data.signal.buffer, buffer);
 
     return reponse;
 }
 
+int negociarFormato(struct client_list *clients, pid_t client, int version)
+{
+    paquet_t confirmacion = generarRespuesta(client, SUCCEED_COM, NULL);
+
+    //! Región crítica (Colas de salida): las respuestas se escriben con el
+    //! formato del cliente
+    sem_wait(&semaforo_salida);
+
+    client_t *cliente = obtenerCliente(clients, client);
+    if (cliente != NULL && version == VERSION_COMPACTA)
+    {
+        cliente->formato = FORMATO_COMPACTO;
+        confirmacion.data.signal.version = VERSION_COMPACTA;
+    }
+
+    sem_post(&semaforo_salida);
+
+    // La confirmación ya sale en el formato acordado
+    return enviarRespuesta(clients, client, &confirmacion);
+}
+
 /* --------------------------- Manejo de clientes --------------------------- */
 
 client_t crearCliente(int pipefd, pid_t clientpid, char *pipenom)
@@ -624,36 +1139,133 @@ client_t crearCliente(int pipefd, pid_t clientpid, char *pipenom)
     clienteNuevo.clientPID = clientpid;
     clienteNuevo.pipe = pipefd;
     strcpy(clienteNuevo.pipeFilename, pipenom);
+
+    // Sin respuestas pendientes
+    memset(&clienteNuevo.salida, 0, sizeof(clienteNuevo.salida));
+    clienteNuevo.salida.paquetes = NULL;
+    clienteNuevo.pendiente = -1;
+
+    // Pipe nominal y paquet_t hasta que se indique lo contrario
+    clienteNuevo.transporte = TRANSPORTE_FIFO;
+    clienteNuevo.shm = NULL;
+    clienteNuevo.anillo = -1;
+    clienteNuevo.formato = FORMATO_CLASICO;
+
+    // Sin número de lector hasta que envíe LECTOR
+    clienteNuevo.lector = SIN_LECTOR;
+    clienteNuevo.porLiberar = false;
     return clienteNuevo;
 }
 
+int iniciarClientes(struct client_list *clients)
+{
+    clients->n_clients = 0;
+    clients->n_libres = MAX_CLIENTES;
+
+    // El slab, la pila y la tabla se reservan una única vez
+    clients->clientArray = (client_t *)malloc(sizeof(client_t) * MAX_CLIENTES);
+    clients->libres = (int *)malloc(sizeof(int) * MAX_CLIENTES);
+    clients->tabla = (int *)malloc(sizeof(int) * TAM_TABLA_CLIENTES);
+    clients->pendientes = (int *)malloc(sizeof(int) * MAX_CLIENTES);
+    clients->n_pendientes = 0;
+    clients->anillos = (int *)malloc(sizeof(int) * MAX_CLIENTES);
+    clients->n_anillos = 0;
+    clients->cerrados = (pid_t *)malloc(sizeof(pid_t) * MAX_CLIENTES);
+    clients->n_cerrados = 0;
+
+    if (clients->clientArray == NULL ||
+        clients->libres == NULL ||
+        clients->tabla == NULL ||
+        clients->pendientes == NULL ||
+        clients->anillos == NULL ||
+        clients->cerrados == NULL)
+    {
+        perror("Error");
+        liberarClientes(clients);
+        return ERROR_MEMORY;
+    }
+
+    // Todas las posiciones del slab están libres (la 0 queda en el tope)
+    for (int i = 0; i < MAX_CLIENTES; i++)
+        clients->libres[i] = MAX_CLIENTES - 1 - i;
+
+    // Todas las casillas de la tabla están vacías
+    for (int i = 0; i < TAM_TABLA_CLIENTES; i++)
+        clients->tabla[i] = CASILLA_VACIA;
+
+    return SUCCESS_GENERIC;
+}
+
+void liberarClientes(struct client_list *clients)
+{
+    free(clients->clientArray);
+    free(clients->libres);
+    free(clients->tabla);
+    free(clients->pendientes);
+    free(clients->anillos);
+    free(clients->cerrados);
+
+    clients->clientArray = NULL;
+    clients->libres = NULL;
+    clients->tabla = NULL;
+    clients->pendientes = NULL;
+    clients->anillos = NULL;
+    clients->cerrados = NULL;
+}
+
+int hashCliente(pid_t client)
+{
+    // Hash multiplicativo (Fibonacci), los PID suelen ser consecutivos: los
+    // bits altos del producto dependen de todos los del PID (los bajos sólo de
+    // los bajos, y el PID n y el cliente TCP ID_BASE_TCP + n chocarían)
+    return (int)(((uint32_t)client * 2654435761u) >> (32 - BITS_TABLA_CLIENTES));
+}
+
+int casillaCliente(struct client_list *clients, pid_t client)
+{
+    // Sondeo lineal hasta encontrar el PID o una casilla vacía
+    for (int i = hashCliente(client);; i = (i + 1) & (TAM_TABLA_CLIENTES - 1))
+    {
+        int pos = clients->tabla[i];
+        if (pos == CASILLA_VACIA)
+            return CASILLA_VACIA;
+
+        if (clients->clientArray[pos].clientPID == client)
+            return i;
+    }
+}
+
 int guardarCliente(struct client_list *clients, client_t client)
 {
     //! Esta función es una región crítica
     sem_wait(&semaforo_clientes);
 
-    // Add 1 to the client counter
-    int pos_newClient = clients->n_clients++;
-
-    // Realloc memory for the new client
-    client_t *aux = // Hacer el vector más grande y guardarlo en un nuevo apuntador
-        (client_t *)realloc(
-            clients->clientArray,
-            sizeof(client_t) * clients->n_clients);
+    // No se reemplaza un cliente que ya está conectado
+    if (casillaCliente(clients, client.clientPID) != CASILLA_VACIA)
+    {
+        sem_post(&semaforo_clientes);
+        fprintf(stderr, "El cliente (%d) ya está conectado...\n", client.clientPID);
+        return ERROR_COMUNICACION;
+    }
 
-    // If allocation failed
-    if (aux == NULL)
+    // Tomar una posición libre del slab
+    if (clients->n_libres == 0)
     {
-        perror("Error");
-        fprintf(stderr, "No es posible agregar un nuevo cliente...");
+        sem_post(&semaforo_clientes);
+        fprintf(stderr, "No es posible agregar un nuevo cliente...\n");
         return ERROR_MEMORY;
     }
 
-    // Set the new pointer
-    clients->clientArray = aux;
+    int pos = clients->libres[--clients->n_libres];
+    clients->clientArray[pos] = client;
 
-    // Store the new client
-    clients->clientArray[pos_newClient] = client;
+    // Guardar la posición en la primera casilla vacía de la tabla
+    int i = hashCliente(client.clientPID);
+    while (clients->tabla[i] != CASILLA_VACIA)
+        i = (i + 1) & (TAM_TABLA_CLIENTES - 1);
+
+    clients->tabla[i] = pos;
+    clients->n_clients++;
 
     //! Fin de la región crítica
     sem_post(&semaforo_clientes);
@@ -665,52 +1277,37 @@ int removerCliente(struct client_list *clients, pid_t clientToRemove)
     //! Esta función es una región crítica
     sem_wait(&semaforo_clientes);
 
-    // Search for the client to remove and move it to the last position
-    if (clients->clientArray[clients->n_clients - 1].clientPID != clientToRemove)
+    int i = casillaCliente(clients, clientToRemove);
+    if (i == CASILLA_VACIA) // If PID was not found
     {
-        bool found = false;
-        for (int i = 0; i < clients->n_clients; i++)
-        {
-            if (clients->clientArray[i].clientPID == clientToRemove)
-            {
-                found = true;
-
-                // Set variables
-                client_t toRemove = clients->clientArray[i];
-                client_t last = clients->clientArray[clients->n_clients - 1];
-
-                // Swap
-                clients->clientArray[i] = last;
-                clients->clientArray[clients->n_clients - 1] = toRemove;
-
-                break;
-            }
-        }
-
-        if (!found) // If PID was not found
-            return ERROR_PID_NOT_EXIST;
+        sem_post(&semaforo_clientes);
+        return ERROR_PID_NOT_EXIST;
     }
 
-    // Realloc the array
-    if (clients->n_clients > 1)
-        clients->n_clients--;
+    // Devolver la posición del slab a la pila de libres
+    clients->libres[clients->n_libres++] = clients->tabla[i];
+    clients->tabla[i] = CASILLA_VACIA;
+    clients->n_clients--;
 
-    // Realloc memory for the new client
-    client_t *aux = // Hacer el vector más grande y guardarlo en un nuevo apuntador
-        (client_t *)realloc(
-            clients->clientArray,
-            sizeof(client_t) * clients->n_clients);
-
-    // If allocation failed
-    if (aux == NULL)
+    // Borrado con desplazamiento hacia atrás: las casillas siguientes del
+    // mismo grupo se reubican para no romper el sondeo (sin lápidas)
+    for (int j = (i + 1) & (TAM_TABLA_CLIENTES - 1);
+         clients->tabla[j] != CASILLA_VACIA;
+         j = (j + 1) & (TAM_TABLA_CLIENTES - 1))
     {
-        perror("Error");
-        fprintf(stderr, "No es posible eliminar un cliente...\n");
-        return ERROR_MEMORY;
-    }
+        int ideal = hashCliente(clients->clientArray[clients->tabla[j]].clientPID);
 
-    // Set the new pointer
-    clients->clientArray = aux;
+        // Distancias (circulares) desde la casilla ideal hasta el hueco y j
+        int aHueco = (i - ideal) & (TAM_TABLA_CLIENTES - 1);
+        int aActual = (j - ideal) & (TAM_TABLA_CLIENTES - 1);
+
+        if (aHueco < aActual)
+        {
+            clients->tabla[i] = clients->tabla[j];
+            clients->tabla[j] = CASILLA_VACIA;
+            i = j;
+        }
+    }
 
     //! Fin de la región crítica
     sem_post(&semaforo_clientes);
@@ -719,440 +1316,2978 @@ int removerCliente(struct client_list *clients, pid_t clientToRemove)
 
 int buscarCliente(struct client_list *clients, pid_t client)
 {
-    for (int i = 0; i < clients->n_clients; i++)
-        if (clients->clientArray[i].clientPID == client)
-            return clients->clientArray[i].pipe;
+    client_t *cliente = obtenerCliente(clients, client);
+    if (cliente == NULL)
+        return FAILURE_GENERIC;
 
-    return ERROR_PID_NOT_EXIST;
+    return cliente->pipe;
 }
 
-/* ---------------------------- Manejo de libros ---------------------------- */
-
-int manejarLibros(
-    struct client_list *clients,
-    paquet_t package,
-    book_t ejemplar[])
+client_t *obtenerCliente(struct client_list *clients, pid_t client)
 {
-    // Notificación
-    printf("\nSe recibió una solicitud del cliente (%d)\n", package.client);
+    //! La tabla puede cambiar desde el hilo de salida
+    sem_wait(&semaforo_clientes);
+
+    int i = casillaCliente(clients, client);
+    client_t *cliente =
+        (i == CASILLA_VACIA) ? NULL : &clients->clientArray[clients->tabla[i]];
+
+    sem_post(&semaforo_clientes);
+    return cliente;
+}
+
+/* ----------------------- Manejo de la salida (Pipes) ----------------------- */
+
+/*
+ - NOTA:
+ - Las respuestas (a lo sumo sizeof(paquet_t), también RESULTADOS) son menores
+ que PIPE_BUF, por lo tanto cada write a un pipe es atómico: se escribe el
+ mensaje completo o falla con EAGAIN, nunca a medias
+*/
+
+int enviarRespuesta(struct client_list *clients, pid_t client, paquet_t *respuesta)
+{
+    //! Esta función es una región crítica (Colas de salida)
+    sem_wait(&semaforo_salida);
+
+    client_t *cliente = obtenerCliente(clients, client);
+    if (cliente == NULL)
+    {
+        sem_post(&semaforo_salida);
+        return ERROR_PID_NOT_EXIST;
+    }
+
+    cola_salida_t *salida = &cliente->salida;
+
+    // Memoria compartida: se escribe en el anillo, sólo hay llamada al sistema
+    // si el cliente está dormido
+    if (cliente->transporte == TRANSPORTE_SHM)
+    {
+        if (!anilloEscribir(&cliente->shm->respuestas, respuesta))
+        {
+            fprintf(stderr, "El cliente (%d) no lee sus respuestas, se desconecta\n",
+                    client);
+            clientesLentos++;
+            cerrarCliente(clients, cliente);
+            sem_post(&semaforo_salida);
+            return ERROR_PIPE_SRVR_CLNT;
+        }
+
+        if (anilloReclamarDespertar(&cliente->shm->respuestas))
+            anilloDespertar(&cliente->shm->respuestas);
+
+        sem_post(&semaforo_salida);
+        return SUCCESS_GENERIC;
+    }
+
+    // Con io_uring el bucle de eventos escribe las respuestas en lote
+    if (salidaDiferida && salida->cantidad == 0)
+        clock_gettime(CLOCK_MONOTONIC, &salida->bloqueadoDesde);
+
+    // Sin respuestas en cola se intenta escribir directamente
+    else if (salida->cantidad == 0)
+    {
+        int escrito = escribirPaquete(cliente, respuesta, &salida->enviados);
+        if (escrito > 0)
+        {
+            sem_post(&semaforo_salida);
+            return SUCCESS_GENERIC;
+        }
+
+        if (escrito < 0)
+        {
+            perror("Error");
+            cerrarCliente(clients, cliente);
+            sem_post(&semaforo_salida);
+            return ERROR_PIPE_SRVR_CLNT;
+        }
+
+        // El pipe está lleno desde este momento (con TCP puede quedar parte
+        // de la trama escrita, el resto sale de la cola)
+        clock_gettime(CLOCK_MONOTONIC, &salida->bloqueadoDesde);
+    }
+
+    // La cola se reserva sólo para los clientes que alguna vez la necesitan
+    if (salida->paquetes == NULL)
+        salida->paquetes = (paquet_t *)malloc(sizeof(paquet_t) * TAM_COLA_SALIDA);
+
+    // Cola llena (o sin memoria): el cliente no está leyendo
+    if (salida->paquetes == NULL || salida->cantidad == TAM_COLA_SALIDA)
+    {
+        fprintf(stderr, "El cliente (%d) no lee sus respuestas, se desconecta\n",
+                client);
+        clientesLentos++;
+        cerrarCliente(clients, cliente);
+        sem_post(&semaforo_salida);
+        return ERROR_PIPE_SRVR_CLNT;
+    }
+
+    salida->paquetes[(salida->inicio + salida->cantidad) % TAM_COLA_SALIDA] = *respuesta;
+    salida->cantidad++;
+
+    // Avisar al bucle de eventos que hay un nuevo pipe por vigilar, el
+    // EPOLLOUT llega cuando el cliente lea
+    if (cliente->pendiente < 0)
+    {
+        cliente->pendiente = clients->n_pendientes;
+        clients->pendientes[clients->n_pendientes++] = cliente - clients->clientArray;
+
+        // Con io_uring el aviso se da una sola vez por lote (publicarSalida)
+        uint64_t uno = 1;
+        if (salidaDiferida)
+            salidaPorPublicar = true;
+        else if (write(eventoSalida, &uno, sizeof(uno)) < 0 && errno != EAGAIN)
+            perror("eventfd");
+    }
+
+    //! Fin de la región crítica
+    sem_post(&semaforo_salida);
+    return SUCCESS_GENERIC;
+}
+
+int enviarCache(struct client_list *clients,
+                pid_t client,
+                uint32_t id,
+                respuesta_cache_t *entrada)
+{
+    //! Esta función es una región crítica (Colas de salida)
+    sem_wait(&semaforo_salida);
+
+    client_t *cliente = obtenerCliente(clients, client);
+
+    // El write sólo puede adelantarse si no hay respuestas en cola, TCP
+    // necesita la longitud delante y la memoria compartida no escribe bytes
+    if (cliente != NULL && !salidaDiferida && cliente->salida.cantidad == 0 &&
+        (cliente->transporte == TRANSPORTE_FIFO || cliente->transporte == TRANSPORTE_UNIX))
+    {
+        int tam;
+        unsigned char *mensaje = mensajeCache(entrada, cliente->formato, &tam);
+        sellarMensaje(mensaje, cliente->formato, client, id);
+
+        if (write(cliente->pipe, mensaje, tam) == tam)
+        {
+            sem_post(&semaforo_salida);
+            return SUCCESS_GENERIC;
+        }
+
+        if (errno != EAGAIN)
+        {
+            perror("Error");
+            cerrarCliente(clients, cliente);
+            sem_post(&semaforo_salida);
+            return ERROR_PIPE_SRVR_CLNT;
+        }
+    }
+
+    //! Fin de la región crítica
+    sem_post(&semaforo_salida);
+
+    // Pipe lleno o cualquier otro transporte: la copia del paquete se encola
+    paquet_t respuesta = entrada->respuesta;
+    respuesta.client = client;
+    respuesta.id = id;
+    return enviarRespuesta(clients, client, &respuesta);
+}
+
+int escribirPaquete(client_t *cliente, paquet_t *paquete, int *enviados)
+{
+    // Con TCP el mensaje va después de la longitud
+    unsigned char trama[TAM_TRAMA_TCP];
+    int cabecera = (cliente->transporte == TRANSPORTE_TCP) ? TAM_CABECERA_TCP : 0;
+    int tam = cabecera + codificarPaquete(paquete, cliente->formato, trama + cabecera);
+
+    // Pipes y sockets Unix: cada write es atómico (mensaje completo o EAGAIN)
+    if (cliente->transporte != TRANSPORTE_TCP)
+    {
+        if (write(cliente->pipe, trama, tam) == tam)
+            return 1;
+        return (errno == EAGAIN) ? 0 : -1;
+    }
+
+    // TCP: longitud + mensaje, continuando donde quedó la trama
+    uint32_t longitud = htonl(tam - TAM_CABECERA_TCP);
+    memcpy(trama, &longitud, TAM_CABECERA_TCP);
+
+    while (*enviados < tam)
+    {
+        ssize_t escrito = send(cliente->pipe, trama + *enviados,
+                               tam - *enviados, MSG_NOSIGNAL);
+        if (escrito < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+
+        *enviados += escrito;
+    }
+
+    *enviados = 0;
+    return 1;
+}
+
+int vaciarSalida(struct client_list *clients, client_t *cliente)
+{
+    cola_salida_t *salida = &cliente->salida;
+    int escritas = 0;
+    int status = SUCCESS_GENERIC;
+
+    while (escritas < salida->cantidad)
+    {
+        int indice = (salida->inicio + escritas) % TAM_COLA_SALIDA;
+        int escrito = escribirPaquete(cliente, &salida->paquetes[indice], &salida->enviados);
+        if (escrito <= 0)
+        {
+            if (escrito < 0)
+                status = ERROR_PIPE_SRVR_CLNT;
+            break;
+        }
+
+        escritas++;
+    }
+
+    avanzarSalida(clients, cliente, escritas);
+    return status;
+}
+
+void avanzarSalida(struct client_list *clients, client_t *cliente, int escritas)
+{
+    cola_salida_t *salida = &cliente->salida;
+
+    salida->inicio = (salida->inicio + escritas) % TAM_COLA_SALIDA;
+    salida->cantidad -= escritas;
+
+    // El cliente está leyendo, el tiempo de bloqueo vuelve a empezar
+    if (escritas > 0)
+        clock_gettime(CLOCK_MONOTONIC, &salida->bloqueadoDesde);
+
+    // Sin respuestas en cola el pipe deja de vigilarse
+    if (salida->cantidad == 0 && cliente->pendiente >= 0)
+    {
+        int ultimo = clients->pendientes[--clients->n_pendientes];
+        clients->pendientes[cliente->pendiente] = ultimo;
+        clients->clientArray[ultimo].pendiente = cliente->pendiente;
+        cliente->pendiente = -1;
+    }
+}
+
+void publicarSalida(void)
+{
+    //! Esta función es una región crítica (Colas de salida)
+    sem_wait(&semaforo_salida);
+
+    bool avisar = salidaPorPublicar;
+    salidaPorPublicar = false;
+
+    //! Fin de la región crítica
+    sem_post(&semaforo_salida);
+
+    uint64_t uno = 1;
+    if (avisar && write(eventoSalida, &uno, sizeof(uno)) < 0 && errno != EAGAIN)
+        perror("eventfd");
+}
+
+void cerrarCliente(struct client_list *clients, client_t *cliente)
+{
+    // Descartar las respuestas en cola
+    cliente->salida.cantidad = 0;
+    vaciarSalida(clients, cliente);
+    free(cliente->salida.paquetes);
+    cliente->salida.paquetes = NULL;
+
+    // El cliente verá el segmento cerrado (equivale a EOF)
+    if (cliente->shm != NULL)
+    {
+        quitarAnillo(clients, cliente);
+        __atomic_store_n(&cliente->shm->cerrado, 1, __ATOMIC_RELEASE);
+        anilloDespertar(&cliente->shm->respuestas);
+
+        munmap(cliente->shm, sizeof(segmento_shm_t));
+        cliente->shm = NULL;
+    }
+
+    // Libera un cupo de TCP
+    if (cliente->transporte == TRANSPORTE_TCP)
+        clientesTCP--;
+
+    // El cliente verá EOF en su pipe (y epoll deja de vigilarlo)
+    if (close(cliente->pipe) < 0)
+        perror("Error");
+    cliente->pipe = -1;
+
+    // Sus préstamos con el PID y sus reservas se liberan en la próxima región
+    // de la BD (cabe: cada anotado estaba conectado en la liberación anterior)
+    if (cliente->porLiberar && clients->n_cerrados < MAX_CLIENTES)
+        clients->cerrados[clients->n_cerrados++] = cliente->clientPID;
+
+    removerCliente(clients, cliente->clientPID);
+}
+
+int desconectarCliente(struct client_list *clients, pid_t client)
+{
+    //! Esta función es una región crítica (Colas de salida)
+    sem_wait(&semaforo_salida);
+
+    client_t *cliente = obtenerCliente(clients, client);
+    if (cliente == NULL)
+    {
+        sem_post(&semaforo_salida);
+        return ERROR_PID_NOT_EXIST;
+    }
+
+    cerrarCliente(clients, cliente);
+
+    //! Fin de la región crítica
+    sem_post(&semaforo_salida);
+    return SUCCESS_GENERIC;
+}
+
+/* ----------------------- Memoria compartida (Anillos) ----------------------- */
+
+void agregarAnillo(struct client_list *clients, client_t *cliente)
+{
+    //! Esta función es una región crítica
+    sem_wait(&semaforo_clientes);
+
+    cliente->anillo = clients->n_anillos;
+    clients->anillos[clients->n_anillos++] = cliente - clients->clientArray;
+
+    //! Fin de la región crítica
+    sem_post(&semaforo_clientes);
+
+    despertarAnillos();
+}
+
+void quitarAnillo(struct client_list *clients, client_t *cliente)
+{
+    //! Esta función es una región crítica
+    sem_wait(&semaforo_clientes);
+
+    // Se reemplaza por el último (el orden no importa)
+    if (cliente->anillo >= 0)
+    {
+        int ultimo = clients->anillos[--clients->n_anillos];
+        clients->anillos[cliente->anillo] = ultimo;
+        clients->clientArray[ultimo].anillo = cliente->anillo;
+        cliente->anillo = -1;
+    }
+
+    //! Fin de la región crítica
+    sem_post(&semaforo_clientes);
+}
+
+void despertarAnillos(void)
+{
+    sem_post(&timbreAnillos);
+}
+
+void atenderSalida(struct client_list *clients, int posicion, int fd, uint32_t eventos)
+{
+    client_t *cliente = &clients->clientArray[posicion];
+
+    // El evento pudo llegar después de que el cliente se desconectara
+    if (cliente->pipe != fd)
+        return;
+
+    // El cliente cerró su extremo de lectura sin avisar (STOP_COM), o terminó
+    // (ver atenderEntrada)
+    if (eventos & (EPOLLERR | EPOLLHUP))
+    {
+        fprintf(stderr, "El pipe del cliente (%d) se cerró\n", cliente->clientPID);
+        clientesCaidos++;
+        cerrarCliente(clients, cliente);
+        return;
+    }
+
+    if (cliente->salida.cantidad > 0 &&
+        vaciarSalida(clients, cliente) != SUCCESS_GENERIC)
+    {
+        fprintf(stderr, "El pipe del cliente (%d) se cerró\n", cliente->clientPID);
+        clientesCaidos++;
+        cerrarCliente(clients, cliente);
+    }
+}
+
+uint32_t atenderEntrada(struct bucle_eventos *bucle, int posicion, int fd, uint32_t eventos)
+{
+    // Los pipes (Servidor->Cliente) nunca tienen entrada
+    if (!(eventos & EPOLLIN))
+        return eventos;
+
+    //! Región crítica corta: el cliente puede desconectarse en otro hilo
+    sem_wait(&semaforo_salida);
+
+    client_t *cliente = &bucle->clients->clientArray[posicion];
+    bool vigente = (cliente->pipe == fd);
+    int transporte = cliente->transporte;
+    pid_t pid = cliente->clientPID;
+
+    sem_post(&semaforo_salida);
+
+    if (!vigente)
+        return eventos & ~EPOLLIN;
+
+    // El pidfd se vuelve legible cuando el proceso termina
+    if (transporte == TRANSPORTE_SHM)
+        return (eventos & ~EPOLLIN) | EPOLLHUP;
+
+    if (transporte == TRANSPORTE_UNIX &&
+        leerSocket(bucle, fd, pid) != SUCCESS_GENERIC)
+        return (eventos & ~EPOLLIN) | EPOLLHUP;
+
+    if (transporte == TRANSPORTE_TCP &&
+        leerTCP(bucle, posicion, fd, pid) != SUCCESS_GENERIC)
+        return (eventos & ~EPOLLIN) | EPOLLHUP;
+
+    return eventos & ~EPOLLIN;
+}
+
+void revisarBloqueados(struct client_list *clients)
+{
+    //! Esta función es una región crítica (Colas de salida)
+    sem_wait(&semaforo_salida);
+
+    // De atrás hacia adelante porque cerrar un cliente reordena la lista
+    for (int i = clients->n_pendientes - 1; i >= 0; i--)
+    {
+        client_t *cliente = &clients->clientArray[clients->pendientes[i]];
+
+        if (msDesde(&cliente->salida.bloqueadoDesde) > LIMITE_BLOQUEO_MS)
+        {
+            fprintf(stderr, "El cliente (%d) no lee sus respuestas, se desconecta\n",
+                    cliente->clientPID);
+            clientesLentos++;
+            cerrarCliente(clients, cliente);
+        }
+    }
+
+    //! Fin de la región crítica
+    sem_post(&semaforo_salida);
+}
+
+/* ------------------------- Bucle de eventos (epoll) ------------------------- */
+
+uint64_t tokenEvento(int posicion, int fd)
+{
+    return ((uint64_t)(uint32_t)posicion << 32) | (uint32_t)fd;
+}
+
+int registrarEvento(int fd, int posicion, uint32_t eventos)
+{
+    struct epoll_event evento;
+    evento.events = eventos;
+    evento.data.u64 = tokenEvento(posicion, fd);
+
+    if (epoll_ctl(epollServidor, EPOLL_CTL_ADD, fd, &evento) < 0)
+    {
+        perror("epoll");
+        return FAILURE_GENERIC;
+    }
+
+    return SUCCESS_GENERIC;
+}
+
+int leerPeticiones(struct bucle_eventos *bucle)
+{
+    // Cada write de un cliente es atómico (< PIPE_BUF), por lo tanto el pipe
+    // sólo contiene mensajes completos y un read() retorna varios a la vez
+    unsigned char datos[LOTE_LECTURA * sizeof(paquet_t)];
+
+    ssize_t leido = read(bucle->readPipe, datos, sizeof(datos));
+    if (leido < 0)
+    {
+        if (errno != EAGAIN && errno != EINTR)
+            perror("Error de comunicación");
+        return 0;
+    }
+
+    return despacharBytes(bucle, datos, leido);
+}
+
+int despacharBytes(struct bucle_eventos *bucle, const unsigned char *datos, int n)
+{
+    // Los mensajes son de longitud variable: el último puede quedar cortado
+    // por el tamaño del read() y se completa con el pedazo siguiente
+    entrada_t *resto = &bucle->entradaPipe;
+    paquet_t lote[LOTE_LECTURA];
+    int n_paquetes = 0, total = 0, i = 0;
+
+    //! 1. Completar el mensaje que quedó a medias
+    if (resto->n_datos > 0)
+    {
+        int previos = resto->n_datos;
+        int copiar = (n < TAM_MAX_MENSAJE - previos) ? n : TAM_MAX_MENSAJE - previos;
+        memcpy(resto->datos + previos, datos, copiar);
+
+        int usado = decodificarPaquete(resto->datos, previos + copiar, &lote[0]);
+        if (usado == 0)
+        {
+            resto->n_datos += copiar;
+            return 0;
+        }
+
+        resto->n_datos = 0;
+        if (usado < 0)
+        {
+            // Seguir desde el mensaje siguiente (una marca dentro del pedazo
+            // anterior ya no se puede leer completa)
+            int salto = saltarMensaje(resto->datos, previos + copiar);
+            i = (salto > previos) ? salto - previos : 0;
+            fprintf(stderr, "Mensaje inválido en el pipe, se descartan %d bytes\n",
+                    previos + i);
+        }
+        else
+        {
+            n_paquetes = 1;
+            i = usado - previos;
+        }
+    }
+
+    //! 2. Mensajes completos, en lotes
+    while (i < n)
+    {
+        int usado = decodificarPaquete(datos + i, n - i, &lote[n_paquetes]);
+        if (usado == 0)
+        {
+            memcpy(resto->datos, datos + i, n - i);
+            resto->n_datos = n - i;
+            break;
+        }
+
+        // Saltar el mensaje inválido, los que vienen detrás siguen sirviendo
+        if (usado < 0)
+        {
+            int salto = saltarMensaje(datos + i, n - i);
+            fprintf(stderr, "Mensaje inválido en el pipe, se descartan %d bytes\n", salto);
+            i += salto;
+            continue;
+        }
+
+        i += usado;
+        if (++n_paquetes == LOTE_LECTURA)
+        {
+            despacharPeticiones(lote, n_paquetes, bucle->buffer, bucle->conexiones);
+            total += n_paquetes;
+            n_paquetes = 0;
+        }
+    }
+
+    despacharPeticiones(lote, n_paquetes, bucle->buffer, bucle->conexiones);
+    return total + n_paquetes;
+}
+
+void despacharPeticiones(paquet_t *lote,
+                         int n_paquetes,
+                         buffer_t *buffer,
+                         struct conexiones_pendientes *conexiones)
+{
+    for (int i = 0; i < n_paquetes; i++)
+    {
+        // Las conexiones nuevas no pasan por el buffer de peticiones
+        if (lote[i].type == SIGNAL && (lote[i].data.signal.code == START_COM ||
+                                       lote[i].data.signal.code == START_SHM))
+            encolarConexion(conexiones, lote[i]);
+
+        // Un cliente por memoria compartida encontró al hilo de anillos dormido
+        else if (lote[i].type == SIGNAL && lote[i].data.signal.code == TIMBRE_SHM)
+            despertarAnillos();
+
+        // Montar la petición al arreglo de peticiones
+        else
+            queue(buffer, lote[i]);
+    }
+}
+
+/* ------------------------------- Socket Unix ------------------------------- */
+
+int abrirSocket(const char *nombre)
+{
+    struct sockaddr_un direccion;
+    memset(&direccion, 0, sizeof(direccion));
+    direccion.sun_family = AF_UNIX;
+
+    if (strlen(nombre) >= sizeof(direccion.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(direccion.sun_path, nombre);
+
+    // SOCK_SEQPACKET conserva los límites de cada mensaje (un paquete)
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    // Igual que el pipe: si quedó de una ejecución anterior se reemplaza
+    unlink(nombre);
+    if (bind(fd, (struct sockaddr *)&direccion, sizeof(direccion)) < 0 ||
+        listen(fd, COLA_SOCKET) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+void aceptarClientes(struct bucle_eventos *bucle, int escucha, int transporte)
+{
+    struct client_list *clients = bucle->clients;
+
+    while (true)
+    {
+        //! 1. Tomar la próxima conexión (O_NONBLOCK como los pipes)
+        struct sockaddr_storage remoto;
+        socklen_t tamRemoto = sizeof(remoto);
+        int fd = accept4(escucha, (struct sockaddr *)&remoto, &tamRemoto,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("Socket");
+            return;
+        }
+
+        //! 2. Identificar al cliente
+        pid_t id;
+        char nombre[TAM_STRING] = "";
+
+        if (transporte == TRANSPORTE_UNIX)
+        {
+            // El PID lo informa el kernel, el cliente no puede suplantar a otro
+            struct ucred credenciales;
+            socklen_t tam = sizeof(credenciales);
+            if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credenciales, &tam) < 0)
+            {
+                perror("Socket");
+                close(fd);
+                continue;
+            }
+            id = credenciales.pid;
+        }
+        else
+        {
+            // Un cupo por conexión, las que sobran se rechazan de inmediato
+            sem_wait(&semaforo_salida);
+            bool hayCupo = clientesTCP < MAX_CLIENTES_TCP;
+            if (hayCupo)
+                clientesTCP++;
+            sem_post(&semaforo_salida);
+
+            if (!hayCupo)
+            {
+                uint32_t longitud = htonl(sizeof(paquet_t));
+                unsigned char trama[TAM_TRAMA_TCP];
+                paquet_t rechazo = generarRespuesta(0, FAILED_COM, NULL);
+                memcpy(trama, &longitud, TAM_CABECERA_TCP);
+                memcpy(trama + TAM_CABECERA_TCP, &rechazo, sizeof(paquet_t));
+
+                (void)send(fd, trama, TAM_TRAMA_TCP, MSG_NOSIGNAL | MSG_DONTWAIT);
+                fprintf(stderr, "Conexión TCP rechazada: ya hay %d clientes TCP\n",
+                        MAX_CLIENTES_TCP);
+                close(fd);
+                continue;
+            }
+
+            // Sin Nagle: cada respuesta es pequeña y el cliente la espera
+            int uno = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));
+
+            // Identificador fuera del rango de los PID
+            id = siguienteIdTCP++;
+            if (siguienteIdTCP < ID_BASE_TCP || siguienteIdTCP >= ID_BASE_LECTOR)
+                siguienteIdTCP = ID_BASE_TCP;
+
+            char host[NI_MAXHOST], puerto[NI_MAXSERV];
+            if (getnameinfo((struct sockaddr *)&remoto, tamRemoto, host, sizeof(host),
+                            puerto, sizeof(puerto), NI_NUMERICHOST | NI_NUMERICSERV) == 0)
+                snprintf(nombre, sizeof(nombre), "%.64s:%.8s", host, puerto);
+        }
+
+        //! 3. Guardar al cliente, el socket sirve para leer y para escribir
+        client_t nuevo = crearCliente(fd, id, nombre);
+        nuevo.transporte = transporte;
+
+        // Si no cabe, cerrar es la respuesta (el cliente lee EOF)
+        if (guardarCliente(clients, nuevo) != SUCCESS_GENERIC)
+        {
+            if (transporte == TRANSPORTE_TCP)
+            {
+                sem_wait(&semaforo_salida);
+                clientesTCP--;
+                sem_post(&semaforo_salida);
+            }
+            close(fd);
+            continue;
+        }
+
+        // Por flanco: EPOLLIN se lee hasta vaciar, EPOLLOUT igual que los pipes
+        client_t *guardado = obtenerCliente(clients, id);
+        int posicion = (guardado == NULL) ? -1 : guardado - clients->clientArray;
+        if (guardado == NULL ||
+            registrarEvento(fd, posicion, EPOLLIN | EPOLLOUT | EPOLLET))
+        {
+            desconectarCliente(clients, id);
+            continue;
+        }
+
+        if (transporte == TRANSPORTE_UNIX)
+        {
+            fprintf(stdout, "\nEl cliente (%d) se conectó por el socket\n", id);
+            continue;
+        }
+
+        //! 4. TCP: la trama a medias de un cliente anterior en esta posición
+        //! no es de este, y el cliente remoto espera la confirmación
+        if (bucle->entradas[posicion] == NULL)
+            bucle->entradas[posicion] = (entrada_t *)malloc(sizeof(entrada_t));
+
+        if (bucle->entradas[posicion] == NULL)
+        {
+            desconectarCliente(clients, id);
+            continue;
+        }
+        bucle->entradas[posicion]->n_datos = 0;
+
+        paquet_t confirmacion = generarRespuesta(id, SUCCEED_COM, NULL);
+        enviarRespuesta(clients, id, &confirmacion);
+
+        fprintf(stdout, "\nEl cliente (%d) se conectó por TCP desde %s\n", id, nombre);
+    }
+}
+
+void encolarDeSocket(struct bucle_eventos *bucle, paquet_t *paquete, pid_t cliente)
+{
+    // El remitente es el dueño del socket, no lo que diga el paquete
+    paquete->client = cliente;
+
+    // START_COM por un socket ya conectado sólo acuerda el formato
+    if (paquete->type == SIGNAL && paquete->data.signal.code == START_COM)
+    {
+        negociarFormato(bucle->clients, cliente, paquete->data.signal.version);
+        return;
+    }
+
+    // El resto de señales de conexión no tienen sentido por aquí
+    if (paquete->type == SIGNAL && paquete->data.signal.code != STOP_COM &&
+        paquete->data.signal.code != LECTOR)
+        return;
+
+    queue(bucle->buffer, *paquete);
+}
+
+int leerSocket(struct bucle_eventos *bucle, int fd, pid_t cliente)
+{
+    unsigned char lote[LOTE_LECTURA][TAM_MAX_MENSAJE];
+    struct iovec vectores[LOTE_LECTURA];
+    struct mmsghdr mensajes[LOTE_LECTURA];
+
+    memset(mensajes, 0, sizeof(mensajes));
+    for (int i = 0; i < LOTE_LECTURA; i++)
+    {
+        vectores[i].iov_base = lote[i];
+        vectores[i].iov_len = TAM_MAX_MENSAJE;
+        mensajes[i].msg_hdr.msg_iov = &vectores[i];
+        mensajes[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    //! El evento es por flanco: leer hasta que no quede nada
+    while (true)
+    {
+        // Hasta LOTE_LECTURA mensajes (paquetes) en una llamada
+        int n_mensajes = recvmmsg(fd, mensajes, LOTE_LECTURA, MSG_DONTWAIT, NULL);
+        if (n_mensajes < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return SUCCESS_GENERIC;
+            return ERROR_PIPE_CLNT_SRVR;
+        }
+
+        bool cerrado = false;
+        for (int i = 0; i < n_mensajes; i++)
+        {
+            // Un mensaje vacío es EOF: el cliente cerró el socket
+            if (mensajes[i].msg_len == 0)
+            {
+                cerrado = true;
+                break;
+            }
+
+            // Los mensajes que no son exactamente un paquete se descartan
+            paquet_t paquete;
+            if (mensajes[i].msg_hdr.msg_flags & MSG_TRUNC)
+                continue;
+
+            int usado = decodificarPaquete(lote[i], mensajes[i].msg_len, &paquete);
+            if (usado != (int)mensajes[i].msg_len)
+            {
+                if (usado > 0)
+                    liberarPaquete(&paquete);
+                continue;
+            }
+
+            encolarDeSocket(bucle, &paquete, cliente);
+        }
+
+        if (cerrado)
+            return ERROR_PIPE_CLNT_SRVR;
+
+        // Menos mensajes de los pedidos: el socket quedó vacío
+        if (n_mensajes < LOTE_LECTURA)
+            return SUCCESS_GENERIC;
+    }
+}
+
+/* ---------------------------------- TCP ---------------------------------- */
+
+int abrirTCP(const char *direccion)
+{
+    //! 1. Separar el host (opcional) del puerto
+    char host[TAM_STRING];
+    const char *puerto = strrchr(direccion, ':');
+
+    if (puerto == NULL)
+        puerto = direccion;
+    else
+    {
+        snprintf(host, sizeof(host), "%.*s", (int)(puerto - direccion), direccion);
+        puerto++;
+    }
+
+    struct addrinfo pistas, *resultados;
+    memset(&pistas, 0, sizeof(pistas));
+    pistas.ai_family = AF_UNSPEC;
+    pistas.ai_socktype = SOCK_STREAM;
+    pistas.ai_flags = AI_PASSIVE; // Sin host: todas las interfaces
+
+    int error = getaddrinfo(puerto == direccion ? NULL : host, puerto,
+                            &pistas, &resultados);
+    if (error != 0)
+    {
+        fprintf(stderr, "TCP: %s\n", gai_strerror(error));
+        return -1;
+    }
+
+    //! 2. Escuchar en la primera dirección que se pueda
+    int fd = -1;
+    for (struct addrinfo *r = resultados; r != NULL && fd < 0; r = r->ai_next)
+    {
+        fd = socket(r->ai_family, r->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    r->ai_protocol);
+        if (fd < 0)
+            continue;
+
+        // Reiniciar el servidor no debe esperar a que expire TIME_WAIT
+        int uno = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &uno, sizeof(uno));
+
+        if (bind(fd, r->ai_addr, r->ai_addrlen) < 0 ||
+            listen(fd, COLA_SOCKET) < 0)
+        {
+            perror("TCP");
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    freeaddrinfo(resultados);
+    return fd;
+}
+
+int leerTCP(struct bucle_eventos *bucle, int posicion, int fd, pid_t cliente)
+{
+    entrada_t *entrada = bucle->entradas[posicion];
+    unsigned char bruto[LOTE_LECTURA * (TAM_CABECERA_TCP + sizeof(paquet_t))];
+
+    //! El evento es por flanco: leer hasta que no quede nada
+    while (true)
+    {
+        ssize_t leido = read(fd, bruto, sizeof(bruto));
+        if (leido < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return SUCCESS_GENERIC;
+            return ERROR_PIPE_CLNT_SRVR;
+        }
+
+        // EOF: el cliente cerró la conexión
+        if (leido == 0)
+            return ERROR_PIPE_CLNT_SRVR;
+
+        //! Armar las tramas, la primera puede continuar la del evento anterior
+        for (ssize_t i = 0; i < leido;)
+        {
+            // Primero la longitud, después el mensaje que anuncia
+            uint32_t longitud = 0;
+            if (entrada->n_datos >= TAM_CABECERA_TCP)
+            {
+                memcpy(&longitud, entrada->datos, TAM_CABECERA_TCP);
+                longitud = ntohl(longitud);
+            }
+
+            int faltan = TAM_CABECERA_TCP + longitud - entrada->n_datos;
+            int copiar = (leido - i < faltan) ? (int)(leido - i) : faltan;
+
+            memcpy(entrada->datos + entrada->n_datos, bruto + i, copiar);
+            entrada->n_datos += copiar;
+            i += copiar;
+
+            if (copiar < faltan)
+                break;
+
+            // Acaba de llegar la longitud: un mensaje vacío o más grande que
+            // TAM_MAX_MENSAJE es un cliente que no habla el protocolo
+            if (entrada->n_datos == TAM_CABECERA_TCP)
+            {
+                memcpy(&longitud, entrada->datos, TAM_CABECERA_TCP);
+                longitud = ntohl(longitud);
+                if (longitud == 0 || longitud > TAM_MAX_MENSAJE)
+                {
+                    fprintf(stderr, "El cliente (%d) envió una trama inválida\n", cliente);
+                    return ERROR_PIPE_CLNT_SRVR;
+                }
+                continue;
+            }
+
+            // Trama completa: el mensaje debe ocuparla exactamente
+            paquet_t paquete;
+            int usado = decodificarPaquete(entrada->datos + TAM_CABECERA_TCP, longitud,
+                                           &paquete);
+            if (usado != (int)longitud)
+            {
+                if (usado > 0)
+                    liberarPaquete(&paquete);
+                fprintf(stderr, "El cliente (%d) envió una trama inválida\n", cliente);
+                return ERROR_PIPE_CLNT_SRVR;
+            }
+
+            encolarDeSocket(bucle, &paquete, cliente);
+            entrada->n_datos = 0;
+        }
+
+        // Menos bytes de los pedidos: el socket quedó vacío
+        if (leido < (ssize_t)sizeof(bruto))
+            return SUCCESS_GENERIC;
+    }
+}
+
+int bucleEpoll(struct bucle_eventos *bucle)
+{
+    struct client_list *clients = bucle->clients;
+
+    // El pipe (Cliente->Servidor) se lee sin bloquear cuando epoll lo indica
+    if (fcntl(bucle->readPipe, F_SETFL, fcntl(bucle->readPipe, F_GETFL) | O_NONBLOCK) < 0 ||
+        registrarEvento(bucle->readPipe, EVENTO_PETICIONES, EPOLLIN))
+    {
+        perror("epoll");
+        return FAILURE_GENERIC;
+    }
+
+    // epoll_wait bloquea al hilo mientras no haya eventos
+    struct epoll_event eventos[MAX_EVENTOS];
+    while (isListening)
+    {
+        // Sin clientes conectados se mide la CPU consumida en reposo
+        bool enReposo = (clients->n_clients == 0);
+        double cpuAntes = enReposo ? segundosCPU() : 0;
+
+        // Con pipes llenos hay que despertar a revisar sus tiempos de bloqueo
+        int espera = (clients->n_pendientes > 0) ? INTERVALO_SALIDA_MS : -1;
+
+        //! 1. Esperar eventos
+        int n_eventos = epoll_wait(epollServidor, eventos, MAX_EVENTOS, espera);
+        despertares++;
+
+        if (enReposo)
+            cpuReposo += segundosCPU() - cpuAntes;
+
+        if (n_eventos <= 0)
+        {
+            // EINTR cuando se presiona Ctrl+C
+            if (n_eventos < 0 && errno != EINTR)
+                perror("epoll");
+
+            despertaresVacios++;
+        }
+
+        //! 2. Atender cada evento
+        for (int i = 0; i < n_eventos; i++)
+        {
+            int posicion = (int)(eventos[i].data.u64 >> 32);
+            int fd = (int)(uint32_t)eventos[i].data.u64;
+            uint64_t contador;
+
+            switch (posicion)
+            {
+            case EVENTO_PETICIONES: // Peticiones de los clientes
+                leerPeticiones(bucle);
+                break;
+
+            case EVENTO_SALIDA: // Sólo despierta para recalcular la espera
+            case EVENTO_CIERRE: // isListening ya es falso
+                (void)read(fd, &contador, sizeof(contador));
+                break;
+
+            case EVENTO_SOCKET: // Conexiones nuevas por el socket Unix
+                aceptarClientes(bucle, bucle->socketEscucha, TRANSPORTE_UNIX);
+                break;
+
+            case EVENTO_TCP: // Conexiones nuevas por TCP
+                aceptarClientes(bucle, bucle->socketTCP, TRANSPORTE_TCP);
+                break;
+
+            default: // Pipe (Servidor->Cliente), socket o pidfd de un cliente
+                eventos[i].events = atenderEntrada(bucle, posicion, fd, eventos[i].events);
+
+                sem_wait(&semaforo_salida);
+                atenderSalida(clients, posicion, fd, eventos[i].events);
+                sem_post(&semaforo_salida);
+                break;
+            }
+        }
+
+        //! 3. Desconectar a los clientes que no leen
+        if (clients->n_pendientes > 0)
+            revisarBloqueados(clients);
+    }
+
+    return SUCCESS_GENERIC;
+}
+
+void aumentarLimiteArchivos(void)
+{
+    struct rlimit limite;
+    if (getrlimit(RLIMIT_NOFILE, &limite) < 0)
+    {
+        perror("RLIMIT_NOFILE");
+        return;
+    }
+
+    rlim_t necesario = MAX_CLIENTES + FD_RESERVADOS;
+    if (limite.rlim_cur >= necesario)
+        return;
+
+    // Sin privilegios no se puede superar el límite duro
+    limite.rlim_cur =
+        (limite.rlim_max == RLIM_INFINITY || limite.rlim_max >= necesario)
+            ? necesario
+            : limite.rlim_max;
+
+    if (setrlimit(RLIMIT_NOFILE, &limite) < 0)
+        perror("RLIMIT_NOFILE");
+
+    if (limite.rlim_cur < necesario)
+        fprintf(stderr,
+                "AVISO: Sólo se pueden abrir %lu descriptores (%lu clientes)\n",
+                (unsigned long)limite.rlim_cur,
+                (unsigned long)(limite.rlim_cur - FD_RESERVADOS));
+}
+
+/* ------------------------ Bucle de eventos (io_uring) ------------------------ */
+/*
+ - NOTA:
+ - El pipe (Cliente->Servidor) se lee con IORING_OP_READ_MULTISHOT: una sola
+ SQE entrega una CQE por cada lote leído en alguno de los buffers provistos.
+ - Los pipes de los clientes y los eventfd siguen en el epoll del servidor,
+ io_uring lo vigila con un poll multishot.
+ - Las respuestas se encolan (salidaDiferida) y este hilo las escribe en lotes:
+ una cadena de IORING_OP_WRITE por cliente y un solo io_uring_enter por lote.
+*/
+
+uint64_t tokenUring(int tipo, int posicion)
+{
+    return ((uint64_t)(uint32_t)tipo << 32) | (uint32_t)posicion;
+}
+
+int bucleUring(struct bucle_eventos *bucle)
+{
+    struct client_list *clients = bucle->clients;
+
+    //! 1. Crear el io_uring (si falla se usa epoll)
+    struct bucle_uring *estado = (struct bucle_uring *)calloc(1, sizeof(struct bucle_uring));
+    if (estado == NULL)
+        return FAILURE_GENERIC;
+
+    estado->posiciones = (int *)malloc(sizeof(int) * MAX_CLIENTES);
+    if (estado->posiciones == NULL ||
+        uringIniciar(&estado->ring, TAM_URING) != SUCCESS_GENERIC)
+    {
+        perror("io_uring");
+        free(estado->posiciones);
+        free(estado);
+        return FAILURE_GENERIC;
+    }
+
+    // 1.1 Lectura multishot con buffers provistos (Linux 6.7), si no se puede,
+    // una lectura simple que se vuelve a enviar al completarse
+    estado->multishot =
+        uringSoporta(&estado->ring, URING_OP_READ_MULTISHOT) &&
+        uringRegistrarBuffers(&estado->ring, &estado->buffers, BUFFERS_URING,
+                              sizeof(paquet_t) * LOTE_LECTURA,
+                              GRUPO_PETICIONES) == SUCCESS_GENERIC;
+
+    backendES = estado->multishot ? "io_uring, lectura multishot"
+                                  : "io_uring, lectura simple";
+
+    // 1.2 Desde ahora las respuestas se encolan y las escribe este hilo
+    sem_wait(&semaforo_salida);
+    salidaDiferida = true;
+    sem_post(&semaforo_salida);
+
+    estado->armarLectura = true;
+    estado->armarEpoll = true;
+
+    struct epoll_event eventos[MAX_EVENTOS];
+    while (isListening)
+    {
+        //! 2. (Re)armar la lectura, el poll y el temporizador
+        armarUring(estado, bucle);
+
+        // Sin clientes conectados se mide la CPU consumida en reposo
+        bool enReposo = (clients->n_clients == 0);
+        double cpuAntes = enReposo ? segundosCPU() : 0;
+
+        //! 3. Enviar y esperar al menos una completación (si no hay trabajo)
+        bool hayTrabajo = estado->revisarEpoll || estado->n_lecturas > 0;
+        if (uringEnviar(&estado->ring, hayTrabajo ? 0 : 1) < 0 && errno != EINTR)
+            perror("io_uring");
+        despertares++;
+
+        if (enReposo)
+            cpuReposo += segundosCPU() - cpuAntes;
+
+        //! 4. Atender las completaciones
+        int n_cqes = 0;
+        struct io_uring_cqe *cqe;
+        while ((cqe = uringCqe(&estado->ring)) != NULL)
+        {
+            atenderCompletacion(estado, cqe);
+            uringAvanzar(&estado->ring);
+            n_cqes++;
+        }
+
+        if (n_cqes == 0)
+            despertaresVacios++;
+
+        //! 5. Repartir las peticiones leídas
+        procesarLecturas(estado, bucle);
+
+        //! 6. Atender los pipes de los clientes y los eventfd
+        if (estado->revisarEpoll)
+        {
+            estado->revisarEpoll = false;
+
+            int n_eventos = epoll_wait(epollServidor, eventos, MAX_EVENTOS, 0);
+
+            // Quedaron eventos sin leer y el poll no vuelve a avisar por ellos
+            if (n_eventos == MAX_EVENTOS)
+                estado->revisarEpoll = true;
+
+            // Conexiones y lecturas de sockets antes de tomar el semáforo
+            for (int i = 0; i < n_eventos; i++)
+            {
+                int posicion = (int)(eventos[i].data.u64 >> 32);
+                int fd = (int)(uint32_t)eventos[i].data.u64;
+
+                if (posicion == EVENTO_SOCKET)
+                    aceptarClientes(bucle, bucle->socketEscucha, TRANSPORTE_UNIX);
+                else if (posicion == EVENTO_TCP)
+                    aceptarClientes(bucle, bucle->socketTCP, TRANSPORTE_TCP);
+                else if (posicion < MAX_CLIENTES)
+                    eventos[i].events = atenderEntrada(bucle, posicion, fd, eventos[i].events);
+            }
+
+            sem_wait(&semaforo_salida);
+
+            for (int i = 0; i < n_eventos; i++)
+            {
+                int posicion = (int)(eventos[i].data.u64 >> 32);
+                int fd = (int)(uint32_t)eventos[i].data.u64;
+                uint64_t contador;
+
+                if (posicion == EVENTO_SALIDA || posicion == EVENTO_CIERRE)
+                    (void)read(fd, &contador, sizeof(contador));
+
+                // EPOLLOUT se atiende abajo junto con las demás colas
+                else if (posicion < MAX_CLIENTES &&
+                         (eventos[i].events & (EPOLLERR | EPOLLHUP)))
+                    atenderSalida(clients, posicion, fd, eventos[i].events);
+            }
+
+            //! 7. Escribir todas las colas de salida en lote
+            if (clients->n_pendientes > 0)
+                escribirSalidas(estado, clients);
+
+            sem_post(&semaforo_salida);
+        }
+
+        //! 8. Desconectar a los clientes que no leen
+        if (clients->n_pendientes > 0)
+            revisarBloqueados(clients);
+    }
+
+    //! 9. Volver a las escrituras directas y liberar el io_uring
+    sem_wait(&semaforo_salida);
+    salidaDiferida = false;
+    sem_post(&semaforo_salida);
+
+    fprintf(stdout,
+            "io_uring: %lu llamadas a io_uring_enter, %lu respuestas en %lu lotes\n",
+            estado->ring.ops, estado->respuestas, estado->lotes);
+
+    if (estado->multishot)
+        uringLiberarBuffers(&estado->ring, &estado->buffers);
+    uringCerrar(&estado->ring);
+    free(estado->posiciones);
+    free(estado);
+
+    return SUCCESS_GENERIC;
+}
+
+void armarUring(struct bucle_uring *estado, struct bucle_eventos *bucle)
+{
+    struct io_uring_sqe *sqe;
+
+    // Lectura del pipe (Cliente->Servidor)
+    if (estado->armarLectura && (sqe = uringSqe(&estado->ring)) != NULL)
+    {
+        sqe->fd = bucle->readPipe;
+        sqe->user_data = tokenUring(DATO_LECTURA, 0);
+
+        if (estado->multishot)
+        {
+            sqe->opcode = URING_OP_READ_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = GRUPO_PETICIONES;
+        }
+        else
+        {
+            sqe->opcode = IORING_OP_READ;
+            sqe->addr = (unsigned long)estado->lote;
+            sqe->len = sizeof(estado->lote);
+        }
+
+        estado->armarLectura = false;
+    }
+
+    // Poll multishot sobre el epoll (pipes de los clientes y eventfd)
+    if (estado->armarEpoll && (sqe = uringSqe(&estado->ring)) != NULL)
+    {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = epollServidor;
+        sqe->poll32_events = POLLIN;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->user_data = tokenUring(DATO_EPOLL, 0);
+
+        estado->armarEpoll = false;
+    }
+
+    // Con pipes llenos hay que despertar a revisar sus tiempos de bloqueo
+    static struct __kernel_timespec intervalo = {0, INTERVALO_SALIDA_MS * 1000000L};
+    if (bucle->clients->n_pendientes > 0 && !estado->temporizador &&
+        (sqe = uringSqe(&estado->ring)) != NULL)
+    {
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->addr = (unsigned long)&intervalo;
+        sqe->len = 1;
+        sqe->user_data = tokenUring(DATO_TIMEOUT, 0);
+
+        estado->temporizador = true;
+    }
+}
+
+void atenderCompletacion(struct bucle_uring *estado, struct io_uring_cqe *cqe)
+{
+    switch ((int)(cqe->user_data >> 32))
+    {
+    case DATO_LECTURA:
+        // Cada lectura guardada retiene un buffer provisto y la lectura sólo se
+        // vuelve a armar después de procesarlas, por lo tanto siempre caben
+        if (estado->n_lecturas < MAX_LECTURAS_URING)
+            estado->lecturas[estado->n_lecturas++] = *cqe;
+        break;
+
+    case DATO_EPOLL:
+        estado->revisarEpoll = true;
+        if (!(cqe->flags & IORING_CQE_F_MORE))
+            estado->armarEpoll = true;
+        break;
+
+    case DATO_TIMEOUT:
+        estado->temporizador = false;
+        break;
+
+    default: // Escrituras de un lote que no se alcanzó a completar
+        break;
+    }
+}
+
+void procesarLecturas(struct bucle_uring *estado, struct bucle_eventos *bucle)
+{
+    for (int i = 0; i < estado->n_lecturas; i++)
+    {
+        struct io_uring_cqe *cqe = &estado->lecturas[i];
+        bool conBuffer = (cqe->flags & IORING_CQE_F_BUFFER) != 0;
+        unsigned id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+        if (cqe->res > 0)
+        {
+            void *datos = conBuffer ? uringBuffer(&estado->buffers, id) : estado->lote;
+            despacharBytes(bucle, datos, cqe->res);
+        }
+
+        // ENOBUFS: se acabaron los buffers, la lectura se vuelve a armar
+        else if (cqe->res < 0 && cqe->res != -ENOBUFS &&
+                 cqe->res != -EAGAIN && cqe->res != -EINTR)
+        {
+            errno = -cqe->res;
+            perror("Error de comunicación");
+        }
+
+        if (conBuffer)
+            uringDevolverBuffer(&estado->buffers, id);
+
+        if (!(cqe->flags & IORING_CQE_F_MORE))
+            estado->armarLectura = true;
+    }
+
+    estado->n_lecturas = 0;
+}
+
+void escribirSalidas(struct bucle_uring *estado, struct client_list *clients)
+{
+    // Copia porque completar un lote reordena la lista de pendientes
+    int n_posiciones = clients->n_pendientes;
+    memcpy(estado->posiciones, clients->pendientes, sizeof(int) * n_posiciones);
+
+    int n_clientes = 0, n_escrituras = 0;
+    for (int i = 0; i < n_posiciones; i++)
+    {
+        client_t *cliente = &clients->clientArray[estado->posiciones[i]];
+        cola_salida_t *salida = &cliente->salida;
+
+        if (cliente->pipe < 0 || salida->cantidad == 0)
+            continue;
+
+        // TCP puede dejar una trama a medias, se escribe fuera del lote
+        if (cliente->transporte == TRANSPORTE_TCP)
+        {
+            if (vaciarSalida(clients, cliente) != SUCCESS_GENERIC)
+            {
+                fprintf(stderr, "La conexión del cliente (%d) se cerró\n", cliente->clientPID);
+                clientesCaidos++;
+                cerrarCliente(clients, cliente);
+            }
+            continue;
+        }
+
+        // No cabe en el lote actual: enviarlo antes de seguir
+        if (n_escrituras + salida->cantidad > TAM_URING)
+        {
+            completarEscrituras(estado, clients, n_clientes, n_escrituras);
+            n_clientes = n_escrituras = 0;
+        }
+
+        struct escritura_uring *escritura = &estado->escrituras[n_clientes];
+        escritura->posicion = estado->posiciones[i];
+        escritura->fd = cliente->pipe;
+        escritura->exitos = 0;
+        escritura->error = false;
+
+        // Enlazadas para conservar el orden: si el pipe se llena (EAGAIN) las
+        // siguientes se cancelan y quedan en la cola
+        for (int j = 0; j < salida->cantidad; j++)
+        {
+            unsigned char *mensaje = estado->mensajes[n_escrituras + j];
+            int tam = codificarPaquete(
+                &salida->paquetes[(salida->inicio + j) % TAM_COLA_SALIDA],
+                cliente->formato, mensaje);
+
+            struct io_uring_sqe *sqe = uringSqe(&estado->ring);
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = cliente->pipe;
+            sqe->addr = (unsigned long)mensaje;
+            sqe->len = tam;
+            sqe->user_data = tokenUring(DATO_ESCRITURA, n_clientes);
+
+            if (j < salida->cantidad - 1)
+                sqe->flags = IOSQE_IO_LINK;
+        }
+
+        n_escrituras += salida->cantidad;
+        n_clientes++;
+    }
+
+    if (n_escrituras > 0)
+        completarEscrituras(estado, clients, n_clientes, n_escrituras);
+}
+
+void completarEscrituras(struct bucle_uring *estado,
+                         struct client_list *clients,
+                         int n_clientes,
+                         int n_escrituras)
+{
+    //! 1. Enviar el lote y esperar todas sus completaciones, los pipes están en
+    //! O_NONBLOCK así que ninguna escritura queda en espera dentro del kernel
+    int faltantes = n_escrituras;
+    while (faltantes > 0)
+    {
+        if (uringEnviar(&estado->ring, 1) < 0 && errno != EINTR)
+        {
+            perror("io_uring");
+            break;
+        }
+
+        struct io_uring_cqe *cqe;
+        while ((cqe = uringCqe(&estado->ring)) != NULL)
+        {
+            if ((int)(cqe->user_data >> 32) == DATO_ESCRITURA)
+            {
+                struct escritura_uring *escritura =
+                    &estado->escrituras[(uint32_t)cqe->user_data];
+
+                // Escritura atómica: si escribió algo, escribió el mensaje
+                if (cqe->res > 0)
+                    escritura->exitos++;
+                else if (cqe->res != -EAGAIN && cqe->res != -ECANCELED)
+                    escritura->error = true;
+
+                faltantes--;
+            }
+
+            // Lecturas y avisos se atienden después, sin el semáforo de salida
+            else
+                atenderCompletacion(estado, cqe);
+
+            uringAvanzar(&estado->ring);
+        }
+    }
+
+    //! 2. Retirar de cada cola lo que se escribió
+    for (int i = 0; i < n_clientes; i++)
+    {
+        struct escritura_uring *escritura = &estado->escrituras[i];
+        client_t *cliente = &clients->clientArray[escritura->posicion];
+
+        if (cliente->pipe != escritura->fd)
+            continue;
+
+        avanzarSalida(clients, cliente, escritura->exitos);
+        estado->respuestas += escritura->exitos;
+
+        if (escritura->error)
+        {
+            fprintf(stderr, "El pipe del cliente (%d) se cerró\n", cliente->clientPID);
+            clientesCaidos++;
+            cerrarCliente(clients, cliente);
+        }
+    }
+
+    estado->lotes++;
+}
+
+/* ---------------------------- Manejo de libros ---------------------------- */
+
+int manejarLibros(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_prestamos_t *prestamos,
+    colas_reserva_t *reservas,
+    indice_titulos_t *titulos,
+    cache_busqueda_t *cache)
+{
+    // Notificación
+    printf("\nSe recibió una solicitud del cliente (%d)\n", package.client);
 
     // Optener el pipe del cliente
     int pipeCliente = buscarCliente(clients, package.client);
 
-    if (pipeCliente < 0)
+    if (pipeCliente < 0)
+    {
+        perror("Error");
+        return ERROR_COMUNICACION;
+    }
+
+    // La lista de préstamos se responde en varios paquetes
+    if (package.data.libro.petition == MIS_PRESTAMOS)
+        return listarPrestamos(clients, package, ejemplar, prestamos);
+
+    // Igual que los resultados de una búsqueda
+    if (package.data.libro.petition == BUSCAR_TODOS)
+        return buscarEjemplares(clients, package, ejemplar, titulos);
+
+    if (package.data.libro.petition == BUSCAR_PREFIJO ||
+        package.data.libro.petition == BUSCAR_PALABRA)
+        return buscarTitulos(clients, package, ejemplar, titulos);
+
+    if (package.data.libro.petition == BUSCAR_PARECIDOS)
+        return buscarParecidosCliente(clients, package, ejemplar, titulos);
+
+    // La respuesta de un título que no ha cambiado ya está escrita
+    if (package.data.libro.petition == BUSCAR)
+        return responderBusqueda(clients, package, ejemplar, prestamos, reservas,
+                                 titulos, cache);
+
+    paquet_t respuesta;
+    int afectado, posicion;
+    pid_t prestatario = prestatarioDe(clients, package.client);
+    int status = atenderLibro(package, ejemplar, prestamos, prestatario, reservas,
+                              titulos, &respuesta, &afectado, &posicion);
+
+    // Petición desconocida: no hay nada que responder
+    if (status == ERROR_COMUNICACION)
+        return status;
+
+    // El ejemplar devuelto pasa al primero que reservó el título
+    if (respuesta.type == SIGNAL && respuesta.data.signal.code == DEVOLUCION)
+        entregarReservas(clients, posicion, ejemplar, prestamos, reservas, titulos);
+
+    // El cliente reconoce la respuesta por el id, no por el orden
+    respuesta.id = package.id;
+
+    if (enviarRespuesta(clients, package.client, &respuesta) != SUCCESS_GENERIC)
+    {
+        perror("Error");
+        return ERROR_COMUNICACION;
+    }
+
+    return status;
+}
+
+int responderBusqueda(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_prestamos_t *prestamos,
+    colas_reserva_t *reservas,
+    indice_titulos_t *titulos,
+    cache_busqueda_t *cache)
+{
+    //! 1. Título de la petición (un nombre mal escrito no se guarda, lo
+    //! corrige atenderLibro)
+    clave_t clave;
+    normalizarNombre(package.data.libro.name, &clave);
+    int titulo = buscarTitulo(titulos, ejemplar, package.data.libro.ISBN, &clave);
+
+    respuesta_cache_t *entrada = NULL;
+    if (titulo != SIN_TITULO && (entrada = consultarCache(cache, titulos, titulo)) != NULL)
+    {
+        printf("La petición es de tipo: BUSCAR\n");
+        printf("El libro '%s' fue encontrado (caché)\n", package.data.libro.name);
+    }
+
+    //! 2. Sin respuesta vigente: armarla y guardarla
+    int status = SUCCESS_GENERIC;
+    if (entrada == NULL)
+    {
+        paquet_t respuesta;
+        int afectado, posicion;
+        status = atenderLibro(package, ejemplar, prestamos, SIN_PRESTATARIO, reservas,
+                              titulos, &respuesta, &afectado, &posicion);
+
+        if (status == SUCCESS_GENERIC && titulo != SIN_TITULO)
+            entrada = guardarCache(cache, titulos, titulo, &respuesta);
+
+        if (entrada == NULL)
+        {
+            respuesta.id = package.id;
+            if (enviarRespuesta(clients, package.client, &respuesta) != SUCCESS_GENERIC)
+            {
+                perror("Error");
+                return ERROR_COMUNICACION;
+            }
+            return status;
+        }
+    }
+
+    //! 3. Enviar la respuesta guardada
+    if (enviarCache(clients, package.client, package.id, entrada) != SUCCESS_GENERIC)
+    {
+        perror("Error");
+        return ERROR_COMUNICACION;
+    }
+
+    return status;
+}
+
+int combinarBusquedas(
+    struct client_list *clients,
+    buffer_t *buffer,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_titulos_t *titulos,
+    cache_busqueda_t *cache)
+{
+    //! 1. La respuesta que se acaba de enviar
+    clave_t clave;
+    normalizarNombre(package.data.libro.name, &clave);
+    int titulo = buscarTitulo(titulos, ejemplar, package.data.libro.ISBN, &clave);
+
+    respuesta_cache_t *entrada = NULL;
+    if (titulo == SIN_TITULO || (entrada = respuestaVigente(cache, titulos, titulo)) == NULL)
+        return 0;
+
+    //! 2. Repartirla a las búsquedas idénticas que esperan, sólo hasta la
+    //! primera petición que cambia el libro: las búsquedas que llegaron
+    //! después deben ver ese cambio (y el cliente, el de su propia petición)
+    int combinadas = 0;
+    int enCola = countQueued(buffer);
+    for (int k = 1; k <= enCola; k++)
+    {
+        peticion_buffer_t *otra = peek(buffer, k);
+        paquet_t *paquete = &otra->paquete;
+
+        if (cambiaLibro(paquete, package.data.libro.ISBN))
+            break;
+
+        if (otra->atendida || paquete->type != BOOK ||
+            paquete->data.libro.petition != BUSCAR ||
+            paquete->data.libro.ISBN != package.data.libro.ISBN)
+            continue;
+
+        clave_t suya;
+        normalizarNombre(paquete->data.libro.name, &suya);
+        if (!mismaClave(&suya, &clave))
+            continue;
+
+        otra->atendida = true;
+        combinadas++;
+
+        if (enviarCache(clients, paquete->client, paquete->id, entrada) != SUCCESS_GENERIC)
+            fprintf(stderr, "No se pudo responder al cliente (%d)\n", paquete->client);
+    }
+
+    if (combinadas > 0)
+    {
+        printf("La búsqueda de '%s' se respondió también a %d peticiones en cola\n",
+               package.data.libro.name, combinadas);
+        busquedasCombinadas += combinadas;
+        gruposCombinados++;
+    }
+
+    return combinadas;
+}
+
+int atenderLibro(paquet_t package,
+                 book_t ejemplar[],
+                 indice_prestamos_t *prestamos,
+                 pid_t prestatario,
+                 colas_reserva_t *reservas,
+                 indice_titulos_t *titulos,
+                 paquet_t *respuesta,
+                 int *afectado,
+                 int *posicion)
+{
+    char buffer[TAM_STRING];
+    *afectado = 0;
+    *posicion = SIN_EJEMPLAR;
+
+    //! El nombre se normaliza una sola vez, los ejemplares se comparan por
+    //! su clave (no importan mayúsculas, tildes ni espacios de más)
+    clave_t clave;
+    normalizarNombre(package.data.libro.name, &clave);
+
+    //! Un nombre que no existe (mal escrito) se cambia por el del título más
+    //! parecido con el mismo ISBN; si no hay ninguno, el error lo sugiere
+    char sugerencia[TAM_STRING] = "";
+    enum BOOK_REQUEST_T tipo = package.data.libro.petition;
+    if (tipo == SOLICITAR || tipo == RENOVAR || tipo == DEVOLVER || tipo == BUSCAR ||
+        tipo == RESERVAR)
+        resolverTitulo(titulos, ejemplar, &package.data.libro, &clave, sugerencia);
+
+    switch (package.data.libro.petition)
+    {
+    case SOLICITAR: //! Petición de solicitud
+    {
+        // Notificar
+        printf("La petición es de tipo: SOLICITAR\n");
+
+        // 1. Buscar el libro
+        book_t libro = package.data.libro;
+
+        bool encontrado = false;
+        for (int i = 0; i < MAX_CANT_LIBROS; i++)
+        {
+            if (ejemplar[i].ISBN == libro.ISBN &&
+                mismaClave(&titulos->claves[i], &clave))
+            {
+                encontrado = true;
+            }
+        }
+
+        *respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
+
+        if (!encontrado)
+        {
+            fprintf(stderr, "El libro no fue encontrado...\n");
+            strcpy(respuesta->data.signal.buffer, sugerencia);
+            return ERROR_SOLICITUD;
+        }
+
+        // Mostrar notificación
+        printf("El libro '%s' fue encontrado\n", libro.name);
+
+        // 2. Verificar si está disponible
+
+        bool libroActualizado = false;
+        for (int i = 0; i < MAX_CANT_LIBROS; i++)
+        {
+            if (ejemplar[i].ISBN == libro.ISBN &&
+                mismaClave(&titulos->claves[i], &clave) &&
+                ejemplar[i].copyInfo.state == 'D')
+            {
+                printf("El libro '%s' será actualizado\n", libro.name);
+
+                // 3. Modificar el estado del libro
+                libroActualizado = true;
+                *afectado = ejemplar[i].copyInfo.n_copy;
+                *posicion = i;
+                prestarEjemplar(&ejemplar[i], buffer);
+                ejemplarCambiado(titulos, ejemplar, i);
+                registrarPrestamo(prestamos, ejemplar, i, prestatario);
+                break;
+            }
+        }
+
+        // 4. Avisar al cliente
+        if (!libroActualizado)
+        {
+            *respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
+            fprintf(stderr, "El libro no está disponible\n");
+            return ERROR_SOLICITUD;
+        }
+        else
+        {
+            // Enviar también la fecha
+            *respuesta = generarRespuesta(package.client, SOLICITUD, buffer);
+
+            fprintf(stdout, "Solicitud exitosa (%d)\n", package.client);
+            return SUCCESS_GENERIC;
+        }
+    }
+    break;
+
+    //TODO
+    case RENOVAR: //! Petición de renovación
+    {
+        // Notificar
+        printf("La petición es de tipo: RENOVAR\n");
+
+        // 1. Buscar el libro
+        book_t libro = package.data.libro;
+
+        bool encontrado = false;
+        for (int i = 0; i < MAX_CANT_LIBROS; i++)
+        {
+            if (ejemplar[i].ISBN == libro.ISBN &&
+                mismaClave(&titulos->claves[i], &clave))
+            {
+                encontrado = true;
+            }
+        }
+
+        *respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
+
+        if (!encontrado)
+        {
+            fprintf(stderr, "El libro no fue encontrado...\n");
+            strcpy(respuesta->data.signal.buffer, sugerencia);
+            return ERROR_SOLICITUD;
+        }
+
+        // Mostrar notificación
+        printf("El libro '%s' fue encontrado\n", libro.name);
+
+        // 2. Verificar si está //? OCUPADO
+        bool libroActualizado = false;
+        for (int i = 0; i < MAX_CANT_LIBROS; i++)
+        {
+            if (ejemplar[i].ISBN == libro.ISBN &&
+                mismaClave(&titulos->claves[i], &clave) &&
+                ejemplar[i].copyInfo.state == 'P' && //? P de PRESTADO
+                (libro.copyInfo.n_copy == 0 || // 0: el primero que tiene el cliente
+                 ejemplar[i].copyInfo.n_copy == libro.copyInfo.n_copy) &&
+                puedeDevolver(prestamos, i, prestatario, libro.copyInfo.n_copy != 0))
+            {
+                printf("El libro '%s' será actualizado\n", libro.name);
+
+                // 3. Modificar el estado del libro
+                libroActualizado = true;
+                *afectado = ejemplar[i].copyInfo.n_copy;
+                *posicion = i;
+                renovarEjemplar(&ejemplar[i], buffer);
+                ejemplarCambiado(titulos, ejemplar, i);
+
+                break;
+            }
+        }
+
+        // 4. Avisar al cliente
+        if (!libroActualizado)
+        {
+            *respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
+            fprintf(stderr, "El libro no está disponible\n");
+            return ERROR_SOLICITUD;
+        }
+        else
+        {
+            // Enviar también la fecha
+            //? Cambiar el tipo de paquete
+            *respuesta = generarRespuesta(package.client, RENOVACION, buffer);
+
+            fprintf(stdout, "Solicitud exitosa (%d)\n", package.client);
+            return SUCCESS_GENERIC;
+        }
+    }
+    break;
+
+    case DEVOLVER: //! Petición de devolución
+    {
+        // Notificar
+        printf("La petición es de tipo: DEVOLVER\n");
+
+        // 1. Buscar el libro
+        book_t libro = package.data.libro;
+
+        bool encontrado = false;
+        for (int i = 0; i < MAX_CANT_LIBROS; i++)
+        {
+            if (ejemplar[i].ISBN == libro.ISBN &&
+                mismaClave(&titulos->claves[i], &clave))
+            {
+                encontrado = true;
+            }
+        }
+
+        *respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
+
+        if (!encontrado)
+        {
+            fprintf(stderr, "El libro no fue encontrado...\n");
+            strcpy(respuesta->data.signal.buffer, sugerencia);
+            return ERROR_SOLICITUD;
+        }
+
+        // Mostrar notificación
+        printf("El libro '%s' fue encontrado\n", libro.name);
+
+        // 2. Verificar si está //? OCUPADO
+        bool libroActualizado = false;
+        for (int i = 0; i < MAX_CANT_LIBROS; i++)
+        {
+            if (ejemplar[i].ISBN == libro.ISBN &&
+                mismaClave(&titulos->claves[i], &clave) &&
+                ejemplar[i].copyInfo.state == 'P' && //? P de PRESTADO
+                (libro.copyInfo.n_copy == 0 || // 0: el primero que tiene el cliente
+                 ejemplar[i].copyInfo.n_copy == libro.copyInfo.n_copy) &&
+                puedeDevolver(prestamos, i, prestatario, libro.copyInfo.n_copy != 0))
+            {
+                printf("El libro '%s' será actualizado\n", libro.name);
+
+                // 3. Modificar el estado del libro
+                libroActualizado = true;
+                *afectado = ejemplar[i].copyInfo.n_copy;
+                *posicion = i;
+                devolverEjemplar(&ejemplar[i], buffer);
+                ejemplarCambiado(titulos, ejemplar, i);
+                quitarPrestamo(prestamos, ejemplar, i);
+                break;
+            }
+        }
+
+        // 4. Avisar al cliente
+        if (!libroActualizado)
+        {
+            *respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
+            fprintf(stderr, "El libro no está disponible\n");
+            return ERROR_SOLICITUD;
+        }
+        else
+        {
+            // Enviar también la fecha
+            //? Cambiar el tipo de paquete
+            *respuesta = generarRespuesta(package.client, DEVOLUCION, buffer);
+
+            fprintf(stdout, "Solicitud exitosa (%d)\n", package.client);
+            return SUCCESS_GENERIC;
+        }
+    }
+    break;
+
+    case BUSCAR: //! Petición de búsqueda
+    {
+        // Notificar
+        printf("La petición es de tipo: BUSCAR\n");
+
+        // 1. Buscar el libro
+        book_t libro = package.data.libro;
+
+        bool encontrado = false;
+        for (int i = 0; i < MAX_CANT_LIBROS; i++)
+        {
+            if (ejemplar[i].ISBN == libro.ISBN &&
+                mismaClave(&titulos->claves[i], &clave))
+            {
+                encontrado = true;
+
+                respuesta->type = BOOK;
+                respuesta->client = package.client;
+                respuesta->data.libro = ejemplar[i];
+
+                // Mostrar notificación
+                printf("El libro '%s' fue encontrado\n", libro.name);
+
+                return SUCCESS_GENERIC;
+            }
+        }
+
+        *respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
+        respuesta->type = ERR;
+
+        fprintf(stderr, "El libro no fue encontrado...\n");
+        return ERROR_SOLICITUD;
+
+        // Mostrar notificación
+        fprintf(stderr, "El libro '%s' NO fue encontrado\n", libro.name);
+    }
+    break;
+
+    case RENOVAR_PROPIO:  //! Renovar el ejemplar que tiene el cliente
+    case DEVOLVER_PROPIO: //! Devolver el ejemplar que tiene el cliente
     {
-        perror("Error");
-        return ERROR_COMUNICACION;
-    }
+        book_t libro = package.data.libro;
+        bool renovar = (libro.petition == RENOVAR_PROPIO);
 
-    paquet_t respuesta;
-    char buffer[TAM_STRING];
+        // Notificar
+        printf("La petición es de tipo: %s\n",
+               renovar ? "RENOVAR_PROPIO" : "DEVOLVER_PROPIO");
 
-    switch (package.data.libro.petition)
-    {
-    case SOLICITAR: //! Petición de solicitud
+        // 1. El índice dice qué ejemplar tiene el cliente, sin recorrer la BD
+        // (uno sin prestatario sólo se toca con RENOVAR o DEVOLVER y su número)
+        int i = buscarPrestamo(prestamos, ejemplar, prestatario, libro.ISBN);
+
+        if (i == SIN_EJEMPLAR)
+        {
+            *respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
+            fprintf(stderr, "El cliente (%d) no tiene ejemplares del libro %d\n",
+                    package.client, libro.ISBN);
+            return ERROR_SOLICITUD;
+        }
+
+        printf("El libro '%s' será actualizado\n", ejemplar[i].name);
+
+        // 2. Modificar el estado del ejemplar y avisar al cliente
+        *afectado = ejemplar[i].copyInfo.n_copy;
+        *posicion = i;
+
+        if (renovar)
+        {
+            renovarEjemplar(&ejemplar[i], buffer);
+            ejemplarCambiado(titulos, ejemplar, i);
+            *respuesta = generarRespuesta(package.client, RENOVACION, buffer);
+        }
+        else
+        {
+            devolverEjemplar(&ejemplar[i], buffer);
+            ejemplarCambiado(titulos, ejemplar, i);
+            quitarPrestamo(prestamos, ejemplar, i);
+            *respuesta = generarRespuesta(package.client, DEVOLUCION, buffer);
+        }
+
+        fprintf(stdout, "Solicitud exitosa (%d)\n", package.client);
+        return SUCCESS_GENERIC;
+    }
+    break;
+
+    case RESERVAR: //! Petición de reserva
     {
         // Notificar
-        printf("La petición es de tipo: SOLICITAR\n");
+        printf("La petición es de tipo: RESERVAR\n");
 
-        // 1. Buscar el libro
+        // 1. Buscar el título (su primer ejemplar) y uno disponible
         book_t libro = package.data.libro;
 
-        bool encontrado = false;
+        int titulo = SIN_EJEMPLAR, disponible = SIN_EJEMPLAR;
         for (int i = 0; i < MAX_CANT_LIBROS; i++)
         {
             if (ejemplar[i].ISBN == libro.ISBN &&
-                (strcmp(ejemplar[i].name, libro.name) == 0))
+                mismaClave(&titulos->claves[i], &clave))
             {
-                encontrado = true;
+                if (titulo == SIN_EJEMPLAR)
+                    titulo = i;
+                if (disponible == SIN_EJEMPLAR && ejemplar[i].copyInfo.state == 'D')
+                    disponible = i;
             }
         }
 
-        respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
+        *respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
 
-        if (!encontrado)
+        if (titulo == SIN_EJEMPLAR)
         {
             fprintf(stderr, "El libro no fue encontrado...\n");
-            if (write(pipeCliente, &respuesta, sizeof(respuesta)) < 0)
-            {
-                perror("Error");
-                return ERROR_SOLICITUD;
-            }
+            strcpy(respuesta->data.signal.buffer, sugerencia);
             return ERROR_SOLICITUD;
         }
 
-        // Mostrar notificación
-        printf("El libro '%s' fue encontrado\n", libro.name);
-
-        // 2. Verificar si está disponible
-
-        bool libroActualizado = false;
-        for (int i = 0; i < MAX_CANT_LIBROS; i++)
+        // 2. Hay uno disponible: se presta de una vez
+        if (disponible != SIN_EJEMPLAR)
         {
-            if (ejemplar[i].ISBN == libro.ISBN &&
-                (strcmp(ejemplar[i].name, libro.name) == 0) &&
-                ejemplar[i].copyInfo.state == 'D')
-            {
-                printf("El libro '%s' será actualizado\n", libro.name);
+            *afectado = ejemplar[disponible].copyInfo.n_copy;
+            *posicion = disponible;
+            prestarEjemplar(&ejemplar[disponible], buffer);
+            ejemplarCambiado(titulos, ejemplar, disponible);
+            registrarPrestamo(prestamos, ejemplar, disponible, prestatario);
+            *respuesta = generarRespuesta(package.client, SOLICITUD, buffer);
 
-                // 3. Modificar el estado del libro
+            fprintf(stdout, "Solicitud exitosa (%d)\n", package.client);
+            return SUCCESS_GENERIC;
+        }
 
-                // Actualizar libro
-                // Actualizar su estado
-                libroActualizado = true;
-                ejemplar[i].copyInfo.state = 'P';
+        // 3. Todos prestados: esperar en la cola del título
+        int posicion = encolarReserva(reservas, titulo, package.client, package.id);
+
+        if (posicion == 0)
+        {
+            fprintf(stderr, "El cliente (%d) ya reservó el libro '%s'\n",
+                    package.client, libro.name);
+            return ERROR_SOLICITUD;
+        }
+        else if (posicion < 0)
+        {
+            fprintf(stderr, "No quedan reservas libres\n");
+            return ERROR_SOLICITUD;
+        }
 
-                // Actualizar su fecha //! Tiene que ser dentro de 1 semana
-                char fecha[TAM_STRING];
-                memset(fecha, 0, sizeof(fecha));
+        printf("El cliente (%d) es el #%d en la cola de '%s'\n",
+               package.client, posicion, libro.name);
 
-                time_t t;
-                struct tm *tm;
+        sprintf(buffer, "%d", posicion);
+        *respuesta = generarRespuesta(package.client, RESERVA, buffer);
+        return SUCCESS_GENERIC;
+    }
+    break;
 
-                t = time(NULL);
-                tm = localtime(&t);
+    default:
+        return ERROR_COMUNICACION;
+    }
 
-                //? Añadirle 1 semana
-                tm->tm_sec += WEEK_SEC;
-                mktime(tm);
+    return SUCCESS_GENERIC;
+}
 
-                // Formatear la fecha
-                strftime(fecha, TAM_STRING, "%d-%m-%Y", tm);
+int listarPrestamos(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_prestamos_t *prestamos)
+{
+    // Notificar
+    printf("La petición es de tipo: MIS_PRESTAMOS\n");
 
-                printf("IMPORTANTE: El libro está prestado hasta: %s\n", fecha);
+    //! 1. Contar los préstamos del cliente (sólo su cadena, no toda la BD)
+    pid_t prestatario = prestatarioDe(clients, package.client);
+    int total = 0;
+    for (int i = primerPrestamo(prestamos, prestatario); i != SIN_EJEMPLAR;
+         i = siguientePrestamo(prestamos, i))
+        total++;
 
-                strcpy(ejemplar[i].copyInfo.date, fecha);
-                strcpy(buffer, fecha);
+    paquet_t respuesta;
+    memset(&respuesta, 0, sizeof(respuesta));
+    respuesta.type = PRESTAMOS;
+    respuesta.client = package.client;
+    respuesta.id = package.id;
 
-                // Añadir qué ejemplar fue el que se prestó
-                //ADVERTENCIA: como ya no se necesita fecha la usamos de string auxiliar
-                memset(fecha, 0, sizeof(fecha));
-                sprintf(fecha, " (Ejemplar #%d)", ejemplar[i].copyInfo.n_copy);
-                strcat(buffer, fecha);
+    struct PAQUET_PRESTAMOS_T *parte = &respuesta.data.prestamos;
+    parte->total = (short)total;
 
-                break;
-            }
+    //! 2. Enviar de a MAX_PRESTAMOS_PAQUETE, al menos un paquete (el último)
+    int i = primerPrestamo(prestamos, prestatario);
+    do
+    {
+        parte->cantidad = 0;
+        for (; i != SIN_EJEMPLAR && parte->cantidad < MAX_PRESTAMOS_PAQUETE;
+             i = siguientePrestamo(prestamos, i))
+        {
+            prestamo_t *prestamo = &parte->prestamos[parte->cantidad++];
+            prestamo->ISBN = ejemplar[i].ISBN;
+            prestamo->n_copy = (short)ejemplar[i].copyInfo.n_copy;
+            snprintf(prestamo->date, TAM_FECHA, "%.10s", ejemplar[i].copyInfo.date);
         }
+        parte->ultimo = (i == SIN_EJEMPLAR);
 
-        // 4. Avisar al cliente
-        if (!libroActualizado)
+        if (enviarRespuesta(clients, package.client, &respuesta) != SUCCESS_GENERIC)
         {
-            respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
-            fprintf(stderr, "El libro no está disponible\n");
-            if (write(pipeCliente, &respuesta, sizeof(respuesta)) < 0)
-            {
-                perror("Error");
-                return ERROR_SOLICITUD;
-            }
-            return ERROR_SOLICITUD;
+            perror("Error");
+            return ERROR_COMUNICACION;
         }
+    } while (i != SIN_EJEMPLAR);
+
+    fprintf(stdout, "Se enviaron %d préstamos al cliente (%d)\n", total, package.client);
+    return SUCCESS_GENERIC;
+}
+
+int buscarEjemplares(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_titulos_t *titulos)
+{
+    // Notificar
+    printf("La petición es de tipo: BUSCAR_TODOS\n");
+
+    book_t consulta = package.data.libro;
+
+    int limite = consulta.n_copies;
+    if (limite <= 0 || limite > MAX_RESULTADOS_BUSQUEDA)
+        limite = MAX_RESULTADOS_BUSQUEDA;
+
+    int i = consulta.copyInfo.n_copy;
+    if (i < 0)
+        i = 0;
+
+    // El texto se normaliza una sola vez y se busca en las claves (no
+    // importan mayúsculas, tildes ni espacios de más)
+    clave_t texto;
+    normalizarNombre(consulta.name, &texto);
+
+    paquet_t respuesta;
+    memset(&respuesta, 0, sizeof(respuesta));
+    respuesta.type = BOOK;
+    respuesta.client = package.client;
+    respuesta.id = package.id;
+
+    //! 1. Un paquete por resultado, desde el cursor hasta el límite
+    int enviados = 0;
+    for (; i < MAX_CANT_LIBROS && enviados < limite; i++)
+    {
+        if (ejemplar[i].ISBN == 0)
+            continue;
+
+        bool coincide;
+        if (consulta.ISBN != 0)
+            coincide = (ejemplar[i].ISBN == consulta.ISBN);
         else
+            coincide = titulos->tituloDe[i] == i &&
+                       strstr(titulos->claves[i].texto, texto.texto) != NULL;
+
+        if (!coincide)
+            continue;
+
+        respuesta.data.libro = ejemplar[i];
+        if (enviarRespuesta(clients, package.client, &respuesta) != SUCCESS_GENERIC)
         {
-            // Enviar también la fecha
-            respuesta = generarRespuesta(package.client, SOLICITUD, buffer);
+            perror("Error");
+            return ERROR_COMUNICACION;
+        }
+        enviados++;
+    }
 
-            fprintf(stdout, "Solicitud exitosa (%d)\n", package.client);
-            if (write(pipeCliente, &respuesta, sizeof(respuesta)) < 0)
-            {
-                perror("Error");
-                return ERROR_SOLICITUD;
-            }
-            return SUCCESS_GENERIC;
+    //! 2. Cursor de la página siguiente (0 si ya no queda BD por recorrer)
+    while (i < MAX_CANT_LIBROS && ejemplar[i].ISBN == 0)
+        i++;
+
+    char cursor[TAM_STRING];
+    sprintf(cursor, "%d", (i < MAX_CANT_LIBROS) ? i : 0);
+
+    paquet_t fin = generarRespuesta(package.client, FIN_BUSQUEDA, cursor);
+    fin.id = package.id;
+
+    if (enviarRespuesta(clients, package.client, &fin) != SUCCESS_GENERIC)
+    {
+        perror("Error");
+        return ERROR_COMUNICACION;
+    }
+
+    fprintf(stdout, "Se enviaron %d resultados al cliente (%d)\n", enviados,
+            package.client);
+    return SUCCESS_GENERIC;
+}
+
+int buscarTitulos(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_titulos_t *titulos)
+{
+    book_t consulta = package.data.libro;
+    bool porPalabra = (consulta.petition == BUSCAR_PALABRA);
+
+    // Notificar
+    printf("La petición es de tipo: %s\n",
+           porPalabra ? "BUSCAR_PALABRA" : "BUSCAR_PREFIJO");
+
+    //! 1. Los resultados son consecutivos en el índice
+    int primero, total;
+    if (porPalabra)
+        total = buscarPalabra(titulos, consulta.name, &primero);
+    else
+        total = buscarPrefijo(titulos, consulta.name, &primero);
+
+    int limite = consulta.n_copies;
+    if (limite <= 0 || limite > MAX_RESULTADOS_BUSQUEDA)
+        limite = MAX_RESULTADOS_BUSQUEDA;
+
+    int cursor = consulta.copyInfo.n_copy;
+    if (cursor < 0)
+        cursor = 0;
+
+    paquet_t respuesta;
+    memset(&respuesta, 0, sizeof(respuesta));
+    respuesta.type = BOOK;
+    respuesta.client = package.client;
+    respuesta.id = package.id;
+
+    //! 2. Un paquete por título, desde el cursor hasta el límite
+    int k = cursor;
+    for (; k < total && k - cursor < limite; k++)
+    {
+        int titulo = porPalabra ? titulos->palabras[primero + k].titulo
+                                : titulos->porNombre[primero + k];
+
+        respuesta.data.libro = ejemplar[titulo];
+        if (enviarRespuesta(clients, package.client, &respuesta) != SUCCESS_GENERIC)
+        {
+            perror("Error");
+            return ERROR_COMUNICACION;
         }
     }
-    break;
 
-    //TODO
-    case RENOVAR: //! Petición de renovación
+    //! 3. Cursor de la página siguiente (0 si no hay más)
+    char siguiente[TAM_STRING];
+    sprintf(siguiente, "%d", (k < total) ? k : 0);
+
+    paquet_t fin = generarRespuesta(package.client, FIN_BUSQUEDA, siguiente);
+    fin.id = package.id;
+
+    if (enviarRespuesta(clients, package.client, &fin) != SUCCESS_GENERIC)
     {
-        // Notificar
-        printf("La petición es de tipo: RENOVAR\n");
+        perror("Error");
+        return ERROR_COMUNICACION;
+    }
 
-        // 1. Buscar el libro
-        book_t libro = package.data.libro;
+    fprintf(stdout, "Se enviaron %d de %d títulos al cliente (%d)\n",
+            (k > cursor) ? k - cursor : 0, total, package.client);
+    return SUCCESS_GENERIC;
+}
 
-        bool encontrado = false;
-        for (int i = 0; i < MAX_CANT_LIBROS; i++)
+int buscarParecidosCliente(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_titulos_t *titulos)
+{
+    // Notificar
+    printf("La petición es de tipo: BUSCAR_PARECIDOS\n");
+
+    int k = package.data.libro.n_copies;
+    if (k <= 0 || k > MAX_PARECIDOS)
+        k = MAX_PARECIDOS;
+
+    parecido_t parecidos[MAX_PARECIDOS];
+    int n = buscarParecidos(titulos, package.data.libro.name, parecidos, k);
+
+    paquet_t respuesta;
+    memset(&respuesta, 0, sizeof(respuesta));
+    respuesta.type = BOOK;
+    respuesta.client = package.client;
+    respuesta.id = package.id;
+
+    //! 1. Un paquete por título, el número de ejemplar lleva el parecido (%)
+    for (int i = 0; i < n; i++)
+    {
+        respuesta.data.libro = ejemplar[parecidos[i].titulo];
+        respuesta.data.libro.copyInfo.n_copy = parecidos[i].puntaje;
+
+        if (enviarRespuesta(clients, package.client, &respuesta) != SUCCESS_GENERIC)
         {
-            if (ejemplar[i].ISBN == libro.ISBN &&
-                (strcmp(ejemplar[i].name, libro.name) == 0))
+            perror("Error");
+            return ERROR_COMUNICACION;
+        }
+    }
+
+    //! 2. Una sola página
+    paquet_t fin = generarRespuesta(package.client, FIN_BUSQUEDA, "0");
+    fin.id = package.id;
+
+    if (enviarRespuesta(clients, package.client, &fin) != SUCCESS_GENERIC)
+    {
+        perror("Error");
+        return ERROR_COMUNICACION;
+    }
+
+    fprintf(stdout, "Se enviaron %d títulos parecidos al cliente (%d)\n", n,
+            package.client);
+    return SUCCESS_GENERIC;
+}
+
+bool corregirTitulo(indice_titulos_t *titulos,
+                    book_t ejemplar[],
+                    book_t *libro,
+                    char *sugerencia)
+{
+    parecido_t parecidos[MAX_PARECIDOS];
+    int n = buscarParecidos(titulos, libro->name, parecidos, MAX_PARECIDOS);
+
+    // El ISBN confirma que se trata del mismo libro
+    for (int i = 0; i < n && parecidos[i].puntaje >= UMBRAL_PARECIDO; i++)
+    {
+        book_t *titulo = &ejemplar[parecidos[i].titulo];
+        if (titulo->ISBN != libro->ISBN)
+            continue;
+
+        printf("El nombre '%s' se corrigió a '%s' (parecido %d%%)\n", libro->name,
+               titulo->name, parecidos[i].puntaje);
+        strcpy(libro->name, titulo->name);
+        return true;
+    }
+
+    if (n > 0)
+        snprintf(sugerencia, TAM_STRING, "¿Quiso decir '%.60s' (ISBN %d)?",
+                 ejemplar[parecidos[0].titulo].name, ejemplar[parecidos[0].titulo].ISBN);
+
+    return false;
+}
+
+void resolverTitulo(indice_titulos_t *titulos,
+                    book_t ejemplar[],
+                    book_t *libro,
+                    clave_t *clave,
+                    char *sugerencia)
+{
+    if (!existeTitulo(titulos, ejemplar, libro->ISBN, clave) &&
+        corregirTitulo(titulos, ejemplar, libro, sugerencia))
+        normalizarNombre(libro->name, clave);
+}
+
+int entregarReservas(
+    struct client_list *clients,
+    int posicion,
+    book_t ejemplar[],
+    indice_prestamos_t *prestamos,
+    colas_reserva_t *reservas,
+    indice_titulos_t *titulos)
+{
+    //! 1. El título se identifica por su primer ejemplar (están juntos), el
+    //! mismo con el que RESERVAR encoló al cliente
+    if (posicion == SIN_EJEMPLAR)
+        return 0;
+
+    int titulo = titulos->tituloDe[posicion];
+
+    int entregados = 0;
+    while (true)
+    {
+        //! 2. Un ejemplar disponible del título
+        int disponible = SIN_EJEMPLAR;
+        for (int i = titulo; i < MAX_CANT_LIBROS && titulos->tituloDe[i] == titulo &&
+                             ejemplar[i].ISBN == ejemplar[titulo].ISBN;
+             i++)
+        {
+            if (ejemplar[i].copyInfo.state == 'D')
             {
-                encontrado = true;
+                disponible = i;
+                break;
             }
         }
 
-        respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
+        if (disponible == SIN_EJEMPLAR)
+            break;
+
+        //! 3. El primero de la cola que siga conectado (las reservas de los
+        //! cerrados se quitan en liberarCerrados, pero uno pudo irse después)
+        reserva_t reserva;
+        bool conectado = false;
+        sem_wait(&semaforo_salida);
+        while (!conectado && sacarReserva(reservas, titulo, &reserva))
+            conectado = (obtenerCliente(clients, reserva.cliente) != NULL);
+        sem_post(&semaforo_salida);
+
+        if (!conectado)
+            break;
+
+        //! 4. Prestárselo y avisarle con el id de su reserva
+        char buffer[TAM_STRING];
+        prestarEjemplar(&ejemplar[disponible], buffer);
+        ejemplarCambiado(titulos, ejemplar, disponible);
+        registrarPrestamo(prestamos, ejemplar, disponible,
+                          prestatarioDe(clients, reserva.cliente));
+
+        printf("El ejemplar #%d de '%s' se entregó al cliente (%d) que lo reservó\n",
+               ejemplar[disponible].copyInfo.n_copy, ejemplar[disponible].name,
+               reserva.cliente);
+
+        paquet_t aviso = generarRespuesta(reserva.cliente, AVISO_RESERVA, buffer);
+        aviso.id = reserva.id;
+
+        // Aunque no se pueda avisar, el préstamo queda en MIS_PRESTAMOS
+        if (enviarRespuesta(clients, reserva.cliente, &aviso) != SUCCESS_GENERIC)
+            fprintf(stderr, "No se pudo avisar al cliente (%d)\n", reserva.cliente);
+
+        entregados++;
+    }
+
+    return entregados;
+}
+
+pid_t prestatarioDe(struct client_list *clients, pid_t client)
+{
+    //! Región crítica (Colas de salida): el hilo de conexiones puede cerrar
+    //! al cliente y reusar su posición del slab
+    sem_wait(&semaforo_salida);
+
+    int lector = SIN_LECTOR;
+    client_t *cliente = obtenerCliente(clients, client);
+    if (cliente != NULL)
+    {
+        lector = cliente->lector;
+        cliente->porLiberar = true;
+    }
+    else if (clients->n_cerrados < MAX_CLIENTES)
+    {
+        // Ya se fue: lo que se le preste o reserve ahora se libera con los demás
+        clients->cerrados[clients->n_cerrados++] = client;
+    }
+
+    //! Fin de la región crítica
+    sem_post(&semaforo_salida);
+
+    if (lector != SIN_LECTOR)
+        return prestatarioLector(lector);
+
+    return client;
+}
+
+void liberarCerrados(struct client_list *clients,
+                     indice_prestamos_t *prestamos,
+                     colas_reserva_t *reservas,
+                     book_t ejemplar[])
+{
+    //! Región crítica (Colas de salida): la lista la llena cerrarCliente
+    sem_wait(&semaforo_salida);
+
+    for (int c = 0; c < clients->n_cerrados; c++)
+    {
+        pid_t client = clients->cerrados[c];
+        for (int i = primerPrestamo(prestamos, client); i != SIN_EJEMPLAR;
+             i = primerPrestamo(prestamos, client))
+            quitarPrestamo(prestamos, ejemplar, i);
+
+        // Nadie recibe lo que reservó un cliente que ya no está
+        quitarReservasCliente(reservas, client);
+    }
+    clients->n_cerrados = 0;
+
+    //! Fin de la región crítica
+    sem_post(&semaforo_salida);
+}
+
+bool cambiaLibro(const paquet_t *paquete, int ISBN)
+{
+    // Un lote o una transacción lo cambia si alguna de sus operaciones lo toca
+    if (llevaOperaciones(paquete))
+    {
+        for (int i = 0; i < paquete->data.lote->cantidad; i++)
+            if (paquete->data.lote->operaciones[i].ISBN == ISBN)
+                return true;
+
+        return false;
+    }
+
+    if (paquete->type != BOOK || paquete->data.libro.ISBN != ISBN)
+        return false;
+
+    switch (paquete->data.libro.petition)
+    {
+    case SOLICITAR:
+    case RENOVAR:
+    case DEVOLVER:
+    case RENOVAR_PROPIO:
+    case DEVOLVER_PROPIO:
+    case RESERVAR:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+void ejemplarCambiado(indice_titulos_t *titulos, book_t ejemplar[], int posicion)
+{
+    cambioEjemplar(titulos, posicion);
+
+    // Los clientes de este equipo leen el ejemplar sin preguntar
+    if (catalogo != NULL)
+        escribirEjemplar(catalogo, titulos->tituloDe[posicion], posicion,
+                         &ejemplar[posicion]);
+}
+
+void prestarEjemplar(book_t *copia, char *buffer)
+{
+    copia->copyInfo.state = 'P';
+
+    // Actualizar su fecha //! Tiene que ser dentro de 1 semana
+    char fecha[TAM_STRING];
+    memset(fecha, 0, sizeof(fecha));
+
+    time_t t;
+    struct tm *tm;
+
+    t = time(NULL);
+    tm = localtime(&t);
+
+    //? Añadirle 1 semana
+    tm->tm_sec += WEEK_SEC;
+    mktime(tm);
+
+    // Formatear la fecha
+    strftime(fecha, TAM_STRING, "%d-%m-%Y", tm);
+
+    printf("IMPORTANTE: El libro está prestado hasta: %s\n", fecha);
+
+    strcpy(copia->copyInfo.date, fecha);
+
+    // Añadir qué ejemplar fue el que se prestó
+    sprintf(buffer, "%s (Ejemplar #%d)", fecha, copia->copyInfo.n_copy);
+}
+
+bool renovarEjemplar(book_t *copia, char *buffer)
+{
+    copia->copyInfo.state = 'P'; //? Se deja en PRESTADO
+
+    // Actualizar su fecha
+    //! A LA FECHA DE DEVOLUCIÓN QUE SE TENÍA se le suma 1 semana
 
-        if (!encontrado)
-        {
-            fprintf(stderr, "El libro no fue encontrado...\n");
-            if (write(pipeCliente, &respuesta, sizeof(respuesta)) < 0)
-            {
-                perror("Error");
-                return ERROR_SOLICITUD;
-            }
-            return ERROR_SOLICITUD;
-        }
+    char fecha[TAM_STRING];
+    memset(fecha, 0, sizeof(fecha));
 
-        // Mostrar notificación
-        printf("El libro '%s' fue encontrado\n", libro.name);
+    time_t t;
+    struct tm *fechaLibro;
 
-        // 2. Verificar si está //? OCUPADO
-        bool libroActualizado = false;
-        for (int i = 0; i < MAX_CANT_LIBROS; i++)
-        {
-            if (ejemplar[i].ISBN == libro.ISBN &&
-                (strcmp(ejemplar[i].name, libro.name) == 0) &&
-                ejemplar[i].copyInfo.state == 'P' && //? P de PRESTADO
-                ejemplar[i].copyInfo.n_copy == libro.copyInfo.n_copy)
-            {
-                printf("El libro '%s' será actualizado\n", libro.name);
+    t = time(NULL);
+    fechaLibro = localtime(&t);
 
-                // 3. Modificar el estado del libro
+    //? Obtener fecha del libro
+    strcpy(fecha, copia->copyInfo.date);
+    strptime(fecha, "%d-%m-%Y", fechaLibro);
 
-                // Actualizar libro
-                // Actualizar su estado
-                libroActualizado = true;
-                ejemplar[i].copyInfo.state = 'P'; //? Se deja en PRESTADO
+    //? Añadirle 1 semana
+    fechaLibro->tm_sec += WEEK_SEC;
+    time_t futura = mktime(fechaLibro);
 
-                // Actualizar su fecha
-                //! A LA FECHA DE DEVOLUCIÓN QUE SE TENÍA se le suma 1 semana
+    double diferencia = difftime(futura, t);
+    bool tarde = false;
+    if (diferencia < 0)
+    {
+        fprintf(stderr, "La fecha de entrega ya había vencido...\n");
+        fprintf(stderr, "Nueva fecha de entrega apartir de esta semana\n");
 
-                char fecha[TAM_STRING];
-                memset(fecha, 0, sizeof(fecha));
+        strcpy(buffer, "(DEVOLUCION TARDE) ");
 
-                time_t t;
-                struct tm *fechaLibro;
+        // Fecha a partir de hoy
+        fechaLibro = localtime(&t);
+        fechaLibro->tm_sec += WEEK_SEC;
+        (void)mktime(fechaLibro);
 
-                t = time(NULL);
-                fechaLibro = localtime(&t);
+        tarde = true;
+    }
 
-                //? Obtener fecha del libro
-                strcpy(fecha, ejemplar[i].copyInfo.date);
-                strptime(fecha, "%d-%m-%Y", fechaLibro);
+    // Formatear la fecha
+    strftime(fecha, TAM_STRING, "%d-%m-%Y", fechaLibro);
 
-                //? Añadirle 1 semana
-                fechaLibro->tm_sec += WEEK_SEC;
-                time_t futura = mktime(fechaLibro);
+    printf("IMPORTANTE: El libro está prestado hasta: %s\n", fecha);
 
-                double diferencia = difftime(futura, t);
-                bool tarde = false;
-                if (diferencia < 0)
-                {
-                    fprintf(stderr, "La fecha de entrega ya había vencido...\n");
-                    fprintf(stderr, "Nueva fecha de entrega apartir de esta semana\n");
+    strcpy(copia->copyInfo.date, fecha);
 
-                    memset(buffer, 0, sizeof(buffer));
-                    strcpy(buffer, "(DEVOLUCION TARDE) ");
+    if (!tarde)
+        strcpy(buffer, fecha);
+    else
+        strcat(buffer, fecha);
 
-                    // Fecha a partir de hoy
-                    fechaLibro = localtime(&t);
-                    fechaLibro->tm_sec += WEEK_SEC;
-                    (void)mktime(fechaLibro);
+    return tarde;
+}
 
-                    tarde = true;
-                }
+void devolverEjemplar(book_t *copia, char *buffer)
+{
+    copia->copyInfo.state = 'D'; //? Se pone disponible
 
-                // Formatear la fecha
-                strftime(fecha, TAM_STRING, "%d-%m-%Y", fechaLibro);
+    // Actualizar su fecha //? FECHA ACTUAL (Devolución)
+    char fecha[TAM_STRING];
+    memset(fecha, 0, sizeof(fecha));
 
-                printf("IMPORTANTE: El libro está prestado hasta: %s\n", fecha);
+    time_t t;
+    struct tm *tm;
 
-                strcpy(ejemplar[i].copyInfo.date, fecha);
+    t = time(NULL);
+    tm = localtime(&t);
+    strftime(fecha, TAM_STRING, "%d-%m-%Y", tm);
 
-                if (!tarde)
-                    strcpy(buffer, fecha);
-                else
-                    strcat(buffer, fecha);
+    //? INFORMACION
+    printf("IMPORTANTE: El libro fue devuelto en: %s\n", fecha);
 
-                break;
-            }
-        }
+    strcpy(copia->copyInfo.date, fecha);
+    strcpy(buffer, fecha);
+}
 
-        // 4. Avisar al cliente
-        if (!libroActualizado)
+int manejarLote(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_prestamos_t *prestamos,
+    colas_reserva_t *reservas,
+    indice_titulos_t *titulos,
+    bool expirado)
+{
+    lote_t *lote = package.data.lote;
+
+    // Notificación
+    printf("\nSe recibió un lote de %d operaciones del cliente (%d)\n",
+           lote->cantidad, package.client);
+
+    paquet_t respuesta;
+    memset(&respuesta, 0, sizeof(respuesta));
+    respuesta.type = RESULTADOS;
+    respuesta.client = package.client;
+    respuesta.id = package.id;
+    respuesta.data.resultados.cantidad = lote->cantidad;
+
+    // Cada operación se atiende igual que una petición suelta, pero todas las
+    // respuestas viajan juntas
+    pid_t prestatario = prestatarioDe(clients, package.client);
+    for (int i = 0; i < lote->cantidad; i++)
+    {
+        operacion_t *operacion = &lote->operaciones[i];
+        int afectado = 0, posicion = SIN_EJEMPLAR, codigo = PET_EXPIRADA;
+
+        if (!expirado)
         {
-            respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
-            fprintf(stderr, "El libro no está disponible\n");
-            if (write(pipeCliente, &respuesta, sizeof(respuesta)) < 0)
-            {
-                perror("Error");
-                return ERROR_SOLICITUD;
-            }
-            return ERROR_SOLICITUD;
+            paquet_t peticion, resultado;
+            memset(&peticion, 0, sizeof(peticion));
+            peticion.type = BOOK;
+            peticion.client = package.client;
+            peticion.id = package.id;
+            peticion.data.libro.petition = operacion->petition;
+            peticion.data.libro.ISBN = operacion->ISBN;
+            peticion.data.libro.copyInfo.n_copy = operacion->n_copy;
+            strcpy(peticion.data.libro.name, operacion->name);
+
+            codigo = PET_ERROR;
+            if (atenderLibro(peticion, ejemplar, prestamos, prestatario, reservas,
+                             titulos, &resultado, &afectado, &posicion) == SUCCESS_GENERIC &&
+                resultado.type == SIGNAL)
+                codigo = resultado.data.signal.code;
+
+            if (codigo == DEVOLUCION)
+                entregarReservas(clients, posicion, ejemplar, prestamos, reservas,
+                                 titulos);
         }
-        else
-        {
-            // Enviar también la fecha
-            //? Cambiar el tipo de paquete
-            respuesta = generarRespuesta(package.client, RENOVACION, buffer);
 
-            fprintf(stdout, "Solicitud exitosa (%d)\n", package.client);
-            if (write(pipeCliente, &respuesta, sizeof(respuesta)) < 0)
-            {
-                perror("Error");
-                return ERROR_SOLICITUD;
-            }
-            return SUCCESS_GENERIC;
-        }
+        respuesta.data.resultados.codigos[i] = (signed char)codigo;
+        respuesta.data.resultados.ejemplares[i] = (short)afectado;
     }
-    break;
 
-    case DEVOLVER: //! Petición de devolución
+    if (enviarRespuesta(clients, package.client, &respuesta) != SUCCESS_GENERIC)
     {
-        // Notificar
-        printf("La petición es de tipo: DEVOLVER\n");
+        perror("Error");
+        return ERROR_COMUNICACION;
+    }
 
-        // 1. Buscar el libro
-        book_t libro = package.data.libro;
+    return SUCCESS_GENERIC;
+}
 
-        bool encontrado = false;
-        for (int i = 0; i < MAX_CANT_LIBROS; i++)
+int manejarTransaccion(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_prestamos_t *prestamos,
+    indice_titulos_t *titulos,
+    bool expirado)
+{
+    lote_t *lote = package.data.lote;
+
+    // Notificación
+    printf("\nSe recibió una transacción de %d préstamos del cliente (%d)\n",
+           lote->cantidad, package.client);
+
+    paquet_t respuesta;
+    memset(&respuesta, 0, sizeof(respuesta));
+    respuesta.type = RESULTADOS;
+    respuesta.client = package.client;
+    respuesta.id = package.id;
+    respuesta.data.resultados.cantidad = lote->cantidad;
+
+    //! 1. Escoger un ejemplar disponible para cada libro sin tocar la BD (un
+    //! mismo ejemplar no se escoge dos veces si el libro se repite)
+    int elegido[MAX_LOTE];
+    bool completa = !expirado;
+
+    for (int i = 0; i < lote->cantidad; i++)
+    {
+        operacion_t *operacion = &lote->operaciones[i];
+        elegido[i] = SIN_EJEMPLAR;
+
+        clave_t clave;
+        normalizarNombre(operacion->name, &clave);
+
+        // Un nombre mal escrito se corrige igual que en un SOLICITAR suelto
+        if (!expirado && operacion->petition == SOLICITAR)
         {
-            if (ejemplar[i].ISBN == libro.ISBN &&
-                (strcmp(ejemplar[i].name, libro.name) == 0))
-            {
-                encontrado = true;
-            }
+            book_t libro;
+            char sugerencia[TAM_STRING] = "";
+            libro.ISBN = operacion->ISBN;
+            strcpy(libro.name, operacion->name);
+            resolverTitulo(titulos, ejemplar, &libro, &clave, sugerencia);
         }
 
-        respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
-
-        if (!encontrado)
+        for (int j = 0; j < MAX_CANT_LIBROS && elegido[i] == SIN_EJEMPLAR &&
+                        !expirado && operacion->petition == SOLICITAR;
+             j++)
         {
-            fprintf(stderr, "El libro no fue encontrado...\n");
-            if (write(pipeCliente, &respuesta, sizeof(respuesta)) < 0)
-            {
-                perror("Error");
-                return ERROR_SOLICITUD;
-            }
-            return ERROR_SOLICITUD;
+            if (ejemplar[j].ISBN != operacion->ISBN ||
+                !mismaClave(&titulos->claves[j], &clave) ||
+                ejemplar[j].copyInfo.state != 'D')
+                continue;
+
+            bool repetido = false;
+            for (int k = 0; k < i && !repetido; k++)
+                repetido = (elegido[k] == j);
+
+            if (!repetido)
+                elegido[i] = j;
         }
 
-        // Mostrar notificación
-        printf("El libro '%s' fue encontrado\n", libro.name);
+        if (elegido[i] == SIN_EJEMPLAR)
+            completa = false;
+    }
 
-        // 2. Verificar si está //? OCUPADO
-        bool libroActualizado = false;
-        for (int i = 0; i < MAX_CANT_LIBROS; i++)
+    //! 2. Prestar todos o ninguno
+    pid_t prestatario = prestatarioDe(clients, package.client);
+    char buffer[TAM_STRING];
+    for (int i = 0; i < lote->cantidad; i++)
+    {
+        signed char *codigo = &respuesta.data.resultados.codigos[i];
+
+        if (expirado)
+            *codigo = PET_EXPIRADA;
+        else if (elegido[i] == SIN_EJEMPLAR)
+            *codigo = PET_ERROR;
+        else if (!completa)
+            *codigo = PET_ABORTADA;
+        else
         {
-            if (ejemplar[i].ISBN == libro.ISBN &&
-                (strcmp(ejemplar[i].name, libro.name) == 0) &&
-                ejemplar[i].copyInfo.state == 'P' && //? P de PRESTADO
-                ejemplar[i].copyInfo.n_copy == libro.copyInfo.n_copy)
-            {
-                printf("El libro '%s' será actualizado\n", libro.name);
+            *codigo = SOLICITUD;
+            respuesta.data.resultados.ejemplares[i] =
+                (short)ejemplar[elegido[i]].copyInfo.n_copy;
+            prestarEjemplar(&ejemplar[elegido[i]], buffer);
+            ejemplarCambiado(titulos, ejemplar, elegido[i]);
+            registrarPrestamo(prestamos, ejemplar, elegido[i], prestatario);
+        }
+    }
 
-                // 3. Modificar el estado del libro
+    //! 3. Un solo registro por transacción
+    if (completa)
+        printf("Transacción exitosa (%d): %d libros prestados hasta: %s\n",
+               package.client, lote->cantidad, ejemplar[elegido[0]].copyInfo.date);
+    else if (!expirado)
+        fprintf(stderr, "Transacción fallida (%d): no se prestó ningún libro\n",
+                package.client);
 
-                // Actualizar libro
-                // Actualizar su estado
-                libroActualizado = true;
-                ejemplar[i].copyInfo.state = 'D'; //? Se pone disponible
+    if (enviarRespuesta(clients, package.client, &respuesta) != SUCCESS_GENERIC)
+    {
+        perror("Error");
+        return ERROR_COMUNICACION;
+    }
 
-                // Actualizar su fecha //? FECHA ACTUAL (Devolución)
-                char fecha[TAM_STRING];
-                memset(fecha, 0, sizeof(fecha));
+    return (completa || expirado) ? SUCCESS_GENERIC : ERROR_SOLICITUD;
+}
 
-                time_t t;
-                struct tm *tm;
+void *manejadorConexiones(struct arg_conexiones *params)
+{
+    //! 1. Desempaquetar los parámetros
+    struct conexiones_pendientes *conexiones = params->conexiones;
+    struct client_list *clients = params->clients;
 
-                t = time(NULL);
-                tm = localtime(&t);
-                strftime(fecha, TAM_STRING, "%d-%m-%Y", tm);
+    // Conexiones que ya tomó este hilo y esperan que el cliente abra su pipe
+    conexion_t *enEspera = (conexion_t *)malloc(
+        sizeof(conexion_t) * MAX_CONEXIONES_PENDIENTES);
+    int n_espera = 0;
 
-                //? INFORMACION
-                printf("IMPORTANTE: El libro fue devuelto en: %s\n", fecha);
+    if (enEspera == NULL)
+    {
+        perror("Hilo de conexiones");
+        return NULL;
+    }
 
-                strcpy(ejemplar[i].copyInfo.date, fecha);
-                strcpy(buffer, fecha);
-                break;
-            }
-        }
+    struct timespec intervalo = {0, INTERVALO_CONEXION_MS * 1000000L};
 
-        // 4. Avisar al cliente
-        if (!libroActualizado)
-        {
-            respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
-            fprintf(stderr, "El libro no está disponible\n");
-            if (write(pipeCliente, &respuesta, sizeof(respuesta)) < 0)
-            {
-                perror("Error");
-                return ERROR_SOLICITUD;
-            }
-            return ERROR_SOLICITUD;
-        }
+    while (isListening)
+    {
+        //! 2. Esperar conexiones nuevas (sólo se bloquea si no hay en espera)
+        if (n_espera == 0)
+            sem_wait(&conexiones_nuevas);
         else
+            nanosleep(&intervalo, NULL);
+
+        if (!isListening)
+            break;
+
+        //! 3. Tomar las conexiones que recibió el hilo principal
+        sem_wait(&semaforo_conexiones);
+
+        int tomadas = conexiones->n_conexiones;
+        if (tomadas > MAX_CONEXIONES_PENDIENTES - n_espera)
+            tomadas = MAX_CONEXIONES_PENDIENTES - n_espera;
+
+        memcpy(&enEspera[n_espera], conexiones->conexionArray,
+               sizeof(conexion_t) * tomadas);
+        n_espera += tomadas;
+
+        // Las que no cupieron quedan para la próxima vuelta
+        conexiones->n_conexiones -= tomadas;
+        memmove(conexiones->conexionArray, &conexiones->conexionArray[tomadas],
+                sizeof(conexion_t) * conexiones->n_conexiones);
+
+        sem_post(&semaforo_conexiones);
+
+        //! 4. Activar a los clientes cuyo pipe ya está listo
+        for (int i = 0; i < n_espera; i++)
         {
-            // Enviar también la fecha
-            //? Cambiar el tipo de paquete
-            respuesta = generarRespuesta(package.client, DEVOLUCION, buffer);
+            int status = conectarCliente(clients, &enEspera[i]);
 
-            fprintf(stdout, "Solicitud exitosa (%d)\n", package.client);
-            if (write(pipeCliente, &respuesta, sizeof(respuesta)) < 0)
-            {
-                perror("Error");
-                return ERROR_SOLICITUD;
-            }
-            return SUCCESS_GENERIC;
+            if (status == CONEXION_EN_ESPERA &&
+                msDesde(&enEspera[i].llegada) <= TIMEOUT_COMUNICACION * 1000L)
+                continue;
+
+            if (status == CONEXION_EN_ESPERA)
+                fprintf(stderr, "El cliente (%d) nunca abrió su pipe\n",
+                        enEspera[i].clientPID);
+            else if (status != SUCCESS_GENERIC)
+                fprintf(stderr, "SEÑAL: Código de error: %d\n", status);
+
+            // Atendida (o descartada): se reemplaza por la última
+            enEspera[i--] = enEspera[--n_espera];
         }
+
+        // Las confirmaciones (SUCCEED_COM) de esta vuelta se escriben juntas
+        publicarSalida();
     }
-    break;
 
-    case BUSCAR: //! Petición de búsqueda
+    free(enEspera);
+    return NULL;
+}
+
+void *manejadorAnillos(struct arg_anillos *params)
+{
+    //! 1. Desempaquetar los parámetros
+    buffer_t *buffer = params->buffer;
+    struct client_list *clients = params->clients;
+
+    paquet_t lote[LOTE_LECTURA];
+    int inicio = 0;  // Anillo por el que empieza cada vuelta (equidad)
+    int vacias = 0;  // Vueltas seguidas sin peticiones
+    int vueltas = vueltasEsperaActiva();
+
+    while (isListening)
     {
-        // Notificar
-        printf("La petición es de tipo: BUSCAR\n");
+        //! 2. Tomar hasta LOTE_LECTURA peticiones de los anillos
+        int n_paquetes = 0;
 
-        // 1. Buscar el libro
-        book_t libro = package.data.libro;
+        //! Entrando en una región crítica (los segmentos no se desmapean)
+        sem_wait(&semaforo_clientes);
 
-        bool encontrado = false;
-        for (int i = 0; i < MAX_CANT_LIBROS; i++)
+        int n_anillos = clients->n_anillos;
+        for (int i = 0; i < n_anillos && n_paquetes < LOTE_LECTURA; i++)
         {
-            if (ejemplar[i].ISBN == libro.ISBN &&
-                (strcmp(ejemplar[i].name, libro.name) == 0))
-            {
-                encontrado = true;
+            client_t *cliente =
+                &clients->clientArray[clients->anillos[(inicio + i) % n_anillos]];
+
+            // El remitente es el dueño del anillo, no lo que diga el paquete;
+            // un LOTE no puede viajar por el anillo (sería un apuntador ajeno)
+            while (n_paquetes < LOTE_LECTURA &&
+                   anilloLeer(&cliente->shm->peticiones, &lote[n_paquetes]))
+                if (!llevaOperaciones(&lote[n_paquetes]))
+                    lote[n_paquetes++].client = cliente->clientPID;
+        }
 
-                respuesta.type = BOOK;
-                respuesta.client = package.client;
-                respuesta.data.libro = ejemplar[i];
+        if (n_anillos > 0)
+            inicio = (inicio + 1) % n_anillos;
 
-                if (write(pipeCliente, &respuesta, sizeof(respuesta)) < 0)
-                {
-                    perror("Error");
-                    return ERROR_COMUNICACION;
-                }
+        //! Saliendo de la región crítica
+        sem_post(&semaforo_clientes);
 
-                // Mostrar notificación
-                printf("El libro '%s' fue encontrado\n", libro.name);
+        //! 3. Montar las peticiones al buffer (puede bloquear si está lleno)
+        for (int i = 0; i < n_paquetes; i++)
+            queue(buffer, lote[i]);
 
-                return SUCCESS_GENERIC;
-            }
+        if (n_paquetes > 0)
+        {
+            vacias = 0;
+            continue;
+        }
+
+        //! 4. Sin tráfico: espera activa corta y después dormir
+        if (++vacias < vueltas)
+        {
+            pausaCPU();
+            continue;
         }
 
-        respuesta = generarRespuesta(package.client, PET_ERROR, NULL);
-        respuesta.type = ERR;
+        // Marcar todos los anillos antes de revisar por última vez, así un
+        // cliente que escriba después de la revisión toca el timbre
+        bool hayDatos = false;
+        sem_wait(&semaforo_clientes);
 
-        fprintf(stderr, "El libro no fue encontrado...\n");
-        if (write(pipeCliente, &respuesta, sizeof(respuesta)) < 0)
+        for (int i = 0; i < clients->n_anillos; i++)
         {
-            perror("Error");
-            return ERROR_SOLICITUD;
+            anillo_shm_t *anillo =
+                &clients->clientArray[clients->anillos[i]].shm->peticiones;
+            anilloMarcarDormido(anillo);
+            hayDatos = hayDatos || anilloHayDatos(anillo);
         }
-        return ERROR_SOLICITUD;
 
-        // Mostrar notificación
-        fprintf(stderr, "El libro '%s' NO fue encontrado\n", libro.name);
-    }
-    break;
+        sem_post(&semaforo_clientes);
 
-    default:
-        return ERROR_COMUNICACION;
+        if (!hayDatos)
+            sem_wait(&timbreAnillos);
+
+        sem_wait(&semaforo_clientes);
+        for (int i = 0; i < clients->n_anillos; i++)
+            anilloMarcarDespierto(&clients->clientArray[clients->anillos[i]].shm->peticiones);
+        sem_post(&semaforo_clientes);
+
+        vacias = 0;
     }
 
-    return SUCCESS_GENERIC;
+    return NULL;
+}
+
+double segundosCPU(void)
+{
+    struct timespec cpu;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+    return cpu.tv_sec + cpu.tv_nsec / 1e9;
+}
+
+long msDesde(const struct timespec *inicio)
+{
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+
+    return (ahora.tv_sec - inicio->tv_sec) * 1000 +
+           (ahora.tv_nsec - inicio->tv_nsec) / 1000000;
+}
+
+int rechazarExpirada(struct client_list *clients, paquet_t package)
+{
+    // Respuesta sin procesar la petición (no se toca la BD)
+    paquet_t respuesta = generarRespuesta(package.client, PET_EXPIRADA, NULL);
+    respuesta.id = package.id;
+    return enviarRespuesta(clients, package.client, &respuesta);
 }
 
 void *manejadorBuffer(struct arg_buffer *params)
@@ -1161,9 +4296,21 @@ void *manejadorBuffer(struct arg_buffer *params)
     buffer_t *buffer = params->buffer;
     struct client_list *clients = params->clients;
     book_t *booksDatabase = params->booksDatabase;
-
-    // Activar el manejador de señales
-    signal(SIGUSR1, manejadorInterrupcion);
+    indice_prestamos_t *prestamos = params->prestamos;
+    colas_reserva_t *reservas = params->reservas;
+    indice_titulos_t *titulos = params->titulos;
+    cache_busqueda_t *cache = params->cache;
+
+    // Activar el manejador de señales, sin SA_RESTART: sem_wait() en getNext()
+    // debe retornar EINTR (signal() lo activa con _DEFAULT_SOURCE)
+    struct sigaction interrupcion;
+    memset(&interrupcion, 0, sizeof(interrupcion));
+    interrupcion.sa_handler = manejadorInterrupcion;
+    sigemptyset(&interrupcion.sa_mask);
+    sigaction(SIGUSR1, &interrupcion, NULL);
+
+    // Respuestas procesadas desde el último aviso al bucle de eventos
+    int sinPublicar = 0;
 
     // Esto ocurre hasta que el padre detenga al hilo
     while (isListening)
@@ -1171,7 +4318,8 @@ void *manejadorBuffer(struct arg_buffer *params)
 
         //! 2. Obtener el paquete
         //* Si no hay paquete disponibles el hilo se BLOQUEA por un semáforo*/
-        paquet_t *package = getNext(buffer);
+        peticion_buffer_t *peticion = getNext(buffer);
+        paquet_t *package = &peticion->paquete;
 
         if (!isListening)
         {
@@ -1202,10 +4350,39 @@ void *manejadorBuffer(struct arg_buffer *params)
 
         case BOOK: //* Cuando se recibe un LIBRO*/
 
+            // Ya se respondió junto con una búsqueda idéntica
+            if (peticion->atendida)
+            {
+                peticionesAtendidas++;
+                break;
+            }
+
+            // El cliente ya esperó demasiado, no vale la pena procesarla
+            if (msDesde(&peticion->llegada) > LIMITE_ESPERA_MS)
+            {
+                peticionesExpiradas++;
+                fprintf(stderr,
+                        "La petición del cliente (%d) expiró en cola\n",
+                        package->client);
+
+                return_status = rechazarExpirada(clients, *package);
+                if (return_status != SUCCESS_GENERIC)
+                    fprintf(stderr, "LIBRO: Código de error: %d\n", return_status);
+                break;
+            }
+
             //! Entrando en una región crítica (Base de datos)
             sem_wait(&semaforo_bd);
+            liberarCerrados(clients, prestamos, reservas, booksDatabase);
 
-            return_status = manejarLibros(clients, *package, booksDatabase);
+            return_status = manejarLibros(clients, *package, booksDatabase, prestamos,
+                                          reservas, titulos, cache);
+            peticionesAtendidas++;
+
+            // Las búsquedas idénticas que esperan en cola no se vuelven a calcular
+            if (package->data.libro.petition == BUSCAR && return_status == SUCCESS_GENERIC)
+                combinarBusquedas(clients, buffer, *package, booksDatabase, titulos,
+                                  cache);
             if (return_status != SUCCESS_GENERIC)
             {
                 fprintf(stderr,
@@ -1218,6 +4395,74 @@ void *manejadorBuffer(struct arg_buffer *params)
             sem_post(&semaforo_bd);
             break;
 
+        case LOTE: //* Cuando se recibe un LOTE de operaciones*/
+
+            //! Entrando en una región crítica (Base de datos), una sola vez
+            //! por lote
+            sem_wait(&semaforo_bd);
+            liberarCerrados(clients, prestamos, reservas, booksDatabase);
+
+            bool expirado = msDesde(&peticion->llegada) > LIMITE_ESPERA_MS;
+            if (expirado)
+            {
+                peticionesExpiradas++;
+                fprintf(stderr, "El lote del cliente (%d) expiró en cola\n",
+                        package->client);
+            }
+
+            return_status = manejarLote(clients, *package, booksDatabase, prestamos,
+                                        reservas, titulos, expirado);
+            if (!expirado)
+                peticionesAtendidas += package->data.lote->cantidad;
+            if (return_status != SUCCESS_GENERIC)
+            {
+                fprintf(stderr,
+                        "Hubo un problema en el lote del cliente (%d)\n",
+                        package->client);
+                fprintf(stderr, "LOTE: Código de error: %d\n", return_status);
+            }
+
+            //! Saliendo de la región crítica
+            sem_post(&semaforo_bd);
+
+            // Las operaciones se reservaron al decodificar el mensaje
+            liberarPaquete(package);
+            break;
+
+        case TRANSACCION: //* Cuando se reciben varios préstamos (todos o ninguno)*/
+
+            //! Entrando en una región crítica (Base de datos), una sola vez
+            //! por transacción: nadie ve un préstamo a medias
+            sem_wait(&semaforo_bd);
+            liberarCerrados(clients, prestamos, reservas, booksDatabase);
+
+            expirado = msDesde(&peticion->llegada) > LIMITE_ESPERA_MS;
+            if (expirado)
+            {
+                peticionesExpiradas++;
+                fprintf(stderr, "La transacción del cliente (%d) expiró en cola\n",
+                        package->client);
+            }
+
+            return_status = manejarTransaccion(clients, *package, booksDatabase,
+                                               prestamos, titulos, expirado);
+            if (!expirado)
+                peticionesAtendidas++;
+            if (return_status != SUCCESS_GENERIC)
+            {
+                fprintf(stderr,
+                        "Hubo un problema en la transacción del cliente (%d)\n",
+                        package->client);
+                fprintf(stderr, "TRANSACCION: Código de error: %d\n", return_status);
+            }
+
+            //! Saliendo de la región crítica
+            sem_post(&semaforo_bd);
+
+            // Las operaciones se reservaron al decodificar el mensaje
+            liberarPaquete(package);
+            break;
+
         case ERR: //* Cualquier otro caso o error*/
         default:
             fprintf(stderr, "Hubo un problema en la solicitud del cliente (%d)\n",
@@ -1227,6 +4472,14 @@ void *manejadorBuffer(struct arg_buffer *params)
 
         //! 4. Sacar a la petición de la lista
         dequeue(buffer);
+
+        //! 5. Con io_uring, avisar al bucle cuando no quedan peticiones (o cada
+        //! lote) para que escriba todas las respuestas de una vez
+        if (isEmpty(buffer) || ++sinPublicar >= LOTE_LECTURA)
+        {
+            publicarSalida();
+            sinPublicar = 0;
+        }
     }
 
     return NULL; // No hace falta retornar nada
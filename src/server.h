@@ -17,11 +17,81 @@
 #include "common.h"
 #include "paquet.h"
 #include "buffer.h"
+#include "uring.h"
+#include "shm.h"
+#include "formato.h"
+#include "prestamos.h"
+#include "reservas.h"
+#include "titulos.h"
+#include "cache.h"
+#include "catalogo.h"
 
 /* ----------------------------- Definiciones ----------------------------- */
 
+#define LIMITE_ESPERA_MS 2000 /**< Tiempo máximo (ms) de una petición en cola*/
+
+#define MAX_CLIENTES 16384                   /**< Máximo de clientes conectados*/
+#define BITS_TABLA_CLIENTES 15               /**< log2 de las casillas de la tabla hash*/
+#define TAM_TABLA_CLIENTES (1 << BITS_TABLA_CLIENTES) /**< Casillas de la tabla hash (2 * MAX_CLIENTES)*/
+#define CASILLA_VACIA -1                     /**< Casilla sin cliente en la tabla hash*/
+
+#define TAM_COLA_SALIDA 32      /**< Respuestas que pueden esperar por cliente*/
+#define MAX_RESULTADOS_BUSQUEDA 24 /**< Resultados por página de BUSCAR_TODOS (con
+                                        FIN_BUSQUEDA caben en la cola de salida)*/
+#define LIMITE_BLOQUEO_MS 5000  /**< Tiempo máximo (ms) de un pipe sin aceptar escrituras*/
+#define INTERVALO_SALIDA_MS 100 /**< Periodo (ms) con el que se revisan los pipes llenos*/
+
+#define MAX_EVENTOS 256  /**< Eventos de epoll atendidos por cada despertar*/
+#define LOTE_LECTURA 64  /**< Paquetes leídos del pipe (Cliente->Servidor) por read()*/
+#define FD_RESERVADOS 64 /**< Descriptores aparte de los pipes de los clientes*/
+
+/* Identificadores de los descriptores internos dentro de epoll, los pipes de
+   los clientes usan su posición del slab (menor que MAX_CLIENTES) */
+#define EVENTO_PETICIONES (MAX_CLIENTES + 0) /**< Pipe (Cliente->Servidor)*/
+#define EVENTO_SALIDA (MAX_CLIENTES + 1)     /**< eventfd: un pipe se llenó*/
+#define EVENTO_CIERRE (MAX_CLIENTES + 2)     /**< eventfd: detener el servidor*/
+#define EVENTO_SOCKET (MAX_CLIENTES + 3)     /**< Socket Unix de escucha*/
+#define EVENTO_TCP (MAX_CLIENTES + 4)        /**< Socket TCP de escucha*/
+
+#define COLA_SOCKET 128 /**< Conexiones del socket Unix que esperan accept()*/
+
+#define MAX_CLIENTES_TCP 1024 /**< Conexiones TCP simultáneas (el resto se rechaza)*/
+#define ID_BASE_TCP (1 << 22) /**< Identificadores de los clientes TCP (mayores que cualquier PID)*/
+
+#define MAX_CONEXIONES_PENDIENTES 1024 /**< Conexiones que pueden esperar su pipe*/
+#define INTERVALO_CONEXION_MS 1        /**< Periodo (ms) para reintentar abrir los pipes*/
+#define CONEXION_EN_ESPERA 1           /**< El cliente aún no abre su pipe para lectura*/
+
+#define BACKEND_EPOLL 0 /**< Bucle de eventos con epoll y read()/write()*/
+#define BACKEND_URING 1 /**< Bucle de eventos con io_uring (epoll si no se puede)*/
+
+#define TAM_URING 256        /**< Entradas del SQ de io_uring*/
+#define BUFFERS_URING 16     /**< Buffers provistos para la lectura multishot*/
+#define GRUPO_PETICIONES 0   /**< Grupo de los buffers provistos*/
+#define MAX_LECTURAS_URING (BUFFERS_URING + 2) /**< Lecturas completadas por atender*/
+
+/* Tipo de operación dentro del user_data de io_uring (32 bits altos) */
+#define DATO_LECTURA 1   /**< Lectura del pipe (Cliente->Servidor)*/
+#define DATO_EPOLL 2     /**< Poll multishot sobre el epoll del servidor*/
+#define DATO_TIMEOUT 3   /**< Temporizador para revisar pipes llenos*/
+#define DATO_ESCRITURA 4 /**< Escritura de una respuesta (32 bits bajos: casilla del lote)*/
+
 /* ------------------------------ Estructuras ------------------------------ */
 
+/**
+ * @struct cola_salida_t
+ * @brief Respuestas que no se pudieron escribir porque el pipe (Servidor->Cliente)
+ * estaba lleno, se escriben en orden cuando el pipe vuelve a aceptar escrituras
+ */
+typedef struct
+{
+    paquet_t *paquetes;             /**< Cola circular (NULL hasta que se necesita)*/
+    int inicio;                     /**< Posición de la próxima respuesta a escribir*/
+    int cantidad;                   /**< Respuestas en cola*/
+    int enviados;                   /**< Bytes ya escritos de la primera (sólo TCP)*/
+    struct timespec bloqueadoDesde; /**< Desde cuándo el pipe no acepta escrituras*/
+} cola_salida_t;
+
 /**
  * @struct client_t
  * @brief Estructura con la información de un clinete
@@ -29,21 +99,152 @@
  */
 typedef struct
 {
-    int pipe;                      /**< File descriptor del pipe (Servidor->Cliente) asociado*/
+    int pipe;                      /**< File descriptor del pipe (Servidor->Cliente) asociado
+                                        (con memoria compartida, un pidfd del cliente;
+                                        con socket Unix o TCP, el socket en ambos sentidos)*/
+    pid_t clientPID;               /**< PID del cliente (TCP: identificador asignado)*/
+    char pipeFilename[TAM_STRING]; /**< Nombre del pipe (Servidor->Cliente) o dirección TCP*/
+
+    cola_salida_t salida; /**< Respuestas pendientes por escribir*/
+    int pendiente;        /**< Posición en la lista de pendientes (-1 si no está)*/
+
+    int transporte;      /**< TRANSPORTE_FIFO, TRANSPORTE_SHM, TRANSPORTE_UNIX o TRANSPORTE_TCP*/
+    segmento_shm_t *shm; /**< Segmento con los anillos (sólo TRANSPORTE_SHM)*/
+    int anillo;          /**< Posición en la lista de anillos (-1 si no está)*/
+    int formato;         /**< FORMATO_CLASICO o FORMATO_COMPACTO (negociado en START_COM)*/
+
+    int lector;       /**< Número de lector (señal LECTOR) o SIN_LECTOR*/
+    bool porLiberar;  /**< Pidió algo a la BD: al cerrarlo se liberan sus préstamos con
+                           su PID y sus reservas*/
+
+} client_t;
+
+/**
+ * @struct conexion_t
+ * @brief Cliente que envió START_COM pero cuyo pipe (Servidor->Cliente) aún no
+ * está listo, no recibe peticiones hasta que se activa
+ */
+typedef struct
+{
     pid_t clientPID;               /**< PID del cliente*/
     char pipeFilename[TAM_STRING]; /**< Nombre del pipe (Servidor->Cliente)*/
+    struct timespec llegada;       /**< Momento en que se recibió START_COM*/
+    int transporte;                /**< TRANSPORTE_FIFO (START_COM) o TRANSPORTE_SHM (START_SHM)*/
+    int formato;                   /**< Formato de las respuestas que aceptó el servidor*/
+} conexion_t;
 
-} client_t;
+/**
+ * @struct conexiones_pendientes
+ * @brief Conexiones recibidas por el hilo principal que aún no toma el hilo
+ * de conexiones
+ */
+struct conexiones_pendientes
+{
+    int n_conexiones;                                    /**< Conexiones en el arreglo*/
+    conexion_t conexionArray[MAX_CONEXIONES_PENDIENTES]; /**< Conexiones por atender*/
+};
 
 /**
  * @struct client_list
- * @brief Arreglo dinámico de clientes conectados
+ * @brief Tabla de clientes conectados (PID -> cliente)
  * 
+ * Los clientes se guardan en un slab de \ref MAX_CLIENTES posiciones que se
+ * reserva una única vez, las posiciones libres se mantienen en una pila. La
+ * tabla hash (direccionamiento abierto, sondeo lineal) guarda la posición de
+ * cada cliente en el slab, así buscar, guardar y remover son O(1) sin realloc
  */
 struct client_list
 {
-    int n_clients;         /**< Número de clientes en el arreglo*/
-    client_t *clientArray; /**< Arreglo de clientes conectados*/
+    int n_clients;         /**< Número de clientes conectados*/
+    client_t *clientArray; /**< Slab con los clientes*/
+    int *libres;           /**< Pila de posiciones libres del slab*/
+    int n_libres;          /**< Cantidad de posiciones libres*/
+    int *tabla;            /**< Tabla hash con posiciones del slab o CASILLA_VACIA*/
+    int *pendientes;       /**< Posiciones del slab con respuestas en cola*/
+    int n_pendientes;      /**< Cantidad de clientes con respuestas en cola*/
+    int *anillos;          /**< Posiciones del slab de los clientes por memoria compartida*/
+    int n_anillos;         /**< Cantidad de clientes por memoria compartida*/
+    pid_t *cerrados;       /**< Clientes cerrados cuyos préstamos aún no se liberan*/
+    int n_cerrados;        /**< Cantidad de clientes cerrados por liberar*/
+};
+
+/**
+ * @struct opciones_servidor
+ * @brief Argumentos opcionales del servidor
+ */
+struct opciones_servidor
+{
+    int backend;                   /**< BACKEND_EPOLL o BACKEND_URING*/
+    char socketNom[TAM_STRING];    /**< Ruta del socket Unix (vacía si no se usa)*/
+    char direccionTCP[TAM_STRING]; /**< [host:]puerto de escucha TCP (vacía si no se usa)*/
+};
+
+/**
+ * @struct entrada_t
+ * @brief Mensaje incompleto de un flujo (trama TCP o el pipe compartido con
+ * mensajes de longitud variable), un read() puede traer medio mensaje o varios
+ */
+typedef struct
+{
+    unsigned char datos[TAM_TRAMA_TCP]; /**< Bytes del mensaje (con TCP, longitud + mensaje)*/
+    int n_datos;                        /**< Bytes recibidos del mensaje actual*/
+} entrada_t;
+
+/**
+ * @struct bucle_eventos
+ * @brief Recursos que atiende el bucle de eventos del hilo principal
+ */
+struct bucle_eventos
+{
+    int readPipe;                             /**< Pipe (Cliente->Servidor)*/
+    int socketEscucha;                        /**< Socket Unix de escucha (-1 si no se usa)*/
+    int socketTCP;                            /**< Socket TCP de escucha (-1 si no se usa)*/
+    entrada_t **entradas;                     /**< Trama incompleta por posición del slab
+                                                   (TCP, sólo la usa el bucle)*/
+    entrada_t entradaPipe;                    /**< Mensaje incompleto del pipe (Cliente->Servidor)*/
+    buffer_t *buffer;                         /**< Buffer interno*/
+    struct conexiones_pendientes *conexiones; /**< Conexiones para el hilo de conexiones*/
+    struct client_list *clients;              /**< Lista de clientes*/
+};
+
+/**
+ * @struct escritura_uring
+ * @brief Respuestas de un cliente enviadas en un mismo lote de io_uring
+ */
+struct escritura_uring
+{
+    int posicion; /**< Posición del cliente en el slab*/
+    int fd;       /**< Pipe al que se escribió*/
+    int exitos;   /**< Respuestas escritas completas*/
+    bool error;   /**< El pipe falló (no EAGAIN)*/
+};
+
+/**
+ * @struct bucle_uring
+ * @brief Estado del bucle de eventos con io_uring
+ */
+struct bucle_uring
+{
+    uring_t ring;                /**< Anillos de io_uring*/
+    uring_buffers_t buffers;     /**< Buffers provistos (lectura multishot)*/
+    bool multishot;              /**< El kernel soporta IORING_OP_READ_MULTISHOT*/
+    paquet_t lote[LOTE_LECTURA]; /**< Destino de la lectura simple (sin multishot)*/
+
+    bool armarLectura;  /**< Hay que (re)enviar la lectura del pipe*/
+    bool armarEpoll;    /**< Hay que (re)enviar el poll sobre el epoll*/
+    bool revisarEpoll;  /**< El epoll tiene eventos por atender*/
+    bool temporizador;  /**< Hay un IORING_OP_TIMEOUT en vuelo*/
+
+    struct io_uring_cqe lecturas[MAX_LECTURAS_URING]; /**< Lecturas por atender*/
+    int n_lecturas;                                   /**< Cantidad de lecturas*/
+
+    struct escritura_uring escrituras[TAM_URING]; /**< Clientes del lote actual*/
+    unsigned char mensajes[TAM_URING][sizeof(paquet_t)]; /**< Respuestas del lote en el
+                                                              formato de cada cliente
+                                                              (ninguna supera un paquet_t)*/
+    int *posiciones;                              /**< Copia de los pendientes*/
+    unsigned long lotes;                          /**< Lotes de escrituras enviados*/
+    unsigned long respuestas;                     /**< Respuestas escritas en lote*/
 };
 
 /* ------------------------ Prototipos de funciones ------------------------ */
@@ -70,13 +271,15 @@ void mostrarUso(void);
  * @param pipeFilename RETORNA: nombre del pipe
  * @param fileIn RETORNA: Nombre del archivo de entrada
  * @param fileOut RETORNA: Nombre del archivo de salida
+ * @param opciones RETORNA: argumentos opcionales
  */
 static void manejarArgumentos(
     int argc,
     char *argv[],
     char *pipeNom,
     char *fileIn,
-    char *fileOut);
+    char *fileOut,
+    struct opciones_servidor *opciones);
 
 /**
  * @brief Manejar una señal
@@ -90,53 +293,88 @@ void manejadorInterrupcion(int foo);
  * @brief Abrir el archivo de BD y almacenar todos los libros
  * 
  * @param booksDatabase Arreglo con todos los libros
+ * @param prestamos RETORNA: índice con los préstamos que tienen prestatario
+ * (cuarto campo opcional de cada ejemplar)
  * @param filename Nombre del archivo a leer
  * @return Cantidad de libros que se leyeron en total
  * 
  * @note El archivo se abre y se cierra en la misma función pues no tiene porqué
  * ser utilizado más adelante en el programa
  */
-int leerDatabase(book_t booksDatabase[], const char filename[]);
+int leerDatabase(book_t booksDatabase[],
+                 indice_prestamos_t *prestamos,
+                 const char filename[]);
 
 /**
  * @brief Actualizar la información de la base de datos
  * 
  * @param filename Archivo a escribir
  * @param booksDatabase Arreglo de base de datos
+ * @param prestamos Índice de préstamos (se guarda el prestatario conocido)
  * @param tam_database Tamaño de la base de datos
  * @return Return error
  */
 int actualizarDatabase(const char filename[],
                        book_t booksDatabase[],
+                       indice_prestamos_t *prestamos,
                        int tam_database);
 
 /**
  * @brief Mostrar la database en pantalla como alternativa
  * 
  * @param booksDatabase Arreglo de base de datos
+ * @param prestamos Índice de préstamos
  * @param tam_database Tamaño de la base de datos
  */
-void mostrarDatabasePantalla(book_t booksDatabase[], int tam_database);
+void mostrarDatabasePantalla(book_t booksDatabase[],
+                             indice_prestamos_t *prestamos,
+                             int tam_database);
 
 /* ----------------------- Protocolos de comunicación ----------------------- */
 
 /**
  * @brief Iniciar la comunicación, permitir a los cliente conectarse
  * Descripción del proceso en README.md
+ * @note El servidor mantiene su propio extremo de escritura para que read()
+ * nunca retorne 0 (EOF) cuando no hay clientes y se bloquee en su lugar
  * 
  * @param pipeCLNT_SRVR Nombre del pipe (Cliente->Servidor)
+ * @param pipeEscritura RETORNA: fd de escritura propio del servidor
  * @return fd del Pipe (Cliente-Servidor)
  */
-static int iniciarComunicacion(const char *pipeCLNT_SRVR);
+static int iniciarComunicacion(const char *pipeCLNT_SRVR, int *pipeEscritura);
 
 /**
- * @brief Conectar un cliente a la lista
+ * @brief Entregar un START_COM al hilo de conexiones, el hilo principal no
+ * espera a que el pipe del cliente esté listo
  * 
- * @param clients Apuntador a la lista de clientes
- * @param package Copia del paquete recibido por el pipe
+ * @param conexiones Conexiones pendientes
+ * @param package Paquete con la señal START_COM
  * @return int Exit error code or SUCCESS_GENERIC
  */
-int conectarCliente(struct client_list *clients, paquet_t package);
+int encolarConexion(struct conexiones_pendientes *conexiones, paquet_t package);
+
+/**
+ * @brief Intentar conectar un cliente a la lista, el pipe (Servidor->Cliente)
+ * se abre sin bloquear
+ * 
+ * @param clients Apuntador a la lista de clientes
+ * @param conexion Conexión pendiente
+ * @return int SUCCESS_GENERIC, CONEXION_EN_ESPERA si el cliente aún no abre
+ * su pipe o el código de error
+ */
+int conectarCliente(struct client_list *clients, conexion_t *conexion);
+
+/**
+ * @brief Mapear el segmento compartido de un cliente (START_SHM), el nombre se
+ * deriva del PID y no del paquete
+ * 
+ * @param conexion Conexión pendiente
+ * @param shm RETORNA: segmento mapeado
+ * @return int pidfd del cliente (para saber si termina), CONEXION_EN_ESPERA si
+ * el segmento aún no está listo o el código de error (negativo)
+ */
+int abrirSegmento(conexion_t *conexion, segmento_shm_t **shm);
 
 /**
  * @brief Desconectar un cliente de la lista
@@ -155,6 +393,17 @@ int retirarCliente(struct client_list *clients, paquet_t package);
  */
 int interpretarSenal(struct client_list *clients, paquet_t package);
 
+/**
+ * @brief Señal LECTOR: los préstamos del cliente quedan a nombre de su número
+ * de lector, así los recupera en otra conexión y después de reiniciar
+ * @note No tiene respuesta; llega antes que sus peticiones por la misma cola
+ *
+ * @param clients Apuntador a la lista de clientes
+ * @param package Paquete con la señal (buffer: número de lector)
+ * @return int SUCCESS_GENERIC o ERROR_SOLICITUD si el número no es válido
+ */
+int identificarLector(struct client_list *clients, paquet_t package);
+
 /**
  * @brief Generar una señal como respuesta a un Cliente
  * 
@@ -165,6 +414,17 @@ int interpretarSenal(struct client_list *clients, paquet_t package);
  */
 paquet_t generarRespuesta(pid_t dest, int code, char *buffer);
 
+/**
+ * @brief START_COM por socket: acordar el formato de los mensajes y
+ * confirmar con SUCCEED_COM (con la versión aceptada, 0 si es el clásico)
+ * 
+ * @param clients Lista con los clientes
+ * @param client Identificador del cliente
+ * @param version Versión del formato compacto que propone el cliente
+ * @return int Resultado de \ref enviarRespuesta
+ */
+int negociarFormato(struct client_list *clients, pid_t client, int version);
+
 /* --------------------------- Manejo de clientes --------------------------- */
 
 /**
@@ -177,6 +437,38 @@ paquet_t generarRespuesta(pid_t dest, int code, char *buffer);
  */
 client_t crearCliente(int pipefd, pid_t clientpid, char *pipenom);
 
+/**
+ * @brief Reservar la tabla de clientes vacía
+ * 
+ * @param clients Apuntador a la tabla de clientes
+ * @return SUCCESS_GENERIC si éxito, ERROR_MEMORY de lo contrario
+ */
+int iniciarClientes(struct client_list *clients);
+
+/**
+ * @brief Liberar la memoria de la tabla de clientes
+ * 
+ * @param clients Apuntador a la tabla de clientes
+ */
+void liberarClientes(struct client_list *clients);
+
+/**
+ * @brief Casilla inicial de un PID en la tabla hash
+ * 
+ * @param client PID del cliente
+ * @return int Casilla en [0, TAM_TABLA_CLIENTES)
+ */
+int hashCliente(pid_t client);
+
+/**
+ * @brief Buscar la casilla de la tabla hash que contiene a un cliente
+ * 
+ * @param clients Apuntador a la tabla de clientes
+ * @param client PID del cliente
+ * @return int Casilla de la tabla o CASILLA_VACIA si no existe
+ */
+int casillaCliente(struct client_list *clients, pid_t client);
+
 /**
  * @brief Guardar un cliente en el arreglo
  * 
@@ -204,18 +496,724 @@ int removerCliente(struct client_list *clients, pid_t clientToRemove);
  */
 int buscarCliente(struct client_list *clients, pid_t client);
 
+/**
+ * @brief Obtener la posición de un cliente en el slab dado su PID
+ * 
+ * @param clients Lista con los clientes
+ * @param client PID del cliente
+ * @return client_t* Cliente dentro del slab (NULL si no existe)
+ */
+client_t *obtenerCliente(struct client_list *clients, pid_t client);
+
+/* ----------------------- Manejo de la salida (Pipes) ----------------------- */
+
+/**
+ * @brief Enviar una respuesta a un cliente sin bloquear el hilo que la envía,
+ * si el pipe está lleno la respuesta queda en la cola de salida del cliente
+ * @note Si el pipe se cerró o la cola está llena el cliente se desconecta
+ * @note Con io_uring la respuesta siempre se encola, el bucle de eventos la
+ * escribe en lote después de \ref publicarSalida
+ * 
+ * @param clients Lista con los clientes
+ * @param client PID del cliente destino
+ * @param respuesta Paquete a enviar
+ * @return SUCCESS_GENERIC si se escribió o encoló, cualquier otro valor de lo contrario
+ */
+int enviarRespuesta(struct client_list *clients, pid_t client, paquet_t *respuesta);
+
+/**
+ * @brief Enviar una respuesta guardada en la caché: si el cliente usa un pipe
+ * o un socket Unix y no tiene respuestas en cola, el mensaje ya escrito sale
+ * con un solo write (sólo cambian el cliente y el id); si no, se envía como
+ * cualquier respuesta
+ *
+ * @param clients Lista con los clientes
+ * @param client PID del cliente destino
+ * @param id Identificador de la petición
+ * @param entrada Respuesta guardada
+ * @return SUCCESS_GENERIC si se escribió o encoló, cualquier otro valor de lo contrario
+ */
+int enviarCache(struct client_list *clients,
+                pid_t client,
+                uint32_t id,
+                respuesta_cache_t *entrada);
+
+/**
+ * @brief Escribir en orden las respuestas en cola hasta que el pipe se llene
+ * @note Se debe tener el semáforo de salida
+ * 
+ * @param clients Lista con los clientes
+ * @param cliente Cliente con respuestas en cola
+ * @return SUCCESS_GENERIC si éxito, ERROR_PIPE_SRVR_CLNT si el pipe falló
+ */
+int vaciarSalida(struct client_list *clients, client_t *cliente);
+
+/**
+ * @brief Retirar de la cola las respuestas que ya se escribieron
+ * @note Se debe tener el semáforo de salida
+ * 
+ * @param clients Lista con los clientes
+ * @param cliente Cliente con respuestas en cola
+ * @param escritas Respuestas escritas (desde el inicio de la cola)
+ */
+void avanzarSalida(struct client_list *clients, client_t *cliente, int escritas);
+
+/**
+ * @brief Avisar al bucle de eventos que hay respuestas encoladas por escribir
+ * (sólo con io_uring, un único aviso por lote de respuestas)
+ */
+void publicarSalida(void);
+
+/**
+ * @brief Cerrar el pipe de un cliente y retirarlo de la tabla, descartando sus
+ * respuestas en cola
+ * @note Se debe tener el semáforo de salida
+ * 
+ * @param clients Lista con los clientes
+ * @param cliente Cliente a cerrar
+ */
+void cerrarCliente(struct client_list *clients, client_t *cliente);
+
+/**
+ * @brief Desconectar un cliente dado su PID (toma el semáforo de salida)
+ * 
+ * @param clients Lista con los clientes
+ * @param client PID del cliente
+ * @return SUCCESS_GENERIC si éxito, ERROR_PID_NOT_EXIST si no existe
+ */
+int desconectarCliente(struct client_list *clients, pid_t client);
+
+/* ----------------------- Memoria compartida (Anillos) ----------------------- */
+
+/**
+ * @brief Agregar un cliente por memoria compartida a la lista que recorre el
+ * hilo de anillos y despertarlo
+ * 
+ * @param clients Lista con los clientes
+ * @param cliente Cliente ya guardado
+ */
+void agregarAnillo(struct client_list *clients, client_t *cliente);
+
+/**
+ * @brief Sacar a un cliente de la lista de anillos, después de esto el hilo de
+ * anillos ya no toca su segmento
+ * 
+ * @param clients Lista con los clientes
+ * @param cliente Cliente por memoria compartida
+ */
+void quitarAnillo(struct client_list *clients, client_t *cliente);
+
+/**
+ * @brief Despertar al hilo de anillos (TIMBRE_SHM o un anillo nuevo)
+ */
+void despertarAnillos(void);
+
+/**
+ * @brief Atender un evento de epoll sobre el pipe de un cliente: escribir su
+ * cola si el pipe acepta escrituras o desconectarlo si el cliente cerró
+ * su extremo de lectura
+ * @note Se debe tener el semáforo de salida
+ * 
+ * @param clients Lista con los clientes
+ * @param posicion Posición del cliente en el slab
+ * @param fd Descriptor registrado en epoll (descarta eventos viejos)
+ * @param eventos Máscara de eventos de epoll
+ */
+void atenderSalida(struct client_list *clients, int posicion, int fd, uint32_t eventos);
+
+/**
+ * @brief Atender la parte de entrada de un evento sobre el descriptor de un
+ * cliente (sin el semáforo de salida, la lectura puede bloquear en el buffer):
+ * leer las peticiones de un socket o notar que terminó el dueño de un pidfd
+ * 
+ * @param bucle Recursos del bucle
+ * @param posicion Posición del cliente en el slab
+ * @param fd Descriptor registrado en epoll (descarta eventos viejos)
+ * @param eventos Máscara de eventos de epoll
+ * @return uint32_t Eventos que quedan para \ref atenderSalida (EPOLLHUP si el
+ * cliente se fue)
+ */
+uint32_t atenderEntrada(struct bucle_eventos *bucle, int posicion, int fd, uint32_t eventos);
+
+/**
+ * @brief Desconectar a los clientes cuyo pipe no acepta escrituras durante más
+ * de \ref LIMITE_BLOQUEO_MS
+ * 
+ * @param clients Lista con los clientes
+ */
+void revisarBloqueados(struct client_list *clients);
+
+/* ------------------------- Bucle de eventos (epoll) ------------------------- */
+
+/**
+ * @brief Identificador de un descriptor dentro de epoll
+ * 
+ * @param posicion Posición en el slab o EVENTO_*
+ * @param fd Descriptor registrado
+ * @return uint64_t Valor para epoll_event.data.u64
+ */
+uint64_t tokenEvento(int posicion, int fd);
+
+/**
+ * @brief Registrar un descriptor en el epoll del servidor
+ * 
+ * @param fd Descriptor a vigilar
+ * @param posicion Posición en el slab o EVENTO_*
+ * @param eventos Máscara de eventos de epoll
+ * @return SUCCESS_GENERIC si éxito, FAILURE_GENERIC de lo contrario
+ */
+int registrarEvento(int fd, int posicion, uint32_t eventos);
+
+/**
+ * @brief Leer las peticiones disponibles en el pipe (Cliente->Servidor), un
+ * read() trae hasta \ref LOTE_LECTURA paquetes clásicos (más si son compactos)
+ * 
+ * @param bucle Recursos del bucle
+ * @return int Cantidad de paquetes leídos
+ */
+int leerPeticiones(struct bucle_eventos *bucle);
+
+/**
+ * @brief Decodificar los mensajes de un pedazo del pipe (Cliente->Servidor) y
+ * despacharlos, el mensaje que quede incompleto se guarda para el próximo
+ * 
+ * @param bucle Recursos del bucle
+ * @param datos Bytes leídos del pipe
+ * @param n Cantidad de bytes
+ * @return int Cantidad de paquetes despachados
+ */
+int despacharBytes(struct bucle_eventos *bucle, const unsigned char *datos, int n);
+
+/**
+ * @brief Repartir un lote de paquetes leídos: START_COM va al hilo de
+ * conexiones y el resto al buffer interno
+ * 
+ * @param lote Paquetes completos
+ * @param n_paquetes Cantidad de paquetes
+ * @param buffer Buffer interno
+ * @param conexiones Conexiones pendientes
+ */
+void despacharPeticiones(paquet_t *lote,
+                         int n_paquetes,
+                         buffer_t *buffer,
+                         struct conexiones_pendientes *conexiones);
+
+/* ------------------------------- Socket Unix ------------------------------- */
+
+/**
+ * @brief Crear el socket Unix (SOCK_SEQPACKET) de escucha
+ * 
+ * @param nombre Ruta del socket (se reemplaza si existe)
+ * @return int Socket en modo O_NONBLOCK o -1 si falló (errno)
+ */
+int abrirSocket(const char *nombre);
+
+/**
+ * @brief Aceptar todas las conexiones en espera, sin START_COM: por socket Unix
+ * el cliente queda con el PID que reporta el kernel (SO_PEERCRED), por TCP con
+ * un identificador nuevo y se le confirma con SUCCEED_COM (FAILED_COM si ya
+ * hay \ref MAX_CLIENTES_TCP)
+ * 
+ * @param bucle Recursos del bucle
+ * @param escucha Socket de escucha
+ * @param transporte TRANSPORTE_UNIX o TRANSPORTE_TCP
+ */
+void aceptarClientes(struct bucle_eventos *bucle, int escucha, int transporte);
+
+/**
+ * @brief Pasar al buffer interno un paquete recibido por socket, el remitente
+ * es el dueño del socket y las señales de conexión se descartan
+ * 
+ * @param bucle Recursos del bucle
+ * @param paquete Paquete recibido
+ * @param cliente PID (o identificador TCP) del dueño del socket
+ */
+void encolarDeSocket(struct bucle_eventos *bucle, paquet_t *paquete, pid_t cliente);
+
+/**
+ * @brief Leer todas las peticiones de un cliente por socket, un mensaje por
+ * paquete, el remitente es el dueño del socket
+ * 
+ * @param bucle Recursos del bucle
+ * @param fd Socket del cliente
+ * @param cliente PID del cliente
+ * @return SUCCESS_GENERIC o ERROR_PIPE_CLNT_SRVR si el cliente cerró
+ */
+int leerSocket(struct bucle_eventos *bucle, int fd, pid_t cliente);
+
+/* ---------------------------------- TCP ---------------------------------- */
+
+/**
+ * @brief Crear el socket TCP de escucha
+ * 
+ * @param direccion "[host:]puerto", sin host escucha en todas las interfaces
+ * @return int Socket en modo O_NONBLOCK o -1 si falló
+ */
+int abrirTCP(const char *direccion);
+
+/**
+ * @brief Leer todas las tramas disponibles de un cliente TCP, las tramas
+ * incompletas se guardan hasta el próximo evento
+ * 
+ * @param bucle Recursos del bucle
+ * @param posicion Posición del cliente en el slab
+ * @param fd Socket del cliente
+ * @param cliente Identificador del cliente
+ * @return SUCCESS_GENERIC o ERROR_PIPE_CLNT_SRVR si el cliente cerró o envió
+ * una trama inválida
+ */
+int leerTCP(struct bucle_eventos *bucle, int posicion, int fd, pid_t cliente);
+
+/**
+ * @brief Escribir un paquete en el formato (clásico o compacto) y con el
+ * transporte del cliente, con TCP la trama puede quedar a medias y se
+ * continúa en la próxima llamada
+ * 
+ * @param cliente Cliente destino
+ * @param paquete Paquete a escribir
+ * @param enviados Bytes ya escritos de la trama (TCP), se actualiza
+ * @return int 1 si se escribió completo, 0 si el descriptor está lleno, -1 si
+ * falló
+ */
+int escribirPaquete(client_t *cliente, paquet_t *paquete, int *enviados);
+
+/**
+ * @brief Bucle de eventos con epoll, read() y write()
+ * 
+ * @param bucle Recursos del bucle
+ * @return SUCCESS_GENERIC al detenerse, FAILURE_GENERIC si no pudo iniciar
+ */
+int bucleEpoll(struct bucle_eventos *bucle);
+
+/* ------------------------ Bucle de eventos (io_uring) ------------------------ */
+
+/**
+ * @brief Identificador de una operación de io_uring
+ * 
+ * @param tipo DATO_*
+ * @param posicion Dato adicional (casilla del lote de escrituras)
+ * @return uint64_t Valor para user_data
+ */
+uint64_t tokenUring(int tipo, int posicion);
+
+/**
+ * @brief Bucle de eventos con io_uring: lectura multishot del pipe
+ * (Cliente->Servidor), poll multishot sobre el epoll (pipes de los clientes y
+ * eventfd) y escritura de las respuestas en lotes con un solo io_uring_enter
+ * 
+ * @param bucle Recursos del bucle
+ * @return SUCCESS_GENERIC al detenerse, FAILURE_GENERIC si el kernel no
+ * permite io_uring (no se alcanzó a atender nada)
+ */
+int bucleUring(struct bucle_eventos *bucle);
+
+/**
+ * @brief Enviar al kernel las operaciones que se deben (re)armar: lectura,
+ * poll y temporizador
+ * 
+ * @param estado Estado del bucle
+ * @param bucle Recursos del bucle
+ */
+void armarUring(struct bucle_uring *estado, struct bucle_eventos *bucle);
+
+/**
+ * @brief Atender una completación que no es escritura, las lecturas se guardan
+ * para procesarlas sin el semáforo de salida
+ * 
+ * @param estado Estado del bucle
+ * @param cqe Completación
+ */
+void atenderCompletacion(struct bucle_uring *estado, struct io_uring_cqe *cqe);
+
+/**
+ * @brief Procesar las lecturas completadas y devolver sus buffers al kernel
+ * 
+ * @param estado Estado del bucle
+ * @param bucle Recursos del bucle
+ */
+void procesarLecturas(struct bucle_uring *estado, struct bucle_eventos *bucle);
+
+/**
+ * @brief Escribir las colas de salida de todos los clientes pendientes, una
+ * cadena enlazada (IOSQE_IO_LINK) de escrituras por cliente y un solo
+ * io_uring_enter por lote
+ * @note Se debe tener el semáforo de salida
+ * 
+ * @param estado Estado del bucle
+ * @param clients Lista con los clientes
+ */
+void escribirSalidas(struct bucle_uring *estado, struct client_list *clients);
+
+/**
+ * @brief Enviar un lote de escrituras y esperar todas sus completaciones
+ * @note Se debe tener el semáforo de salida
+ * 
+ * @param estado Estado del bucle
+ * @param clients Lista con los clientes
+ * @param n_clientes Clientes en el lote
+ * @param n_escrituras Escrituras en el lote
+ */
+void completarEscrituras(struct bucle_uring *estado,
+                         struct client_list *clients,
+                         int n_clientes,
+                         int n_escrituras);
+
+/**
+ * @brief Subir el límite de descriptores abiertos (RLIMIT_NOFILE) para que
+ * quepan los pipes de \ref MAX_CLIENTES clientes
+ */
+void aumentarLimiteArchivos(void);
+
 /**
  * @brief Manejar una solicitud de libro
  * 
  * @param clients Lista de los clientes
  * @param package Paquete recibido
  * @param ejemplar Arreglo con los libros de la BD
+ * @param prestamos Índice de préstamos de la BD
+ * @param reservas Colas de reserva de la BD (una devolución se entrega al
+ * primero que espera el título)
+ * @param titulos Índice de títulos de la BD
+ * @param cache Caché de respuestas BUSCAR
  * @return SUCCESS_GENERIC si éxito, cualquier otro valor de lo contrario
  */
 int manejarLibros(
     struct client_list *clients,
     paquet_t package,
-    book_t ejemplar[]);
+    book_t ejemplar[],
+    indice_prestamos_t *prestamos,
+    colas_reserva_t *reservas,
+    indice_titulos_t *titulos,
+    cache_busqueda_t *cache);
+
+/**
+ * @brief Responder BUSCAR con la respuesta guardada del título si sigue
+ * vigente; si no, se arma como siempre (\ref atenderLibro) y se guarda
+ *
+ * @param clients Lista de los clientes
+ * @param package Paquete con la petición BUSCAR
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param prestamos Índice de préstamos de la BD
+ * @param reservas Colas de reserva de la BD
+ * @param titulos Índice de títulos de la BD
+ * @param cache Caché de respuestas BUSCAR
+ * @return SUCCESS_GENERIC si éxito, cualquier otro valor de lo contrario
+ */
+int responderBusqueda(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_prestamos_t *prestamos,
+    colas_reserva_t *reservas,
+    indice_titulos_t *titulos,
+    cache_busqueda_t *cache);
+
+/**
+ * @brief Después de responder un BUSCAR, responder con la misma respuesta las
+ * búsquedas idénticas (mismo ISBN y misma clave del nombre) que esperan en la
+ * cola; quedan marcadas como atendidas y el hilo auxiliar sólo las retira
+ * @note Sólo se combinan las búsquedas cuya respuesta está en la caché, las
+ * que ya están en el buffer (a lo sumo BUFFER_SIZE - 1 detrás de la actual) y
+ * que llegaron antes de la primera petición que cambia el libro (\ref cambiaLibro)
+ *
+ * @param clients Lista de los clientes
+ * @param buffer Cola de peticiones (la actual es package)
+ * @param package Paquete con la petición BUSCAR que se acaba de responder
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param titulos Índice de títulos de la BD
+ * @param cache Caché de respuestas BUSCAR
+ * @return int Peticiones de la cola que se respondieron
+ */
+int combinarBusquedas(
+    struct client_list *clients,
+    buffer_t *buffer,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_titulos_t *titulos,
+    cache_busqueda_t *cache);
+
+/**
+ * @brief Resolver una solicitud de libro sobre la BD sin enviar la respuesta
+ * (la comparten las peticiones sueltas y los lotes)
+ *
+ * @param package Paquete con la petición
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param prestamos Índice de préstamos (se actualiza al prestar y devolver)
+ * @param prestatario Prestatario del cliente (\ref prestatarioDe)
+ * @param reservas Colas de reserva (RESERVAR pone al cliente en espera)
+ * @param titulos Índice de títulos (corrige los nombres mal escritos)
+ * @param respuesta RETORNA: respuesta para el cliente
+ * @param afectado RETORNA: ejemplar prestado, renovado o devuelto (0 si ninguno)
+ * @param posicion RETORNA: su posición en la BD (SIN_EJEMPLAR si ninguno)
+ * @return SUCCESS_GENERIC, ERROR_SOLICITUD si no se pudo o ERROR_COMUNICACION
+ * si la petición no existe (sin respuesta)
+ */
+int atenderLibro(paquet_t package,
+                 book_t ejemplar[],
+                 indice_prestamos_t *prestamos,
+                 pid_t prestatario,
+                 colas_reserva_t *reservas,
+                 indice_titulos_t *titulos,
+                 paquet_t *respuesta,
+                 int *afectado,
+                 int *posicion);
+
+/**
+ * @brief Prestatario con el que se registran los préstamos de un cliente: su
+ * número de lector o, si no tiene, su PID (identificador TCP)
+ * @note El cliente queda marcado para que sus préstamos con el PID y sus
+ * reservas se liberen cuando se cierre (\ref liberarCerrados)
+ *
+ * @param clients Lista de los clientes
+ * @param client PID del cliente
+ * @return pid_t Prestatario para el índice de préstamos
+ */
+pid_t prestatarioDe(struct client_list *clients, pid_t client);
+
+/**
+ * @brief Dejar sin prestatario los préstamos que tenían con su PID los
+ * clientes cerrados desde la última vez, así otro proceso con el mismo PID
+ * (o identificador TCP) no los hereda, y quitar sus reservas
+ * @note Se llama con el semáforo de la BD tomado; \ref cerrarCliente sólo
+ * anota el PID porque corre con el de las colas de salida (a veces dentro
+ * de la región de la BD)
+ *
+ * @param clients Lista de los clientes
+ * @param prestamos Índice de préstamos de la BD
+ * @param reservas Colas de reserva de la BD
+ * @param ejemplar Arreglo con los libros de la BD
+ */
+void liberarCerrados(struct client_list *clients,
+                     indice_prestamos_t *prestamos,
+                     colas_reserva_t *reservas,
+                     book_t ejemplar[]);
+
+/**
+ * @brief Responder MIS_PRESTAMOS: los ejemplares que tiene el cliente, según
+ * el índice de préstamos, en paquetes PRESTAMOS con el id de la petición
+ * @note Un cliente tiene a lo sumo MAX_CANT_LIBROS ejemplares, así que la
+ * respuesta cabe en su cola de salida
+ *
+ * @param clients Lista de los clientes
+ * @param package Paquete con la petición
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param prestamos Índice de préstamos de la BD
+ * @return SUCCESS_GENERIC si éxito, cualquier otro valor de lo contrario
+ */
+int listarPrestamos(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_prestamos_t *prestamos);
+
+/**
+ * @brief Responder BUSCAR_TODOS: una página de resultados, cada uno en un
+ * paquete BOOK con el id de la petición, y al final la señal FIN_BUSQUEDA con
+ * el cursor de la página siguiente
+ * @note Con ISBN se envía cada ejemplar del título; sin ISBN (0) el primer
+ * ejemplar de cada título cuya clave contiene la del texto de la petición
+ * (vacío: todos).
+ * El cursor (copyInfo.n_copy) es la posición de la BD desde la que se sigue y
+ * n_copies el límite de resultados (0 o más de \ref MAX_RESULTADOS_BUSQUEDA:
+ * el del servidor)
+ *
+ * @param clients Lista de los clientes
+ * @param package Paquete con la petición
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param titulos Índice de títulos de la BD (clave de cada ejemplar)
+ * @return SUCCESS_GENERIC si éxito, cualquier otro valor de lo contrario
+ */
+int buscarEjemplares(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_titulos_t *titulos);
+
+/**
+ * @brief Responder BUSCAR_PREFIJO o BUSCAR_PALABRA con el índice de títulos,
+ * sin recorrer la BD: una página de títulos (su primer ejemplar) en paquetes
+ * BOOK y al final FIN_BUSQUEDA, igual que \ref buscarEjemplares
+ * @note El cursor cuenta resultados (no posiciones de la BD)
+ *
+ * @param clients Lista de los clientes
+ * @param package Paquete con la petición (el nombre es el prefijo o la palabra)
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param titulos Índice de títulos de la BD
+ * @return SUCCESS_GENERIC si éxito, cualquier otro valor de lo contrario
+ */
+int buscarTitulos(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_titulos_t *titulos);
+
+/**
+ * @brief Responder BUSCAR_PARECIDOS: los títulos de nombre más parecido (con
+ * errores de escritura) en paquetes BOOK, de mayor a menor parecido, y al
+ * final FIN_BUSQUEDA (una sola página)
+ * @note n_copies es la cantidad pedida (hasta \ref MAX_PARECIDOS) y en cada
+ * resultado copyInfo.n_copy lleva el parecido (0 a 100)
+ *
+ * @param clients Lista de los clientes
+ * @param package Paquete con la petición
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param titulos Índice de títulos de la BD
+ * @return SUCCESS_GENERIC si éxito, cualquier otro valor de lo contrario
+ */
+int buscarParecidosCliente(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_titulos_t *titulos);
+
+/**
+ * @brief Cambiar un nombre que no existe por el del título más parecido con
+ * el mismo ISBN, si se parece al menos \ref UMBRAL_PARECIDO
+ *
+ * @param titulos Índice de títulos de la BD
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param libro RETORNA: libro de la petición con el nombre corregido
+ * @param sugerencia RETORNA: si no se corrigió, el título más parecido para
+ * el mensaje de error (vacía si no hay ninguno)
+ * @return true si se corrigió
+ */
+bool corregirTitulo(indice_titulos_t *titulos,
+                    book_t ejemplar[],
+                    book_t *libro,
+                    char *sugerencia);
+
+/**
+ * @brief Si ningún título tiene el ISBN y la clave del libro, corregir el
+ * nombre (\ref corregirTitulo) y volver a calcular su clave; así lo
+ * resuelven igual las peticiones sueltas, los lotes y las transacciones
+ *
+ * @param titulos Índice de títulos de la BD
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param libro RETORNA: libro de la petición con el nombre corregido
+ * @param clave RETORNA: clave del nombre (ya calculada al llamar)
+ * @param sugerencia RETORNA: si no se corrigió, el título más parecido
+ */
+void resolverTitulo(indice_titulos_t *titulos,
+                    book_t ejemplar[],
+                    book_t *libro,
+                    clave_t *clave,
+                    char *sugerencia);
+
+/**
+ * @brief Entregar los ejemplares disponibles de un título a los clientes que
+ * lo reservaron, en orden de llegada, y avisarles con AVISO_RESERVA (con el
+ * id de su petición RESERVAR)
+ * @note Se salta a los clientes que ya no están conectados
+ *
+ * @param clients Lista de los clientes
+ * @param posicion Posición en la BD del ejemplar devuelto (\ref atenderLibro),
+ * SIN_EJEMPLAR si ninguno
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param prestamos Índice de préstamos de la BD
+ * @param reservas Colas de reserva de la BD
+ * @param titulos Índice de títulos de la BD (versión de cada título)
+ * @return int Cantidad de ejemplares entregados
+ */
+int entregarReservas(
+    struct client_list *clients,
+    int posicion,
+    book_t ejemplar[],
+    indice_prestamos_t *prestamos,
+    colas_reserva_t *reservas,
+    indice_titulos_t *titulos);
+
+/**
+ * @brief Saber si una petición en cola puede cambiar los ejemplares de un
+ * libro (préstamo, renovación, devolución o reserva, suelta o en un lote)
+ *
+ * @param paquete Petición
+ * @param ISBN ISBN del libro
+ * @return true si lo puede cambiar
+ */
+bool cambiaLibro(const paquet_t *paquete, int ISBN);
+
+/**
+ * @brief Después de prestar, renovar o devolver un ejemplar: cambia la
+ * versión de su título y se copia al catálogo local (si se publicó)
+ *
+ * @param titulos Índice de títulos de la BD
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param posicion Posición del ejemplar que cambió
+ */
+void ejemplarCambiado(indice_titulos_t *titulos, book_t ejemplar[], int posicion);
+
+/**
+ * @brief Prestar un ejemplar disponible por una semana
+ *
+ * @param copia Ejemplar en la BD
+ * @param buffer RETORNA: fecha de entrega y número de ejemplar para el cliente
+ */
+void prestarEjemplar(book_t *copia, char *buffer);
+
+/**
+ * @brief Renovar un ejemplar prestado una semana más (desde hoy si la entrega
+ * ya había vencido)
+ *
+ * @param copia Ejemplar en la BD
+ * @param buffer RETORNA: nueva fecha de entrega para el cliente
+ * @return true si la entrega ya había vencido
+ */
+bool renovarEjemplar(book_t *copia, char *buffer);
+
+/**
+ * @brief Marcar un ejemplar como disponible con la fecha de hoy
+ *
+ * @param copia Ejemplar en la BD
+ * @param buffer RETORNA: fecha de devolución para el cliente
+ */
+void devolverEjemplar(book_t *copia, char *buffer);
+
+/**
+ * @brief Manejar un LOTE: atender cada operación en orden y responder con un
+ * solo paquete RESULTADOS
+ *
+ * @param clients Lista de los clientes
+ * @param package Paquete con el lote
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param prestamos Índice de préstamos de la BD
+ * @param reservas Colas de reserva de la BD
+ * @param titulos Índice de títulos de la BD
+ * @param expirado El lote esperó demasiado en cola (todas las operaciones se
+ * responden con PET_EXPIRADA sin tocar la BD)
+ * @return SUCCESS_GENERIC si éxito, cualquier otro valor de lo contrario
+ */
+int manejarLote(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_prestamos_t *prestamos,
+    colas_reserva_t *reservas,
+    indice_titulos_t *titulos,
+    bool expirado);
+
+/**
+ * @brief Manejar una TRANSACCION: prestar todos los libros pedidos o ninguno y
+ * responder con un solo paquete RESULTADOS
+ * @note Se atiende con una sola entrada a la región crítica de la BD, así
+ * ningún otro cliente ve la transacción a medias
+ *
+ * @param clients Lista de los clientes
+ * @param package Paquete con la transacción (sólo SOLICITAR)
+ * @param ejemplar Arreglo con los libros de la BD
+ * @param prestamos Índice de préstamos de la BD
+ * @param titulos Índice de títulos de la BD (claves de los nombres)
+ * @param expirado La transacción esperó demasiado en cola (se responde
+ * PET_EXPIRADA sin tocar la BD)
+ * @return SUCCESS_GENERIC si se prestaron todos (o expiró), ERROR_SOLICITUD si
+ * ninguno o cualquier otro valor si no se pudo responder
+ */
+int manejarTransaccion(
+    struct client_list *clients,
+    paquet_t package,
+    book_t ejemplar[],
+    indice_prestamos_t *prestamos,
+    indice_titulos_t *titulos,
+    bool expirado);
 
 /* ---------------- Manejo de concurrencia y buffer interno ---------------- */
 
@@ -225,14 +1223,91 @@ int manejarLibros(
  * @param buffer Arreglo buffer
  * @param client_list Lista con los clientes
  * @param booksDatabase Base de datos con los libros
+ * @param prestamos Índice de préstamos de la base de datos
+ * @param reservas Colas de reserva de la base de datos
+ * @param titulos Índice de títulos de la base de datos
+ * @param cache Caché de respuestas BUSCAR
  */
 struct arg_buffer
 {
     buffer_t *buffer;
     struct client_list *clients;
     book_t *booksDatabase;
+    indice_prestamos_t *prestamos;
+    colas_reserva_t *reservas;
+    indice_titulos_t *titulos;
+    cache_busqueda_t *cache;
+};
+
+/**
+ * @struct arg_conexiones
+ * Argumentos de la función manejador conexiones
+ * @param conexiones Conexiones recibidas por el hilo principal
+ * @param client_list Lista con los clientes
+ */
+struct arg_conexiones
+{
+    struct conexiones_pendientes *conexiones;
+    struct client_list *clients;
+};
+
+/**
+ * @brief Hilo que abre los pipes (Servidor->Cliente) de las conexiones nuevas
+ * y activa a cada cliente cuando su pipe está listo, así el hilo auxiliar nunca
+ * espera por un cliente que se está conectando
+ * 
+ * @param params parametros de la función
+ * @return void* Nada
+ */
+void *manejadorConexiones(struct arg_conexiones *params);
+
+/**
+ * @struct arg_anillos
+ * Argumentos de la función manejador anillos
+ * @param buffer Buffer interno
+ * @param client_list Lista con los clientes
+ */
+struct arg_anillos
+{
+    buffer_t *buffer;
+    struct client_list *clients;
 };
 
+/**
+ * @brief Hilo que pasa las peticiones de los anillos de memoria compartida al
+ * buffer interno, hace espera activa mientras hay tráfico y duerme (los
+ * clientes tocan el timbre por el pipe) cuando no lo hay
+ * 
+ * @param params parametros de la función
+ * @return void* Nada
+ */
+void *manejadorAnillos(struct arg_anillos *params);
+
+/**
+ * @brief Tiempo de CPU consumido por todo el proceso (todos los hilos)
+ * 
+ * @return double Segundos de CPU
+ */
+double segundosCPU(void);
+
+/**
+ * @brief Milisegundos transcurridos desde un instante dado
+ * 
+ * @param inicio Instante inicial (CLOCK_MONOTONIC)
+ * @return long Milisegundos transcurridos
+ */
+long msDesde(const struct timespec *inicio);
+
+/**
+ * @brief Responder a una petición que superó \ref LIMITE_ESPERA_MS en cola
+ * sin procesarla, el cliente recibe la señal \ref PET_EXPIRADA
+ * 
+ * @param clients Lista de los clientes
+ * @param package Paquete expirado
+ * @return SUCCESS_GENERIC si éxito, cualquier otro valor de lo contrario
+ */
+int rechazarExpirada(struct client_list *clients, paquet_t package);
+
 /**
  * @brief Función encargada de manejar las peticiones, se tiene que llamar desde
  * un hilo
@@ -0,0 +1,172 @@
+/**
+ * @file shm.c
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Transporte por memoria compartida: anillos SPSC entre Cliente y Servidor
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#include "shm.h"
+
+/* --------------------------------- Futex --------------------------------- */
+
+// Sin FUTEX_PRIVATE_FLAG: la palabra está en memoria compartida entre procesos
+static void futexEsperar(uint32_t *palabra, uint32_t valor, int ms)
+{
+    struct timespec limite = {ms / 1000, (ms % 1000) * 1000000L};
+    syscall(SYS_futex, palabra, FUTEX_WAIT, valor, &limite, NULL, 0);
+}
+
+static void futexDespertar(uint32_t *palabra)
+{
+    syscall(SYS_futex, palabra, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/* --------------------------------- Anillos --------------------------------- */
+
+void nombreSegmento(pid_t cliente, char *nombre)
+{
+    sprintf(nombre, "%s%d", PREFIJO_SHM, cliente);
+}
+
+bool anilloEscribir(anillo_shm_t *anillo, const paquet_t *paquete)
+{
+    uint32_t cola = anillo->cola;
+    uint32_t cabeza = __atomic_load_n(&anillo->cabeza, __ATOMIC_ACQUIRE);
+
+    if (cola - cabeza >= TAM_ANILLO_SHM)
+        return false;
+
+    // El paquete debe estar completo antes de publicar la nueva cola
+    anillo->paquetes[cola & (TAM_ANILLO_SHM - 1)] = *paquete;
+    __atomic_store_n(&anillo->cola, cola + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool anilloLeer(anillo_shm_t *anillo, paquet_t *paquete)
+{
+    uint32_t cabeza = anillo->cabeza;
+    uint32_t cola = __atomic_load_n(&anillo->cola, __ATOMIC_ACQUIRE);
+
+    if (cabeza == cola)
+        return false;
+
+    // El espacio se libera después de copiar el paquete
+    *paquete = anillo->paquetes[cabeza & (TAM_ANILLO_SHM - 1)];
+    __atomic_store_n(&anillo->cabeza, cabeza + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool anilloHayDatos(anillo_shm_t *anillo)
+{
+    return __atomic_load_n(&anillo->cola, __ATOMIC_ACQUIRE) !=
+           __atomic_load_n(&anillo->cabeza, __ATOMIC_RELAXED);
+}
+
+bool anilloReclamarDespertar(anillo_shm_t *anillo)
+{
+    // La escritura de la cola debe ser visible antes de leer la marca (y el
+    // consumidor marca antes de revisar la cola), así nadie se queda dormido
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&anillo->durmiendo, __ATOMIC_RELAXED) == 0)
+        return false;
+
+    return __atomic_exchange_n(&anillo->durmiendo, 0, __ATOMIC_SEQ_CST) != 0;
+}
+
+void anilloDespertar(anillo_shm_t *anillo)
+{
+    __atomic_add_fetch(&anillo->timbre, 1, __ATOMIC_SEQ_CST);
+    futexDespertar(&anillo->timbre);
+}
+
+void anilloMarcarDormido(anillo_shm_t *anillo)
+{
+    __atomic_store_n(&anillo->durmiendo, 1, __ATOMIC_SEQ_CST);
+}
+
+void anilloMarcarDespierto(anillo_shm_t *anillo)
+{
+    if (__atomic_load_n(&anillo->durmiendo, __ATOMIC_RELAXED))
+        __atomic_store_n(&anillo->durmiendo, 0, __ATOMIC_RELAXED);
+}
+
+bool anilloEsperar(anillo_shm_t *anillo, uint32_t *cerrado, int vigilado)
+{
+    //! 1. Espera activa: la respuesta suele llegar en pocos microsegundos
+    int vueltas = vueltasEsperaActiva();
+    for (int i = 0; i < vueltas; i++)
+    {
+        if (anilloHayDatos(anillo))
+            return true;
+        if (__atomic_load_n(cerrado, __ATOMIC_ACQUIRE))
+            return false;
+        pausaCPU();
+    }
+
+    //! 2. Dormir hasta que el productor cambie el timbre
+    while (true)
+    {
+        uint32_t timbre = __atomic_load_n(&anillo->timbre, __ATOMIC_ACQUIRE);
+        anilloMarcarDormido(anillo);
+
+        if (anilloHayDatos(anillo))
+        {
+            anilloMarcarDespierto(anillo);
+            return true;
+        }
+
+        if (__atomic_load_n(cerrado, __ATOMIC_ACQUIRE))
+        {
+            anilloMarcarDespierto(anillo);
+            return false;
+        }
+
+        // Si el timbre ya cambió el futex retorna de inmediato, el límite
+        // de tiempo permite notar que el otro extremo murió sin cerrar
+        futexEsperar(&anillo->timbre, timbre, VIGILANCIA_SHM_MS);
+
+        if (vigilado >= 0 && extremoCerrado(vigilado) && !anilloHayDatos(anillo))
+        {
+            anilloMarcarDespierto(anillo);
+            return false;
+        }
+    }
+}
+
+bool extremoCerrado(int fd)
+{
+    struct pollfd pfd = {fd, 0, 0};
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLERR | POLLHUP));
+}
+
+int vueltasEsperaActiva(void)
+{
+    static int vueltas = -1;
+
+    if (vueltas < 0)
+        vueltas = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? ESPERA_ACTIVA_SHM : 0;
+
+    return vueltas;
+}
+
+void pausaCPU(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
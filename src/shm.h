@@ -0,0 +1,170 @@
+/**
+ * @file shm.h
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Transporte por memoria compartida: anillos SPSC entre Cliente y Servidor
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#ifndef __SHM_H__
+#define __SHM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "paquet.h"
+
+/* ----------------------------- Definiciones ----------------------------- */
+
+#define PREFIJO_SHM "/bibliotecaShm_" /**< Nombre del segmento (+ PID del cliente)*/
+#define MAGIA_SHM 0x53484D42u         /**< Segmento iniciado por un cliente ("BMHS")*/
+#define TAM_ANILLO_SHM 64             /**< Paquetes por anillo (potencia de 2)*/
+#define TAM_LINEA_CACHE 64            /**< Separación entre productor y consumidor*/
+#define ESPERA_ACTIVA_SHM 20000       /**< Vueltas de espera activa antes de dormir*/
+#define VIGILANCIA_SHM_MS 100         /**< Cada cuánto revisa el que duerme si el otro extremo sigue vivo*/
+
+/* ------------------------------ Estructuras ------------------------------ */
+
+/**
+ * @struct anillo_shm_t
+ * @brief Cola circular de un productor y un consumidor en memoria compartida
+ *
+ * El productor sólo escribe 'cola', el consumidor sólo escribe 'cabeza', cada
+ * uno en su propia línea de caché. El consumidor que se va a dormir marca
+ * 'durmiendo' y espera (futex) a que cambie 'timbre', el productor sólo hace
+ * una llamada al sistema si encuentra la marca
+ */
+typedef struct
+{
+    uint32_t cola;      /**< Próxima posición a escribir (productor)*/
+    uint32_t durmiendo; /**< El consumidor está dormido o por dormirse*/
+    uint32_t timbre;    /**< Palabra del futex, cambia con cada aviso*/
+    char relleno1[TAM_LINEA_CACHE - 3 * sizeof(uint32_t)];
+
+    uint32_t cabeza; /**< Próxima posición a leer (consumidor)*/
+    char relleno2[TAM_LINEA_CACHE - sizeof(uint32_t)];
+
+    paquet_t paquetes[TAM_ANILLO_SHM]; /**< Paquetes en tránsito*/
+} anillo_shm_t;
+
+/**
+ * @struct segmento_shm_t
+ * @brief Segmento (shm_open) que crea cada cliente: un anillo de peticiones
+ * (Cliente->Servidor) y uno de respuestas (Servidor->Cliente)
+ */
+typedef struct
+{
+    uint32_t magia;   /**< MAGIA_SHM cuando el cliente terminó de iniciarlo*/
+    uint32_t cerrado; /**< El servidor cerró la comunicación (equivale a EOF)*/
+    char relleno[TAM_LINEA_CACHE - 2 * sizeof(uint32_t)];
+
+    anillo_shm_t peticiones; /**< Cliente->Servidor*/
+    anillo_shm_t respuestas; /**< Servidor->Cliente*/
+} segmento_shm_t;
+
+/* ------------------------ Prototipos de funciones ------------------------ */
+
+/**
+ * @brief Nombre del segmento de un cliente
+ *
+ * @param cliente PID del cliente
+ * @param nombre RETORNA: nombre para shm_open (TAM_STRING)
+ */
+void nombreSegmento(pid_t cliente, char *nombre);
+
+/**
+ * @brief Escribir un paquete sin bloquear
+ * @note Sólo un hilo puede escribir en cada anillo
+ *
+ * @param anillo Anillo destino
+ * @param paquete Paquete a escribir
+ * @return true si se escribió, false si el anillo está lleno
+ */
+bool anilloEscribir(anillo_shm_t *anillo, const paquet_t *paquete);
+
+/**
+ * @brief Leer un paquete sin bloquear
+ * @note Sólo un hilo puede leer de cada anillo
+ *
+ * @param anillo Anillo origen
+ * @param paquete RETORNA: paquete leído
+ * @return true si se leyó, false si el anillo está vacío
+ */
+bool anilloLeer(anillo_shm_t *anillo, paquet_t *paquete);
+
+/**
+ * @brief Saber si el anillo tiene paquetes
+ *
+ * @param anillo Anillo
+ * @return true si hay paquetes por leer
+ */
+bool anilloHayDatos(anillo_shm_t *anillo);
+
+/**
+ * @brief Después de escribir: saber si el consumidor estaba dormido, sólo
+ * uno de los productores que lo encuentren dormido recibe true
+ *
+ * @param anillo Anillo en el que se escribió
+ * @return true si hay que despertar al consumidor
+ */
+bool anilloReclamarDespertar(anillo_shm_t *anillo);
+
+/**
+ * @brief Despertar al consumidor que duerme en \ref anilloEsperar
+ *
+ * @param anillo Anillo del consumidor
+ */
+void anilloDespertar(anillo_shm_t *anillo);
+
+/**
+ * @brief Marcar al consumidor como dormido, a partir de aquí los productores
+ * avisan con \ref anilloReclamarDespertar
+ *
+ * @param anillo Anillo del consumidor
+ */
+void anilloMarcarDormido(anillo_shm_t *anillo);
+
+/**
+ * @brief Quitar la marca de dormido (el consumidor despertó por otra razón)
+ *
+ * @param anillo Anillo del consumidor
+ */
+void anilloMarcarDespierto(anillo_shm_t *anillo);
+
+/**
+ * @brief Esperar a que el anillo tenga datos: espera activa corta y después
+ * duerme en un futex
+ *
+ * @param anillo Anillo del consumidor
+ * @param cerrado Bandera de cierre del segmento (se deja de esperar si es 1)
+ * @param vigilado Descriptor cuyo cierre equivale a cerrar el segmento (el
+ * otro extremo terminó sin avisar), -1 para no vigilar ninguno
+ * @return true si hay datos, false si el segmento se cerró
+ */
+bool anilloEsperar(anillo_shm_t *anillo, uint32_t *cerrado, int vigilado);
+
+/**
+ * @brief Saber si el otro extremo de un pipe se cerró (POLLERR o POLLHUP)
+ *
+ * @param fd Extremo propio del pipe
+ * @return true si el otro extremo ya no existe
+ */
+bool extremoCerrado(int fd);
+
+/**
+ * @brief Vueltas de espera activa que vale la pena hacer: con un solo
+ * procesador esperar activamente sólo retrasa al otro extremo
+ *
+ * @return int ESPERA_ACTIVA_SHM o 0 si hay un solo procesador
+ */
+int vueltasEsperaActiva(void);
+
+/**
+ * @brief Pausa para las esperas activas (no cede el procesador)
+ */
+void pausaCPU(void);
+
+#endif // __SHM_H__
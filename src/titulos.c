@@ -0,0 +1,378 @@
+/**
+ * @file titulos.c
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Índice de títulos: búsqueda por prefijo del nombre, por palabra y
+ * por parecido (trigramas)
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+
+#include "titulos.h"
+
+/* -------------------------------- Palabras -------------------------------- */
+
+// Los bytes de UTF-8 (tildes, eñes) cuentan como letras
+static bool esLetra(unsigned char c)
+{
+    return isalnum(c) || c >= 0x80;
+}
+
+// Siguiente palabra del nombre en minúsculas (truncada a TAM_PALABRA - 1),
+// NULL si no quedan
+static const char *siguientePalabra(const char *p, char *palabra)
+{
+    while (*p != '\0' && !esLetra((unsigned char)*p))
+        p++;
+
+    if (*p == '\0')
+        return NULL;
+
+    int n = 0;
+    for (; esLetra((unsigned char)*p); p++)
+        if (n < TAM_PALABRA - 1)
+            palabra[n++] = (char)tolower((unsigned char)*p);
+
+    palabra[n] = '\0';
+    return p;
+}
+
+// Primera posición de 'palabras' que no es menor que (texto, titulo)
+static int cotaPalabra(const indice_titulos_t *indice, const char *texto, int titulo)
+{
+    int bajo = 0, alto = indice->n_palabras;
+    while (bajo < alto)
+    {
+        int medio = (bajo + alto) / 2;
+        const palabra_t *actual = &indice->palabras[medio];
+
+        int orden = strcmp(actual->texto, texto);
+        if (orden < 0 || (orden == 0 && actual->titulo < titulo))
+            bajo = medio + 1;
+        else
+            alto = medio;
+    }
+    return bajo;
+}
+
+static bool agregarPalabra(indice_titulos_t *indice, const char *texto, int titulo)
+{
+    int i = cotaPalabra(indice, texto, titulo);
+
+    // La misma palabra dos veces en un título se indexa una sola vez
+    if (i < indice->n_palabras && indice->palabras[i].titulo == titulo &&
+        strcmp(indice->palabras[i].texto, texto) == 0)
+        return true;
+
+    if (indice->n_palabras == MAX_PALABRAS)
+        return false;
+
+    memmove(&indice->palabras[i + 1], &indice->palabras[i],
+            sizeof(palabra_t) * (indice->n_palabras - i));
+    strcpy(indice->palabras[i].texto, texto);
+    indice->palabras[i].titulo = (short)titulo;
+    indice->n_palabras++;
+    return true;
+}
+
+/* --------------------------------- Claves --------------------------------- */
+
+// Letra sin tilde de cada carácter de U+00C0 a U+00FF (en UTF-8: 0xC3 seguido
+// de 0x80 a 0xBF), 0 si no es una letra con tilde y se deja igual
+static const char sinTilde[64] = "aaaaaaaceeeeiiiidnooooo\0ouuuuyts"
+                                 "aaaaaaaceeeeiiiidnooooo\0ouuuuyty";
+
+void normalizarNombre(const char *nombre, clave_t *clave)
+{
+    const unsigned char *p = (const unsigned char *)nombre;
+    int n = 0;
+    bool espacio = false;
+
+    //! 1. Copiar en minúsculas y sin tildes, un espacio sólo entre palabras
+    for (; *p != '\0' && n < TAM_STRING - 1; p++)
+    {
+        if (isspace(*p))
+        {
+            espacio = (n > 0);
+            continue;
+        }
+
+        if (espacio && n < TAM_STRING - 2)
+            clave->texto[n++] = ' ';
+        espacio = false;
+
+        if (*p == 0xC3 && p[1] >= 0x80 && p[1] <= 0xBF && sinTilde[p[1] - 0x80] != '\0')
+            clave->texto[n++] = sinTilde[*++p - 0x80];
+        else
+            clave->texto[n++] = (char)tolower(*p);
+    }
+    clave->texto[n] = '\0';
+
+    //! 2. Hash del resultado
+    clave->hash = 2166136261u;
+    for (int i = 0; i < n; i++)
+        clave->hash = (clave->hash ^ (unsigned char)clave->texto[i]) * 16777619u;
+}
+
+bool mismaClave(const clave_t *a, const clave_t *b)
+{
+    return a->hash == b->hash && strcmp(a->texto, b->texto) == 0;
+}
+
+/* -------------------------------- Trigramas -------------------------------- */
+
+// Firma de una clave (\ref normalizarNombre): sus palabras separadas por un
+// espacio, con dos espacios al inicio y uno al final (así cuentan el
+// principio y el final de cada palabra); cada trigrama enciende un bit según
+// su hash
+static void firmaNombre(const clave_t *clave, firma_t *firma)
+{
+    memset(firma, 0, sizeof(*firma));
+
+    char texto[2 * TAM_STRING] = "  ";
+    int n = 2;
+    char palabra[TAM_PALABRA];
+    const char *p = clave->texto;
+    while ((p = siguientePalabra(p, palabra)) != NULL)
+        n += sprintf(texto + n, "%s ", palabra);
+
+    for (int i = 0; i + 2 < n; i++)
+    {
+        unsigned h = ((unsigned char)texto[i] * 31u + (unsigned char)texto[i + 1]) * 31u +
+                     (unsigned char)texto[i + 2];
+        h &= BITS_FIRMA - 1;
+        firma->bits[h / 64] |= 1ull << (h % 64);
+    }
+}
+
+// Bits encendidos de una firma o de la intersección de dos. Sin -march el
+// compilador no puede suponer la instrucción popcnt y la emula con sumas de
+// bits en paralelo (SWAR)
+static int contarBitsGenerico(const firma_t *a, const firma_t *b)
+{
+    int total = 0;
+    for (int i = 0; i < PALABRAS_FIRMA; i++)
+        total += __builtin_popcountll(b == NULL ? a->bits[i] : a->bits[i] & b->bits[i]);
+    return total;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// La misma cuenta compilada con popcnt, sólo se llama si el procesador la tiene
+__attribute__((target("popcnt"))) static int contarBitsPopcnt(const firma_t *a,
+                                                              const firma_t *b)
+{
+    int total = 0;
+    for (int i = 0; i < PALABRAS_FIRMA; i++)
+        total += __builtin_popcountll(b == NULL ? a->bits[i] : a->bits[i] & b->bits[i]);
+    return total;
+}
+#endif
+
+static int contarBits(const firma_t *a, const firma_t *b)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("popcnt"))
+        return contarBitsPopcnt(a, b);
+#endif
+    return contarBitsGenerico(a, b);
+}
+
+/* --------------------------------- Índice --------------------------------- */
+
+void iniciarTitulos(indice_titulos_t *indice)
+{
+    indice->n_titulos = 0;
+    indice->n_palabras = 0;
+    indice->n_descartadas = 0;
+    memset(indice->claves, 0, sizeof(indice->claves));
+    memset(indice->tituloDe, 0, sizeof(indice->tituloDe));
+    memset(indice->version, 0, sizeof(indice->version));
+}
+
+bool agregarTitulo(indice_titulos_t *indice, const book_t ejemplar[], int titulo)
+{
+    if (indice->n_titulos == MAX_CANT_LIBROS)
+        return false;
+
+    //! 1. Clave del nombre, con ella se ordena y se parte en palabras
+    const char *nombre = ejemplar[titulo].name;
+    const char *clave = indice->claves[titulo].texto;
+    normalizarNombre(nombre, &indice->claves[titulo]);
+
+    //! 2. Por nombre: insertar en orden (búsqueda binaria del lugar)
+    int bajo = 0, alto = indice->n_titulos;
+    while (bajo < alto)
+    {
+        int medio = (bajo + alto) / 2;
+        if (strcmp(indice->claves[indice->porNombre[medio]].texto, clave) <= 0)
+            bajo = medio + 1;
+        else
+            alto = medio;
+    }
+
+    memmove(&indice->porNombre[bajo + 1], &indice->porNombre[bajo],
+            sizeof(short) * (indice->n_titulos - bajo));
+    indice->porNombre[bajo] = (short)titulo;
+    indice->n_titulos++;
+
+    //! 3. Por palabra (las que no caben se cuentan)
+    char palabra[TAM_PALABRA];
+    const char *p = clave;
+    while ((p = siguientePalabra(p, palabra)) != NULL)
+        if (!agregarPalabra(indice, palabra, titulo))
+            indice->n_descartadas++;
+
+    //! 4. Por parecido
+    firmaNombre(&indice->claves[titulo], &indice->firmas[titulo]);
+    indice->bitsFirma[titulo] = (short)contarBits(&indice->firmas[titulo], NULL);
+
+    indice->tituloDe[titulo] = (short)titulo;
+    indice->version[titulo] = 1;
+
+    return true;
+}
+
+void indexarTitulos(indice_titulos_t *indice, const book_t ejemplar[], int n_libros)
+{
+    // Los ejemplares de un título están juntos, el primero lo representa y
+    // los demás copian su clave
+    for (int i = 0; i < n_libros; i++)
+        if (i == 0 || ejemplar[i - 1].ISBN != ejemplar[i].ISBN ||
+            strcmp(ejemplar[i - 1].name, ejemplar[i].name) != 0)
+            agregarTitulo(indice, ejemplar, i);
+        else
+        {
+            indice->claves[i] = indice->claves[i - 1];
+            indice->tituloDe[i] = indice->tituloDe[i - 1];
+        }
+
+    if (indice->n_descartadas > 0)
+        fprintf(stderr, "%d palabras no caben en el índice de títulos (MAX_PALABRAS = %d), "
+                        "esos títulos no se encuentran por ellas\n",
+                indice->n_descartadas, MAX_PALABRAS);
+}
+
+int buscarPrefijo(const indice_titulos_t *indice, const char *prefijo, int *primero)
+{
+    // El prefijo se normaliza igual que los títulos
+    clave_t clave;
+    normalizarNombre(prefijo, &clave);
+    size_t n = strlen(clave.texto);
+
+    //! 1. Primera clave que no es menor que el prefijo
+    int bajo = 0, alto = indice->n_titulos;
+    while (bajo < alto)
+    {
+        int medio = (bajo + alto) / 2;
+        if (strncmp(indice->claves[indice->porNombre[medio]].texto, clave.texto, n) < 0)
+            bajo = medio + 1;
+        else
+            alto = medio;
+    }
+
+    //! 2. Los que empiezan por él están a continuación
+    int fin = bajo;
+    while (fin < indice->n_titulos &&
+           strncmp(indice->claves[indice->porNombre[fin]].texto, clave.texto, n) == 0)
+        fin++;
+
+    *primero = bajo;
+    return fin - bajo;
+}
+
+int buscarPalabra(const indice_titulos_t *indice, const char *palabra, int *primero)
+{
+    // La consulta se normaliza igual que los títulos
+    clave_t clave;
+    normalizarNombre(palabra, &clave);
+
+    char texto[TAM_PALABRA];
+    if (siguientePalabra(clave.texto, texto) == NULL)
+    {
+        *primero = 0;
+        return 0;
+    }
+
+    int inicio = cotaPalabra(indice, texto, -1);
+    int fin = inicio;
+    while (fin < indice->n_palabras && strcmp(indice->palabras[fin].texto, texto) == 0)
+        fin++;
+
+    *primero = inicio;
+    return fin - inicio;
+}
+
+int buscarTitulo(const indice_titulos_t *indice,
+                 const book_t ejemplar[],
+                 int ISBN,
+                 const clave_t *clave)
+{
+    // Cada título se descarta con dos comparaciones de enteros
+    for (int i = 0; i < indice->n_titulos; i++)
+    {
+        int titulo = indice->porNombre[i];
+        if (ejemplar[titulo].ISBN == ISBN && mismaClave(&indice->claves[titulo], clave))
+            return titulo;
+    }
+
+    return SIN_TITULO;
+}
+
+bool existeTitulo(const indice_titulos_t *indice,
+                  const book_t ejemplar[],
+                  int ISBN,
+                  const clave_t *clave)
+{
+    return buscarTitulo(indice, ejemplar, ISBN, clave) != SIN_TITULO;
+}
+
+void cambioEjemplar(indice_titulos_t *indice, int posicion)
+{
+    indice->version[indice->tituloDe[posicion]]++;
+}
+
+int buscarParecidos(const indice_titulos_t *indice,
+                    const char *nombre,
+                    parecido_t resultados[],
+                    int k)
+{
+    // La consulta se normaliza igual que los títulos
+    clave_t clave;
+    normalizarNombre(nombre, &clave);
+
+    firma_t consulta;
+    firmaNombre(&clave, &consulta);
+    int bitsConsulta = contarBits(&consulta, NULL);
+
+    int n = 0;
+    for (int i = 0; i < indice->n_titulos; i++)
+    {
+        //! 1. Parecido: 2 * |A y B| / (|A| + |B|)
+        int titulo = indice->porNombre[i];
+        int comunes = contarBits(&indice->firmas[titulo], &consulta);
+        if (comunes == 0)
+            continue;
+
+        short puntaje = (short)(200 * comunes / (indice->bitsFirma[titulo] + bitsConsulta));
+
+        //! 2. Insertar en orden entre los k mejores
+        int j = (n < k) ? n++ : k;
+        for (; j > 0 && resultados[j - 1].puntaje < puntaje; j--)
+            if (j < k)
+                resultados[j] = resultados[j - 1];
+
+        if (j < k)
+        {
+            resultados[j].titulo = (short)titulo;
+            resultados[j].puntaje = puntaje;
+        }
+    }
+
+    return n;
+}
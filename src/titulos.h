@@ -0,0 +1,224 @@
+/**
+ * @file titulos.h
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Índice de títulos: búsqueda por prefijo del nombre, por palabra y
+ * por parecido (trigramas)
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#ifndef __TITULOS_H__
+#define __TITULOS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "book.h"
+
+/* ----------------------------- Definiciones ----------------------------- */
+
+#define TAM_PALABRA 32                      /**< Palabra más larga que se indexa (con su fin de cadena)*/
+#define MAX_PALABRAS (8 * MAX_CANT_LIBROS) /**< Palabras entre todos los títulos*/
+
+#define BITS_FIRMA 512                   /**< Trigramas distintos que distingue una firma (potencia de 2)*/
+#define PALABRAS_FIRMA (BITS_FIRMA / 64) /**< Enteros de 64 bits de una firma*/
+#define MAX_PARECIDOS 5                  /**< Títulos parecidos que se pueden pedir*/
+#define UMBRAL_PARECIDO 50               /**< Parecido (%) desde el que se corrige un nombre*/
+#define SIN_TITULO -1                    /**< No hay un título con ese nombre e ISBN*/
+
+/* ------------------------------ Estructuras ------------------------------ */
+
+/**
+ * @struct palabra_t
+ * @brief Aparición de una palabra (de la clave del nombre) en un título
+ */
+typedef struct
+{
+    char texto[TAM_PALABRA]; /**< Palabra en minúsculas y sin tildes*/
+    short titulo;            /**< Posición del primer ejemplar del título*/
+} palabra_t;
+
+/**
+ * @struct firma_t
+ * @brief Conjunto de trigramas de un nombre, cada uno es un bit (según su hash)
+ */
+typedef struct
+{
+    uint64_t bits[PALABRAS_FIRMA]; /**< Bits de los trigramas*/
+} firma_t;
+
+/**
+ * @struct clave_t
+ * @brief Nombre normalizado: minúsculas, sin tildes y con los espacios
+ * recortados, más su hash para descartar casi todas las diferencias con una
+ * sola comparación de enteros
+ */
+typedef struct
+{
+    uint32_t hash;           /**< FNV-1a del texto*/
+    char texto[TAM_STRING]; /**< Nombre normalizado*/
+} clave_t;
+
+/**
+ * @struct parecido_t
+ * @brief Título parecido a una consulta
+ */
+typedef struct
+{
+    short titulo;  /**< Posición del primer ejemplar del título*/
+    short puntaje; /**< Parecido de 0 a 100 (coeficiente de Dice de los trigramas)*/
+} parecido_t;
+
+/**
+ * @struct indice_titulos_t
+ * @brief Dos arreglos ordenados sobre los títulos de la base de datos (cada
+ * título es su primer ejemplar): por nombre, para buscar un prefijo con
+ * búsqueda binaria, y por palabra (índice invertido), para buscar una palabra.
+ * Además la firma de trigramas de cada título para buscar nombres parecidos
+ * y la clave normalizada de cada ejemplar, calculada una sola vez al cargar.
+ * Cada título lleva una versión que cambia con cualquiera de sus ejemplares
+ * @note Se ordena y se busca por la clave normalizada (no distingue
+ * mayúsculas, tildes ni espacios de más). Se protege con el mismo semáforo
+ * que la base de datos
+ */
+typedef struct
+{
+    short porNombre[MAX_CANT_LIBROS]; /**< Títulos ordenados por nombre*/
+    int n_titulos;                    /**< Títulos indexados*/
+    palabra_t palabras[MAX_PALABRAS]; /**< Palabras ordenadas (y por título)*/
+    int n_palabras;                   /**< Palabras indexadas*/
+    int n_descartadas;                /**< Palabras que no cupieron (más de MAX_PALABRAS)*/
+    firma_t firmas[MAX_CANT_LIBROS];  /**< Firma de cada título (por posición en la BD)*/
+    short bitsFirma[MAX_CANT_LIBROS]; /**< Bits encendidos de cada firma*/
+    clave_t claves[MAX_CANT_LIBROS];  /**< Clave de cada ejemplar (por posición en la BD)*/
+    short tituloDe[MAX_CANT_LIBROS];  /**< Primer ejemplar del título de cada ejemplar*/
+    uint32_t version[MAX_CANT_LIBROS]; /**< Versión de cada título (desde 1)*/
+} indice_titulos_t;
+
+/* ------------------------ Prototipos de funciones ------------------------ */
+
+/**
+ * @brief Iniciar el índice sin títulos
+ *
+ * @param indice Índice a iniciar
+ */
+void iniciarTitulos(indice_titulos_t *indice);
+
+/**
+ * @brief Agregar un título al índice, manteniendo ambos arreglos ordenados
+ * (no hace falta reconstruirlo cuando cambia el catálogo)
+ * @note Las palabras que no caben (más de \ref MAX_PALABRAS) no se indexan,
+ * se cuentan en n_descartadas y \ref indexarTitulos las reporta
+ *
+ * @param indice Índice de títulos
+ * @param ejemplar Base de datos
+ * @param titulo Posición del primer ejemplar del título
+ * @return true si se agregó, false si el índice estaba lleno
+ */
+bool agregarTitulo(indice_titulos_t *indice, const book_t ejemplar[], int titulo);
+
+/**
+ * @brief Normalizar un nombre: minúsculas, sin tildes ni diéresis (á -> a,
+ * ñ -> n), sin espacios al inicio ni al final y con uno solo entre palabras
+ *
+ * @param nombre Nombre a normalizar
+ * @param clave RETORNA: clave del nombre
+ */
+void normalizarNombre(const char *nombre, clave_t *clave);
+
+/**
+ * @brief Saber si dos claves son iguales (el hash decide casi siempre)
+ *
+ * @param a Clave
+ * @param b Clave
+ * @return true si los nombres normalizados son iguales
+ */
+bool mismaClave(const clave_t *a, const clave_t *b);
+
+/**
+ * @brief Indexar todos los títulos de la base de datos (y calcular la clave
+ * de cada ejemplar)
+ *
+ * @param indice Índice de títulos (iniciado)
+ * @param ejemplar Base de datos
+ * @param n_libros Ejemplares en la base de datos
+ */
+void indexarTitulos(indice_titulos_t *indice, const book_t ejemplar[], int n_libros);
+
+/**
+ * @brief Títulos cuya clave empieza por la del prefijo
+ *
+ * @param indice Índice de títulos
+ * @param prefijo Prefijo a buscar (vacío: todos)
+ * @param primero RETORNA: posición en porNombre del primer resultado
+ * @return int Cantidad de resultados (consecutivos en porNombre)
+ */
+int buscarPrefijo(const indice_titulos_t *indice, const char *prefijo, int *primero);
+
+/**
+ * @brief Títulos que contienen una palabra completa
+ *
+ * @param indice Índice de títulos
+ * @param palabra Palabra a buscar
+ * @param primero RETORNA: posición en palabras del primer resultado
+ * @return int Cantidad de resultados (consecutivos en palabras)
+ */
+int buscarPalabra(const indice_titulos_t *indice, const char *palabra, int *primero);
+
+/**
+ * @brief Título con ese ISBN y esa clave
+ *
+ * @param indice Índice de títulos
+ * @param ejemplar Base de datos
+ * @param ISBN ISBN del libro
+ * @param clave Clave del nombre (\ref normalizarNombre)
+ * @return int Posición del primer ejemplar del título o SIN_TITULO
+ */
+int buscarTitulo(const indice_titulos_t *indice,
+                 const book_t ejemplar[],
+                 int ISBN,
+                 const clave_t *clave);
+
+/**
+ * @brief Saber si existe un título con ese ISBN y esa clave
+ *
+ * @param indice Índice de títulos
+ * @param ejemplar Base de datos
+ * @param ISBN ISBN del libro
+ * @param clave Clave del nombre (\ref normalizarNombre)
+ * @return true si existe
+ */
+bool existeTitulo(const indice_titulos_t *indice,
+                  const book_t ejemplar[],
+                  int ISBN,
+                  const clave_t *clave);
+
+/**
+ * @brief Avisar que un ejemplar cambió (se prestó, renovó o devolvió): la
+ * versión de su título aumenta
+ *
+ * @param indice Índice de títulos
+ * @param posicion Posición del ejemplar en la BD
+ */
+void cambioEjemplar(indice_titulos_t *indice, int posicion);
+
+/**
+ * @brief Los títulos más parecidos a un nombre (con errores de escritura,
+ * mayúsculas, tildes o espacios de más), comparando las firmas de trigramas
+ * de sus claves
+ *
+ * @param indice Índice de títulos
+ * @param nombre Nombre a buscar
+ * @param resultados RETORNA: títulos de mayor a menor parecido
+ * @param k Cantidad máxima de resultados
+ * @return int Cantidad de resultados (los que tienen algún trigrama en común)
+ */
+int buscarParecidos(const indice_titulos_t *indice,
+                    const char *nombre,
+                    parecido_t resultados[],
+                    int k);
+
+#endif // __TITULOS_H__
@@ -0,0 +1,263 @@
+/**
+ * @file uring.c
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Acceso mínimo a io_uring mediante llamadas al sistema (sin liburing)
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+#include "common.h"
+
+/* ---------------------------- Llamadas al sistema ---------------------------- */
+
+static int uringSetup(unsigned entradas, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entradas, p);
+}
+
+static int uringEnter(int fd, unsigned enviar, unsigned esperar, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, enviar, esperar, flags, NULL, 0);
+}
+
+static int uringRegister(int fd, unsigned op, void *arg, unsigned n)
+{
+    return (int)syscall(__NR_io_uring_register, fd, op, arg, n);
+}
+
+/* --------------------------------- Anillos --------------------------------- */
+
+int uringIniciar(uring_t *ring, unsigned entradas)
+{
+    memset(ring, 0, sizeof(*ring));
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    ring->fd = uringSetup(entradas, &p);
+    if (ring->fd < 0)
+        return FAILURE_GENERIC;
+
+    // 1. Mapear el SQ y el CQ (una sola región si el kernel lo permite)
+    ring->sq_tam = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_tam = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_tam > ring->sq_tam)
+            ring->sq_tam = ring->cq_tam;
+        ring->cq_tam = ring->sq_tam;
+    }
+
+    ring->sq_mapa = mmap(NULL, ring->sq_tam, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_mapa == MAP_FAILED)
+    {
+        close(ring->fd);
+        return FAILURE_GENERIC;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        ring->cq_mapa = ring->sq_mapa;
+    else
+    {
+        ring->cq_mapa = mmap(NULL, ring->cq_tam, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_mapa == MAP_FAILED)
+        {
+            munmap(ring->sq_mapa, ring->sq_tam);
+            close(ring->fd);
+            return FAILURE_GENERIC;
+        }
+    }
+
+    // 2. Mapear el arreglo de SQE
+    ring->sqes_tam = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_tam, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        if (ring->cq_mapa != ring->sq_mapa)
+            munmap(ring->cq_mapa, ring->cq_tam);
+        munmap(ring->sq_mapa, ring->sq_tam);
+        close(ring->fd);
+        return FAILURE_GENERIC;
+    }
+
+    // 3. Ubicar los campos de cada anillo
+    char *sq = ring->sq_mapa, *cq = ring->cq_mapa;
+    ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+    ring->sq_entradas = p.sq_entries;
+
+    ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    return SUCCESS_GENERIC;
+}
+
+void uringCerrar(uring_t *ring)
+{
+    munmap(ring->sqes, ring->sqes_tam);
+    if (ring->cq_mapa != ring->sq_mapa)
+        munmap(ring->cq_mapa, ring->cq_tam);
+    munmap(ring->sq_mapa, ring->sq_tam);
+    close(ring->fd);
+}
+
+bool uringSoporta(uring_t *ring, int op)
+{
+    size_t tam = sizeof(struct io_uring_probe) +
+                 URING_MAX_OPS * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, tam);
+    if (probe == NULL)
+        return false;
+
+    bool soporta = false;
+    if (uringRegister(ring->fd, IORING_REGISTER_PROBE, probe, URING_MAX_OPS) == 0 &&
+        op <= probe->last_op)
+        soporta = (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+
+    free(probe);
+    return soporta;
+}
+
+struct io_uring_sqe *uringSqe(uring_t *ring)
+{
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *ring->sq_tail + ring->sq_preparadas;
+
+    // El SQ está lleno, hay que enviar antes de preparar más
+    if (tail - head >= ring->sq_entradas)
+        return NULL;
+
+    unsigned indice = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[indice];
+    memset(sqe, 0, sizeof(*sqe));
+
+    ring->sq_array[indice] = indice;
+    ring->sq_preparadas++;
+    return sqe;
+}
+
+int uringEnviar(uring_t *ring, unsigned esperar)
+{
+    // Publicar las SQE preparadas antes de avisarle al kernel
+    if (ring->sq_preparadas > 0)
+    {
+        __atomic_store_n(ring->sq_tail, *ring->sq_tail + ring->sq_preparadas,
+                         __ATOMIC_RELEASE);
+        ring->sq_preparadas = 0;
+    }
+
+    // También las que quedaron de un envío interrumpido (EINTR)
+    unsigned enviar = *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+    ring->ops++;
+    return uringEnter(ring->fd, enviar, esperar,
+                      esperar > 0 ? IORING_ENTER_GETEVENTS : 0);
+}
+
+struct io_uring_cqe *uringCqe(uring_t *ring)
+{
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    return &ring->cqes[head & *ring->cq_mask];
+}
+
+void uringAvanzar(uring_t *ring)
+{
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/* ----------------------------- Buffers provistos ----------------------------- */
+
+int uringRegistrarBuffers(uring_t *ring,
+                          uring_buffers_t *buffers,
+                          unsigned cantidad,
+                          size_t tam,
+                          int grupo)
+{
+    buffers->cantidad = cantidad;
+    buffers->tam = tam;
+    buffers->grupo = grupo;
+
+    // El anillo debe estar alineado a página, mmap lo garantiza
+    size_t tamAnillo = cantidad * sizeof(struct io_uring_buf);
+    buffers->anillo = mmap(NULL, tamAnillo, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers->anillo == MAP_FAILED)
+        return FAILURE_GENERIC;
+
+    buffers->memoria = malloc(cantidad * tam);
+    if (buffers->memoria == NULL)
+    {
+        munmap(buffers->anillo, tamAnillo);
+        return FAILURE_GENERIC;
+    }
+
+    struct io_uring_buf_reg registro;
+    memset(&registro, 0, sizeof(registro));
+    registro.ring_addr = (unsigned long)buffers->anillo;
+    registro.ring_entries = cantidad;
+    registro.bgid = grupo;
+
+    if (uringRegister(ring->fd, IORING_REGISTER_PBUF_RING, &registro, 1) < 0)
+    {
+        free(buffers->memoria);
+        munmap(buffers->anillo, tamAnillo);
+        return FAILURE_GENERIC;
+    }
+
+    // Entregar todos los buffers al kernel
+    buffers->anillo->tail = 0;
+    for (unsigned i = 0; i < cantidad; i++)
+        uringDevolverBuffer(buffers, i);
+
+    return SUCCESS_GENERIC;
+}
+
+void uringDevolverBuffer(uring_buffers_t *buffers, unsigned id)
+{
+    unsigned short tail = buffers->anillo->tail;
+    struct io_uring_buf *buf = &buffers->anillo->bufs[tail & (buffers->cantidad - 1)];
+
+    buf->addr = (unsigned long)uringBuffer(buffers, id);
+    buf->len = buffers->tam;
+    buf->bid = id;
+
+    __atomic_store_n(&buffers->anillo->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+void *uringBuffer(uring_buffers_t *buffers, unsigned id)
+{
+    return buffers->memoria + (size_t)id * buffers->tam;
+}
+
+void uringLiberarBuffers(uring_t *ring, uring_buffers_t *buffers)
+{
+    struct io_uring_buf_reg registro;
+    memset(&registro, 0, sizeof(registro));
+    registro.bgid = buffers->grupo;
+    uringRegister(ring->fd, IORING_UNREGISTER_PBUF_RING, &registro, 1);
+
+    munmap(buffers->anillo, buffers->cantidad * sizeof(struct io_uring_buf));
+    free(buffers->memoria);
+}
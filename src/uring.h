@@ -0,0 +1,168 @@
+/**
+ * @file uring.h
+ * @authors Ángel David Talero
+ *          Juan Esteban Urquijo
+ *          Humberto Rueda Cataño
+ * @brief Acceso mínimo a io_uring mediante llamadas al sistema (sin liburing)
+ * @copyright 2021
+ * Pontificia Universidad Javeriana
+ * Facultad de Ingeniería
+ * Bogotá D.C - Colombia
+ */
+
+#ifndef __URING_H__
+#define __URING_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+/* Los headers del sistema pueden ser más viejos que el kernel, estos códigos
+   se definen a mano y se verifican en tiempo de ejecución con uringSoporta */
+#define URING_OP_READ_MULTISHOT 49 /**< IORING_OP_READ_MULTISHOT (Linux 6.7)*/
+#define URING_MAX_OPS 64           /**< Operaciones que se consultan al kernel*/
+
+/**
+ * @struct uring_t
+ * @brief Anillos de envío (SQ) y de completación (CQ) mapeados en memoria
+ */
+typedef struct
+{
+    int fd; /**< Descriptor del io_uring*/
+
+    unsigned *sq_head;         /**< Cabeza del SQ (la mueve el kernel)*/
+    unsigned *sq_tail;         /**< Cola del SQ (la mueve el proceso)*/
+    unsigned *sq_mask;         /**< Máscara de posiciones del SQ*/
+    unsigned *sq_array;        /**< Índices de las SQE enviadas*/
+    struct io_uring_sqe *sqes; /**< Arreglo de SQE*/
+    unsigned sq_entradas;      /**< Tamaño del SQ*/
+    unsigned sq_preparadas;    /**< SQE preparadas que aún no se envían*/
+
+    unsigned *cq_head;         /**< Cabeza del CQ (la mueve el proceso)*/
+    unsigned *cq_tail;         /**< Cola del CQ (la mueve el kernel)*/
+    unsigned *cq_mask;         /**< Máscara de posiciones del CQ*/
+    struct io_uring_cqe *cqes; /**< Arreglo de CQE*/
+
+    void *sq_mapa;     /**< Mapeo del SQ*/
+    size_t sq_tam;     /**< Tamaño del mapeo del SQ*/
+    void *cq_mapa;     /**< Mapeo del CQ (igual a sq_mapa con SINGLE_MMAP)*/
+    size_t cq_tam;     /**< Tamaño del mapeo del CQ*/
+    size_t sqes_tam;   /**< Tamaño del mapeo de las SQE*/
+    unsigned long ops; /**< Cantidad de io_uring_enter realizados*/
+} uring_t;
+
+/**
+ * @struct uring_buffers_t
+ * @brief Buffers provistos al kernel (IORING_REGISTER_PBUF_RING) para que las
+ * lecturas multishot escojan dónde escribir
+ */
+typedef struct
+{
+    struct io_uring_buf_ring *anillo; /**< Anillo compartido con el kernel*/
+    char *memoria;                    /**< Memoria de todos los buffers*/
+    unsigned cantidad;                /**< Cantidad de buffers (potencia de 2)*/
+    size_t tam;                       /**< Tamaño de cada buffer*/
+    int grupo;                        /**< Identificador del grupo de buffers*/
+} uring_buffers_t;
+
+/**
+ * @brief Crear un io_uring y mapear sus anillos
+ *
+ * @param ring Anillo a iniciar
+ * @param entradas Tamaño del SQ
+ * @return SUCCESS_GENERIC si éxito, FAILURE_GENERIC si el kernel no lo permite
+ */
+int uringIniciar(uring_t *ring, unsigned entradas);
+
+/**
+ * @brief Desmapear los anillos y cerrar el io_uring
+ *
+ * @param ring Anillo a cerrar
+ */
+void uringCerrar(uring_t *ring);
+
+/**
+ * @brief Saber si el kernel soporta una operación
+ *
+ * @param ring Anillo iniciado
+ * @param op Código IORING_OP_*
+ * @return true si se soporta
+ */
+bool uringSoporta(uring_t *ring, int op);
+
+/**
+ * @brief Obtener una SQE vacía, se envía con \ref uringEnviar
+ *
+ * @param ring Anillo iniciado
+ * @return struct io_uring_sqe* SQE en ceros o NULL si el SQ está lleno
+ */
+struct io_uring_sqe *uringSqe(uring_t *ring);
+
+/**
+ * @brief Enviar todas las SQE preparadas en una sola llamada al sistema y
+ * esperar completaciones
+ *
+ * @param ring Anillo iniciado
+ * @param esperar Completaciones mínimas a esperar (0 para no bloquear)
+ * @return int Resultado de io_uring_enter (negativo con errno si falla)
+ */
+int uringEnviar(uring_t *ring, unsigned esperar);
+
+/**
+ * @brief Obtener la próxima completación sin bloquear
+ * @note No olvidar marcarla con \ref uringAvanzar
+ *
+ * @param ring Anillo iniciado
+ * @return struct io_uring_cqe* Completación o NULL si no hay
+ */
+struct io_uring_cqe *uringCqe(uring_t *ring);
+
+/**
+ * @brief Marcar la completación actual como atendida
+ *
+ * @param ring Anillo iniciado
+ */
+void uringAvanzar(uring_t *ring);
+
+/**
+ * @brief Registrar un grupo de buffers provistos
+ *
+ * @param ring Anillo iniciado
+ * @param buffers RETORNA: grupo de buffers
+ * @param cantidad Cantidad de buffers (potencia de 2)
+ * @param tam Tamaño de cada buffer
+ * @param grupo Identificador del grupo
+ * @return SUCCESS_GENERIC si éxito, FAILURE_GENERIC de lo contrario
+ */
+int uringRegistrarBuffers(uring_t *ring,
+                          uring_buffers_t *buffers,
+                          unsigned cantidad,
+                          size_t tam,
+                          int grupo);
+
+/**
+ * @brief Devolver un buffer al kernel después de leer su contenido
+ *
+ * @param buffers Grupo de buffers
+ * @param id Identificador del buffer (de la CQE)
+ */
+void uringDevolverBuffer(uring_buffers_t *buffers, unsigned id);
+
+/**
+ * @brief Dirección del contenido de un buffer provisto
+ *
+ * @param buffers Grupo de buffers
+ * @param id Identificador del buffer (de la CQE)
+ * @return void* Inicio del buffer
+ */
+void *uringBuffer(uring_buffers_t *buffers, unsigned id);
+
+/**
+ * @brief Liberar un grupo de buffers provistos
+ *
+ * @param ring Anillo iniciado
+ * @param buffers Grupo de buffers
+ */
+void uringLiberarBuffers(uring_t *ring, uring_buffers_t *buffers);
+
+#endif // __URING_H__